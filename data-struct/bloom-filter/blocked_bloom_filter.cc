@@ -0,0 +1,110 @@
+#include "cpp-base/data-struct/bloom-filter/blocked_bloom_filter.h"
+
+#include <glog/logging.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/hash/hash.h"
+
+namespace cpp_base {
+
+namespace {
+
+const uint64 kHashSeed = 0x8f1bbcdcca62c1d6ULL;
+
+// Odd multipliers that spread the low 32 bits of the hash into one bit
+// position (the top 6 bits of the product) per word of the block.
+const uint32 kSalts[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                          0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+#ifdef __AVX2__
+// Sets 'lo' and 'hi' to the bits of 'hash' in words 0-3 and 4-7 of its block.
+inline void MakeMasks(uint64 hash, __m256i* lo, __m256i* hi) {
+    const __m256i salts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kSalts));
+    const __m256i positions = _mm256_srli_epi32(
+            _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<uint32>(hash)), salts), 26);
+    const __m256i one = _mm256_set1_epi64x(1);
+    *lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(positions)));
+    *hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(positions, 1)));
+}
+#else
+inline uint64 WordMask(uint64 hash, int word) {
+    return 1ULL << ((static_cast<uint32>(hash) * kSalts[word]) >> 26);
+}
+#endif
+
+}  // namespace
+
+BlockedBloomFilter::BlockedBloomFilter(int64 bit_size, int64 expected_num_elements)
+        : num_blocks_(std::max<int64>(1, (bit_size + kBlockBits - 1) / kBlockBits)),
+          expected_num_elements_(expected_num_elements) {
+    CHECK_LE(num_blocks_, 1LL << 32) << "Block index is 32 bits";
+    void* data;
+    CHECK_EQ(posix_memalign(&data, kBlockBytes, num_blocks_ * kBlockBytes), 0);
+    blocks_ = static_cast<Block*>(data);
+    memset(blocks_, 0, num_blocks_ * kBlockBytes);
+}
+
+BlockedBloomFilter::~BlockedBloomFilter() {
+    free(blocks_);
+}
+
+bool BlockedBloomFilter::Insert(uint64 key) {
+    const uint64 hash = Hash64NumWithSeed(key, kHashSeed);
+    Block* block = BlockOf(hash);
+    bool inserted;
+#ifdef __AVX2__
+    __m256i lo, hi;
+    MakeMasks(hash, &lo, &hi);
+    __m256i* words = reinterpret_cast<__m256i*>(block->words);
+    const __m256i old_lo = _mm256_load_si256(words);
+    const __m256i old_hi = _mm256_load_si256(words + 1);
+    inserted = !(_mm256_testc_si256(old_lo, lo) & _mm256_testc_si256(old_hi, hi));
+    _mm256_store_si256(words, _mm256_or_si256(old_lo, lo));
+    _mm256_store_si256(words + 1, _mm256_or_si256(old_hi, hi));
+#else
+    inserted = false;
+    for (int i = 0; i < 8; ++i) {
+        const uint64 mask = WordMask(hash, i);
+        inserted |= (block->words[i] & mask) == 0;
+        block->words[i] |= mask;
+    }
+#endif
+    ++num_inserts_;
+
+    // If we went beyond the expected size, log a warning, but only at a regulated rate.
+    if (num_inserts_ > expected_num_elements_ && BloomFilter::IsPowerOf2(++log_regulator_)) {
+        LOG(WARNING) << "BF insertions (" << num_inserts_ << ") exceeded the expected maximum ("
+                     << expected_num_elements_ << "). Accuracy will degrade. Need more memory.";
+    }
+    return inserted;
+}
+
+bool BlockedBloomFilter::Contains(uint64 key) const {
+    const uint64 hash = Hash64NumWithSeed(key, kHashSeed);
+    const Block* block = BlockOf(hash);
+#ifdef __AVX2__
+    __m256i lo, hi;
+    MakeMasks(hash, &lo, &hi);
+    const __m256i* words = reinterpret_cast<const __m256i*>(block->words);
+    return _mm256_testc_si256(_mm256_load_si256(words), lo) &
+           _mm256_testc_si256(_mm256_load_si256(words + 1), hi);
+#else
+    for (int i = 0; i < 8; ++i) {
+        if ((block->words[i] & WordMask(hash, i)) == 0)
+            return false;
+    }
+    return true;
+#endif
+}
+
+void BlockedBloomFilter::Clear() {
+    memset(blocks_, 0, num_blocks_ * kBlockBytes);
+    num_inserts_ = 0;
+}
+
+}  // namespace cpp_base
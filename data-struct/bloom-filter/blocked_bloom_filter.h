@@ -0,0 +1,71 @@
+#ifndef CPP_BASE_DATA_STRUCT_BLOOM_FILTER_BLOCKED_BLOOM_FILTER_H_
+#define CPP_BASE_DATA_STRUCT_BLOOM_FILTER_BLOCKED_BLOOM_FILTER_H_
+
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+
+namespace cpp_base {
+
+// A cache-line blocked Bloom filter, with the same API as BloomFilter. Each
+// key hashes once, to one 64-byte block, and sets 8 bits in it: one in each
+// of the block's eight 64-bit words. So an insert or lookup touches a single
+// cache line and costs one hash, rather than up to 8 of each in BloomFilter.
+//
+// The price is a somewhat higher false positive rate for the same memory,
+// since blocks fill unevenly; e.g., about 1.05% vs 0.8% at 10 bits per key
+// (see blocked_bloom_filter_benchmark.cc). The number of bits per key is
+// fixed at 8, which is near optimal for 8 to 16 bits of memory per key.
+//
+// When compiled with AVX2 (e.g., -mavx2 or -march=native), the 8 bit
+// positions are computed and tested in one go with vector instructions;
+// otherwise a scalar loop computes the very same bits.
+// This class is *not* thread-safe.
+class BlockedBloomFilter {
+  public:
+    // Constructs an empty filter of at least 'bit_size' bits, rounded up to
+    // whole blocks. 'expected_num_elements' is only used for warning when
+    // the filter is over-used.
+    BlockedBloomFilter(int64 bit_size, int64 expected_num_elements);
+
+    ~BlockedBloomFilter();
+
+    // Returns true if the given key is inserted, false if it already existed.
+    bool Insert(uint64 key);
+
+    // Returns whether the given key exists in the filter.
+    bool Contains(uint64 key) const;
+
+    // Clears the filter.
+    void Clear();
+
+    const uint8* RawData() const { return reinterpret_cast<const uint8*>(blocks_); }
+    int64 BitSize() const { return num_blocks_ * kBlockBits; }
+    int64 NumElements() const { return num_inserts_; }
+
+    static const int kBlockBytes = 64;
+    static const int kBlockBits = kBlockBytes * 8;
+
+  private:
+    struct alignas(kBlockBytes) Block {
+        uint64 words[8];
+    };
+
+    // The block of 'hash', by multiply-shift of its high 32 bits.
+    Block* BlockOf(uint64 hash) const {
+        return blocks_ + (((hash >> 32) * num_blocks_) >> 32);
+    }
+
+    const int64 num_blocks_;
+    Block* blocks_;                 // The underlying bit vector, cache-line aligned
+    int64 num_inserts_ = 0;         // Num elements inserted so far
+
+    // These are used for logging a warning if the Bloom Filter is over-used.
+    const int64 expected_num_elements_;
+    int64 log_regulator_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(BlockedBloomFilter);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_BLOOM_FILTER_BLOCKED_BLOOM_FILTER_H_
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "cpp-base/data-struct/bloom-filter/blocked_bloom_filter.h"
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+
+using cpp_base::BlockedBloomFilter;
+using cpp_base::BloomFilter;
+using std::vector;
+
+class BlockedBloomFilterTest : public ::testing::Test {
+  public:
+    BlockedBloomFilterTest() { }
+    ~BlockedBloomFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    // Distinct random keys: the first 'n' to insert, the rest to probe.
+    static vector<uint64> RandomKeys(int64 n) {
+        std::mt19937_64 rand_gen(42);
+        vector<uint64> keys(2 * n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+
+    // Returns the false positive ratio of 'filter' after inserting keys[0, n),
+    // measured on keys[n, 2n), and sets the average ns per insert and lookup.
+    template <class Filter>
+    static double Measure(const vector<uint64>& keys, Filter* filter,
+                          double* insert_ns, double* hit_ns, double* miss_ns) {
+        const int64 n = keys.size() / 2;
+        auto start = std::chrono::steady_clock::now();
+        for (int64 i = 0; i < n; ++i)
+            filter->Insert(keys[i]);
+        *insert_ns = ElapsedNs(start) / n;
+
+        int64 num_hits = 0;
+        start = std::chrono::steady_clock::now();
+        for (int64 i = 0; i < n; ++i)
+            num_hits += filter->Contains(keys[i]);
+        *hit_ns = ElapsedNs(start) / n;
+        CHECK_EQ(num_hits, n);  // No false negatives
+
+        int64 num_false_positives = 0;
+        start = std::chrono::steady_clock::now();
+        for (int64 i = n; i < 2 * n; ++i)
+            num_false_positives += filter->Contains(keys[i]);
+        *miss_ns = ElapsedNs(start) / n;
+        return num_false_positives * 1. / n;
+    }
+
+    static double ElapsedNs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+TEST_F(BlockedBloomFilterTest, Benchmark) {
+    // False positive ratio vs memory.
+    const int64 kNumKeys = 1000000;
+    vector<uint64> keys = RandomKeys(kNumKeys);
+    for (int bits_per_key : {6, 8, 10, 12, 16, 20}) {
+        BloomFilter bf(kNumKeys * bits_per_key, kNumKeys);
+        BlockedBloomFilter bbf(kNumKeys * bits_per_key, kNumKeys);
+        double insert_ns, hit_ns, miss_ns;
+        double bf_fp = Measure(keys, &bf, &insert_ns, &hit_ns, &miss_ns);
+        double bbf_fp = Measure(keys, &bbf, &insert_ns, &hit_ns, &miss_ns);
+        LOG(INFO) << bits_per_key << " bits/key: false positives "
+                  << bf_fp * 100 << "% BloomFilter, " << bbf_fp * 100 << "% BlockedBloomFilter";
+    }
+
+    // Throughput, on filters much larger than the last-level cache.
+    const int64 kNumLargeKeys = 20000000;
+    keys = RandomKeys(kNumLargeKeys);
+    {
+        BloomFilter bf(kNumLargeKeys * 10, kNumLargeKeys);
+        double insert_ns, hit_ns, miss_ns;
+        Measure(keys, &bf, &insert_ns, &hit_ns, &miss_ns);
+        LOG(INFO) << "BloomFilter of " << bf.BitSize() / 8e6 << " MB: " << insert_ns
+                  << " ns/insert, " << hit_ns << " ns/hit, " << miss_ns << " ns/miss";
+    }
+    {
+        BlockedBloomFilter bbf(kNumLargeKeys * 10, kNumLargeKeys);
+        double insert_ns, hit_ns, miss_ns;
+        Measure(keys, &bbf, &insert_ns, &hit_ns, &miss_ns);
+        LOG(INFO) << "BlockedBloomFilter of " << bbf.BitSize() / 8e6 << " MB: " << insert_ns
+                  << " ns/insert, " << hit_ns << " ns/hit, " << miss_ns << " ns/miss";
+    }
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <random>
+#include <vector>
+
+#include "cpp-base/data-struct/bloom-filter/blocked_bloom_filter.h"
+
+using cpp_base::BlockedBloomFilter;
+using std::vector;
+
+class BlockedBloomFilterTest : public ::testing::Test {
+  public:
+    BlockedBloomFilterTest() { }
+    ~BlockedBloomFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    // Distinct random keys: the first 'n' to insert, the rest to probe.
+    static vector<uint64> RandomKeys(int64 n) {
+        std::mt19937_64 rand_gen(42);
+        vector<uint64> keys(2 * n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+};
+
+TEST_F(BlockedBloomFilterTest, BasicTest) {
+    BlockedBloomFilter bf(1000, 100);
+    EXPECT_EQ(1024, bf.BitSize());  // Two blocks
+    EXPECT_EQ(0, bf.NumElements());
+    EXPECT_FALSE(bf.Contains(25));
+
+    EXPECT_TRUE(bf.Insert(25));
+    EXPECT_TRUE(bf.Contains(25));
+    EXPECT_EQ(1, bf.NumElements());
+
+    EXPECT_FALSE(bf.Contains(35));
+    EXPECT_FALSE(bf.Insert(25));
+
+    // Exactly 8 bits are set, in one block, one per 64-bit word.
+    int num_bits = 0;
+    for (int i = 0; i < bf.BitSize() / 8; ++i)
+        num_bits += __builtin_popcount(bf.RawData()[i]);
+    EXPECT_EQ(8, num_bits);
+
+    bf.Clear();
+    EXPECT_EQ(0, bf.NumElements());
+    EXPECT_FALSE(bf.Contains(25));
+}
+
+TEST_F(BlockedBloomFilterTest, StatisticalTest) {
+    const int64 N = 1000000;
+    vector<uint64> keys = RandomKeys(N);
+    BlockedBloomFilter bf(N * 10, N);
+    for (int64 i = 0; i < N; ++i)
+        bf.Insert(keys[i]);
+    int64 num_false_positives = 0;
+    for (int64 i = 0; i < N; ++i) {
+        EXPECT_TRUE(bf.Contains(keys[i]));
+        num_false_positives += bf.Contains(keys[N + i]);
+    }
+    const double fp = num_false_positives * 1. / N;
+    LOG(INFO) << "False positive ratio: " << fp * 100 << "%";
+    EXPECT_LT(fp, 0.015);
+}
@@ -1,16 +1,83 @@
 #include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
 
 #include <glog/logging.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 #include <algorithm>
+#include <limits>
 #include <random>
+#include "cpp-base/file/header_page_file.h"
 #include "cpp-base/hash/hash.h"
+#include "cpp-base/thread/parallel.h"
 
 namespace cpp_base {
 
-BloomFilter::BloomFilter(int64 bit_size, int64 expected_num_elements)
-        : byte_size_((bit_size - 1) / 8 + 1),
+namespace {
+
+const uint32 kFileMagic = 0x464d4c42;  // "BLMF"
+// Version 2 added the indexing mode; version 1 files are read as kSeededHashes.
+const uint32 kFileVersion = 2;
+
+// The bit vector follows a header page; see header_page_file.h.
+struct FileHeader {
+    uint32 magic;
+    uint32 version;
+    int64 bit_size;
+    int64 expected_num_elements;
+    int64 num_inserts;
+    int64 num_hashes;
+    uint64 hash_keys[8];
+    uint32 indexing;  // Since version 2
+};
+
+static_assert(sizeof(FileHeader) <= kHeaderPageSize, "FileHeader does not fit its page");
+
+struct OrOp {
+    uint64 operator()(uint64 a, uint64 b) const { return a | b; }
+#ifdef __AVX2__
+    __m256i operator()(__m256i a, __m256i b) const { return _mm256_or_si256(a, b); }
+#endif
+};
+
+struct AndOp {
+    uint64 operator()(uint64 a, uint64 b) const { return a & b; }
+#ifdef __AVX2__
+    __m256i operator()(__m256i a, __m256i b) const { return _mm256_and_si256(a, b); }
+#endif
+};
+
+// Sets dst[i] = op(dst[i], src[i]) for 'size' bytes: 32 at a time with AVX2, 8 otherwise.
+template <class Op>
+void CombineBytes(uint8* dst, const uint8* src, int64 size, Op op) {
+    int64 i = 0;
+#ifdef __AVX2__
+    for (; i + 32 <= size; i += 32) {
+        __m256i* d = reinterpret_cast<__m256i*>(dst + i);
+        const __m256i* s = reinterpret_cast<const __m256i*>(src + i);
+        _mm256_storeu_si256(d, op(_mm256_loadu_si256(d), _mm256_loadu_si256(s)));
+    }
+#endif
+    for (; i + 8 <= size; i += 8) {
+        uint64 d, s;
+        memcpy(&d, dst + i, 8);
+        memcpy(&s, src + i, 8);
+        d = op(d, s);
+        memcpy(dst + i, &d, 8);
+    }
+    for (; i < size; ++i)
+        dst[i] = op(dst[i], src[i]);
+}
+
+}  // namespace
+
+BloomFilter::BloomFilter(int64 bit_size, int64 expected_num_elements, Indexing indexing)
+        : byte_size_(indexing == kBlocked ? ((bit_size - 1) / kBlockBits + 1) * (kBlockBits / 8) :
+                                            (bit_size - 1) / 8 + 1),
           bit_size_(byte_size_ * 8),
-          expected_num_elements_(expected_num_elements) {
+          expected_num_elements_(expected_num_elements),
+          indexing_(indexing) {
     data_ = new uint8[byte_size_];
     memset(data_, 0, byte_size_);
 
@@ -20,6 +87,10 @@ BloomFilter::BloomFilter(int64 bit_size, int64 expected_num_elements)
         num_hashes = 1;
     else if (num_hashes > 8)  // More than 8 hash functions is unnecessary and only time consuming
         num_hashes = 8;
+    if (indexing == kBlocked) {
+        num_hashes = 8;
+        CHECK_LE(bit_size_ / kBlockBits, 1LL << 32) << "Block index is 32 bits";
+    }
 
     std::mt19937_64 rand_gen(1000);
     for (int64 i = 0; i < num_hashes; ++i)
@@ -36,22 +107,122 @@ BloomFilter::BloomFilter(int64 bit_size, int64 expected_num_elements)
     }
 }
 
+BloomFilter::BloomFilter(int64 bit_size, int64 expected_num_elements, int64 num_inserts,
+                         std::vector<uint64> hash_keys, Indexing indexing, uint8* data,
+                         int64 mapping_size)
+        : byte_size_(bit_size / 8),
+          bit_size_(bit_size),
+          data_(data),
+          num_inserts_(num_inserts),
+          expected_num_elements_(expected_num_elements),
+          hash_keys_(std::move(hash_keys)),
+          indexing_(indexing),
+          mapping_size_(mapping_size) {
+}
+
 BloomFilter::~BloomFilter() {
-    delete[] data_;
+    if (IsReadOnly())
+        UnmapHeaderPageFile(data_ - kHeaderPageSize, mapping_size_);
+    else
+        delete[] data_;
 }
 
-bool BloomFilter::Insert(uint64 key) {
-    bool inserted = false;
+bool BloomFilter::SaveToFile(const std::string& path) const {
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kFileMagic;
+    header.version = kFileVersion;
+    header.bit_size = bit_size_;
+    header.expected_num_elements = expected_num_elements_;
+    header.num_inserts = num_inserts_;
+    header.num_hashes = hash_keys_.size();
+    std::copy(hash_keys_.begin(), hash_keys_.end(), header.hash_keys);
+    header.indexing = indexing_;
+    return WriteHeaderPageFile(path, &header, sizeof(header), {{data_, byte_size_}});
+}
+
+std::unique_ptr<BloomFilter> BloomFilter::OpenFile(const std::string& path) {
+    int64 mapping_size;
+    uint8* mapping = MapHeaderPageFile(path, &mapping_size);
+    if (mapping == nullptr)
+        return nullptr;
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(mapping);
+    const uint32 indexing =
+            header->version >= 2 ? header->indexing : static_cast<uint32>(kSeededHashes);
+    if (header->magic != kFileMagic || header->version < 1 || header->version > kFileVersion ||
+        indexing > kBlocked ||
+        (indexing == kBlocked && (header->bit_size % kBlockBits != 0 || header->num_hashes != 8)) ||
+        header->bit_size <= 0 || header->bit_size % 8 != 0 ||
+        header->num_hashes < 1 || header->num_hashes > 8 ||
+        mapping_size != kHeaderPageSize + header->bit_size / 8) {
+        LOG(ERROR) << path << " is not a BloomFilter file of version up to " << kFileVersion;
+        UnmapHeaderPageFile(mapping, mapping_size);
+        return nullptr;
+    }
+    std::vector<uint64> hash_keys(header->hash_keys, header->hash_keys + header->num_hashes);
+    return std::unique_ptr<BloomFilter>(new BloomFilter(
+            header->bit_size, header->expected_num_elements, header->num_inserts,
+            std::move(hash_keys), static_cast<Indexing>(indexing), mapping + kHeaderPageSize,
+            mapping_size));
+}
+
+std::unique_ptr<BloomFilter> BloomFilter::LoadFromFile(const std::string& path) {
+    std::unique_ptr<BloomFilter> mapped = OpenFile(path);
+    if (mapped == nullptr)
+        return nullptr;
+    uint8* data = new uint8[mapped->byte_size_];
+    memcpy(data, mapped->data_, mapped->byte_size_);
+    return std::unique_ptr<BloomFilter>(new BloomFilter(
+            mapped->bit_size_, mapped->expected_num_elements_, mapped->num_inserts_,
+            mapped->hash_keys_, mapped->indexing_, data, 0));
+}
+
+std::unique_ptr<BloomFilter> BloomFilter::MapFromFile(const std::string& path) {
+    return OpenFile(path);
+}
+
+class BloomFilter::BitPositions {
+  public:
+    BitPositions(const BloomFilter& bf, uint64 key) : bf_(bf), key_(key) {
+        if (bf.indexing_ == kDoubleHashing) {
+            // One mix as in Hash64NumWithSeed(), keeping two of its words: a 128-bit hash.
+            h2_ = GG_ULONGLONG(0xe08c1d668b756f82);
+            h1_ = bf.hash_keys_[0];
+            mix(key, h2_, h1_);
+        } else if (bf.indexing_ == kBlocked) {
+            // The block by multiply-shift of the high 32 bits of the hash.
+            h1_ = Hash64NumWithSeed(key, bf.hash_keys_[0]);
+            h2_ = (((h1_ >> 32) * (bf.bit_size_ / kBlockBits)) >> 32) * kBlockBits;
+        }
+    }
+
+    // The position for hash function i.
+    int64 operator[](int64 i) const {
+        if (bf_.indexing_ == kDoubleHashing) {
+            // Multiply-shift maps the 64-bit hash to [0, bit_size_) by its high bits.
+            return (static_cast<unsigned __int128>(h1_ + i * h2_) * bf_.bit_size_) >> 64;
+        }
+        if (bf_.indexing_ == kBlocked)
+            return h2_ + i * 16 + BlockedWordPosition(h1_, i);
+        return Hash64NumWithSeed(key_, bf_.hash_keys_[i]) % bf_.bit_size_;
+    }
+
+  private:
+    const BloomFilter& bf_;
+    const uint64 key_;
+    uint64 h1_, h2_;
+};
+
+inline void BloomFilter::GetBits(uint64 key, int64* byte_indices, uint8* bit_masks) const {
+    BitPositions positions(*this, key);
     for (int64 i = 0; i < hash_keys_.size(); ++i) {
-        uint64 mix = Hash64NumWithSeed(key, hash_keys_[i]);
-        int64 index = mix % bit_size_;
-        int64 byte = index / 8;
-        int64 bit = index % 8;
-        uint8 prev = data_[byte];
-        data_[byte] |= 1 << bit;
-        if (prev != data_[byte])
-            inserted = true;
+        int64 index = positions[i];
+        byte_indices[i] = index / 8;
+        bit_masks[i] = 1 << (index % 8);
     }
+}
+
+inline void BloomFilter::CountInsert() {
     //if (inserted)
     ++num_inserts_;
 
@@ -60,14 +231,57 @@ bool BloomFilter::Insert(uint64 key) {
         LOG(WARNING) << "BF insertions (" << num_inserts_ << ") exceeded the expected maximum ("
                      << expected_num_elements_ << "). Accuracy will degrade. Need more memory.";
     }
+}
 
+bool BloomFilter::Insert(uint64 key) {
+    CHECK(!IsReadOnly()) << "Insert() into a filter mapped from a file";
+    bool inserted = false;
+    BitPositions positions(*this, key);
+    for (int64 i = 0; i < hash_keys_.size(); ++i) {
+        int64 index = positions[i];
+        int64 byte = index / 8;
+        int64 bit = index % 8;
+        uint8 prev = data_[byte];
+        data_[byte] |= 1 << bit;
+        if (prev != data_[byte])
+            inserted = true;
+    }
+    CountInsert();
     return inserted;
 }
 
+int64 BloomFilter::InsertBatch(const uint64* keys, int64 num_keys, bool* results) {
+    CHECK(!IsReadOnly()) << "InsertBatch() into a filter mapped from a file";
+    const int64 num_hashes = hash_keys_.size();  // At most 8
+    int64 byte_indices[kBatchSize * 8];
+    uint8 bit_masks[kBatchSize * 8];
+    int64 num_inserted = 0;
+    for (int64 start = 0; start < num_keys; start += kBatchSize) {
+        const int64 n = std::min<int64>(kBatchSize, num_keys - start);
+        for (int64 k = 0; k < n; ++k) {
+            GetBits(keys[start + k], byte_indices + k * num_hashes, bit_masks + k * num_hashes);
+            for (int64 i = k * num_hashes; i < (k + 1) * num_hashes; ++i)
+                __builtin_prefetch(data_ + byte_indices[i], 1 /* for write */);
+        }
+        for (int64 k = 0; k < n; ++k) {
+            bool inserted = false;
+            for (int64 i = k * num_hashes; i < (k + 1) * num_hashes; ++i) {
+                inserted |= (data_[byte_indices[i]] & bit_masks[i]) == 0;
+                data_[byte_indices[i]] |= bit_masks[i];
+            }
+            CountInsert();
+            num_inserted += inserted;
+            if (results != nullptr)
+                results[start + k] = inserted;
+        }
+    }
+    return num_inserted;
+}
+
 bool BloomFilter::Contains(uint64 key) const {
+    BitPositions positions(*this, key);
     for (int64 i = 0; i < hash_keys_.size(); ++i) {
-        uint64 mix = Hash64NumWithSeed(key, hash_keys_[i]);
-        int64 index = mix % bit_size_;
+        int64 index = positions[i];
         int64 byte = index / 8;
         int64 bit = index % 8;
         if (!(data_[byte] & (1 << bit)))
@@ -76,7 +290,140 @@ bool BloomFilter::Contains(uint64 key) const {
     return true;
 }
 
+void BloomFilter::ContainsBatch(const uint64* keys, int64 num_keys, bool* results) const {
+    // Most absent keys are ruled out by their first bit, so rather than fetching all the bits of
+    // every key at once, first fetch the first bit of each key, then all the other bits of the
+    // keys that passed.
+    const int64 num_hashes = hash_keys_.size();  // At most 8
+    int64 byte_indices[kBatchSize * 8];
+    uint8 bit_masks[kBatchSize * 8];
+    int64 positions[kBatchSize];
+    for (int64 start = 0; start < num_keys; start += kBatchSize) {
+        const int64 n = std::min<int64>(kBatchSize, num_keys - start);
+        for (int64 k = 0; k < n; ++k) {
+            int64 index = BitPositions(*this, keys[start + k])[0];
+            byte_indices[k] = index / 8;
+            bit_masks[k] = 1 << (index % 8);
+            __builtin_prefetch(data_ + byte_indices[k]);
+        }
+        int64 num_passed = 0;
+        for (int64 k = 0; k < n; ++k) {
+            results[start + k] = (data_[byte_indices[k]] & bit_masks[k]) != 0;
+            if (results[start + k])
+                positions[num_passed++] = start + k;
+        }
+        if (num_hashes == 1 || num_passed == 0)
+            continue;
+
+        for (int64 k = 0; k < num_passed; ++k) {
+            GetBits(keys[positions[k]], byte_indices + k * num_hashes, bit_masks + k * num_hashes);
+            for (int64 i = k * num_hashes + 1; i < (k + 1) * num_hashes; ++i)
+                __builtin_prefetch(data_ + byte_indices[i]);
+        }
+        for (int64 k = 0; k < num_passed; ++k) {
+            uint8 all = 1;
+            for (int64 i = k * num_hashes + 1; i < (k + 1) * num_hashes; ++i)
+                all &= (data_[byte_indices[i]] & bit_masks[i]) != 0;
+            results[positions[k]] = all;
+        }
+    }
+}
+
+void BloomFilter::InsertInParallel(const uint64* keys, int64 num_keys, ThreadPool* pool,
+                                   int num_tasks) {
+    CHECK(!IsReadOnly()) << "InsertInParallel() into a filter mapped from a file";
+    CHECK_GT(num_tasks, 0);
+    // Regions of whole cache lines, so the tasks do not even share those.
+    const int64 region_size = ((byte_size_ - 1) / num_tasks / 64 + 1) * 64;
+    const int64 round_size = num_tasks * static_cast<int64>(kKeysPerTask);
+
+    // buckets[t * num_tasks + r] has the bit positions in region r of the keys of task t.
+    std::vector<std::vector<int64>> buckets(num_tasks * num_tasks);
+    for (int64 start = 0; start < num_keys; start += round_size) {
+        const int64 end = std::min(start + round_size, num_keys);
+        const int64 keys_per_task = (end - start - 1) / num_tasks + 1;
+        RunInParallel(pool, num_tasks, [&](int t) {
+            std::vector<int64>* task_buckets = &buckets[t * num_tasks];
+            const int64 task_end = std::min(start + (t + 1) * keys_per_task, end);
+            for (int64 i = start + t * keys_per_task; i < task_end; ++i) {
+                BitPositions positions(*this, keys[i]);
+                for (int64 j = 0; j < hash_keys_.size(); ++j) {
+                    int64 index = positions[j];
+                    task_buckets[index / 8 / region_size].push_back(index);
+                }
+            }
+        });
+        RunInParallel(pool, num_tasks, [&](int r) {
+            for (int t = 0; t < num_tasks; ++t) {
+                std::vector<int64>* bucket = &buckets[t * num_tasks + r];
+                for (int64 index : *bucket)
+                    data_[index / 8] |= 1 << (index % 8);
+                bucket->clear();
+            }
+        });
+    }
+
+    num_inserts_ += num_keys;
+    if (num_inserts_ > expected_num_elements_) {
+        LOG(WARNING) << "BF insertions (" << num_inserts_ << ") exceeded the expected maximum ("
+                     << expected_num_elements_ << "). Accuracy will degrade. Need more memory.";
+    }
+}
+
+bool BloomFilter::IsCompatible(const BloomFilter& other) const {
+    return bit_size_ == other.bit_size_ && hash_keys_ == other.hash_keys_ &&
+           indexing_ == other.indexing_;
+}
+
+void BloomFilter::Union(const BloomFilter& other) {
+    CHECK(!IsReadOnly()) << "Union() into a filter mapped from a file";
+    CHECK(IsCompatible(other)) << "Filters of different sizes or hash functions";
+    CombineBytes(data_, other.data_, byte_size_, OrOp());
+    num_inserts_ += other.num_inserts_;
+}
+
+void BloomFilter::Intersect(const BloomFilter& other) {
+    CHECK(!IsReadOnly()) << "Intersect() into a filter mapped from a file";
+    CHECK(IsCompatible(other)) << "Filters of different sizes or hash functions";
+    CombineBytes(data_, other.data_, byte_size_, AndOp());
+    num_inserts_ = std::min(num_inserts_, other.num_inserts_);
+}
+
+bool BloomFilter::UnionWithFile(const std::string& path) {
+    std::unique_ptr<BloomFilter> other = MapFromFile(path);
+    if (other == nullptr)
+        return false;
+    if (!IsCompatible(*other)) {
+        LOG(ERROR) << path << " has a filter of a different size or hash functions";
+        return false;
+    }
+    Union(*other);
+    return true;
+}
+
+double BloomFilter::EstimateNumElements() const {
+    int64 num_set = 0;
+    int64 i = 0;
+    for (; i + 8 <= byte_size_; i += 8) {
+        uint64 word;
+        memcpy(&word, data_ + i, 8);
+        num_set += __builtin_popcountll(word);
+    }
+    for (; i < byte_size_; ++i)
+        num_set += __builtin_popcount(data_[i]);
+    if (num_set == bit_size_)
+        return std::numeric_limits<double>::infinity();
+    return -(bit_size_ * 1. / hash_keys_.size()) * std::log1p(-num_set * 1. / bit_size_);
+}
+
+void BloomFilter::Prefetch(uint64 key, int max_hashes) const {
+    BitPositions positions(*this, key);
+    for (int64 i = 0; i < std::min<int64>(hash_keys_.size(), max_hashes); ++i)
+        __builtin_prefetch(data_ + positions[i] / 8);
+}
+
 void BloomFilter::Clear() {
+    CHECK(!IsReadOnly()) << "Clear() of a filter mapped from a file";
     memset(data_, 0, byte_size_);
     num_inserts_ = 0;
 }
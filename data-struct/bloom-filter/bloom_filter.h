@@ -11,15 +11,34 @@
 
 namespace cpp_base {
 
+class ThreadPool;
+
 // Bloom Filter works as an approximate set. Items can be inserted and
 // looked up, but not removed. This class is *not* thread-safe.
 class BloomFilter {
   public:
+    // How the bit positions of a key are computed, for each of the k hash functions.
+    enum Indexing {
+        // A separately seeded 64-bit hash per function, reduced by modulo.
+        kSeededHashes = 0,
+        // Kirsch-Mitzenmacher double hashing: the i-th position is derived from h1 + i * h2,
+        // where h1 and h2 are the two halves of one 128-bit hash, and reduced by multiply-shift
+        // rather than modulo. This takes one hash and no division per key, for the same false
+        // positive rate (see IndexingBenchmark in bloom_filter_benchmark.cc).
+        kDoubleHashing = 1,
+        // All the bits of a key in one 16-byte block, one in each of its eight 16-bit words,
+        // from a single hash: one cache miss per operation, for a higher false positive rate,
+        // e.g., 1.7% vs 0.8% at 10 bits per key. Always 8 hash functions, and the size is rounded
+        // up to whole blocks. This is the layout of CountingBloomFilter::ToBloomFilter().
+        kBlocked = 2,
+    };
+
     // Constructs an empty filter with the given size. The expected number of
     // elements is used to figure out the optimal number of hash functions.
     // If the actual number of elements deviates from this value, the bloom
     // filter doesn't break; it just becomes sub-optimal.
-    BloomFilter(int64 bit_size, int64 expected_num_elements);
+    BloomFilter(int64 bit_size, int64 expected_num_elements,
+                Indexing indexing = kSeededHashes);
 
     ~BloomFilter();
 
@@ -29,19 +48,111 @@ class BloomFilter {
     // Returns whether the given key exists in the filter.
     bool Contains(uint64 key) const;
 
+    // Batched versions of Insert() and Contains(), for when many keys are at hand: they hash a
+    // group of keys first and prefetch all the bytes they touch, then test or set them, so the
+    // cache misses of the group overlap rather than stall one after another. Sets 'results[i]'
+    // to what Insert(keys[i]) or Contains(keys[i]) would return; 'results' may be null for
+    // InsertBatch(), which returns the number of keys actually inserted.
+    int64 InsertBatch(const uint64* keys, int64 num_keys, bool* results = nullptr);
+    void ContainsBatch(const uint64* keys, int64 num_keys, bool* results) const;
+
+    // Inserts the given keys using 'num_tasks' tasks on 'pool', whose workers must be started.
+    // The keys are processed in rounds. First each task hashes its share of the keys of the
+    // round and buckets the resulting bit positions by region of the bit vector; then each task
+    // sets the bits of one region, so the tasks write disjoint memory, with no locking nor
+    // per-task copies of the filter. Same result as calling Insert() on each key.
+    void InsertInParallel(const uint64* keys, int64 num_keys, ThreadPool* pool, int num_tasks);
+
+    // Whether the given filter has the same size, hash functions and indexing as this one, which is
+    // needed for the operations below.
+    bool IsCompatible(const BloomFilter& other) const;
+
+    // Sets this filter to the union of it and the given compatible one: the filter a single
+    // filter would have with both sets of keys inserted. NumElements() becomes the sum of both,
+    // i.e., counts keys in both twice.
+    void Union(const BloomFilter& other);
+
+    // Sets this filter to the bitwise intersection of it and the given compatible one. This is
+    // a superset of the filter of the keys in both sets: it has no false negatives for them,
+    // but more false positives. NumElements() becomes the smaller of both.
+    void Intersect(const BloomFilter& other);
+
+    // Unions the filter in the given file, saved with SaveToFile() from a compatible filter, e.g.,
+    // built on another machine. Returns false if the file cannot be read or is incompatible.
+    bool UnionWithFile(const std::string& path);
+
+    // Estimates the number of distinct keys inserted, from the fraction of bits set
+    // (Swamidass & Baldi, 2007). Unlike NumElements(), this ignores duplicate insertions and is
+    // meaningful after Union(). Returns infinity if all bits are set.
+    double EstimateNumElements() const;
+
+    // Prefetches the bytes of the given key into the cache, ahead of an Insert() or Contains(),
+    // for the first 'max_hashes' hash functions only if given: those are the ones a Contains() of
+    // an absent key most likely stops at.
+    void Prefetch(uint64 key, int max_hashes = 8) const;
+
     // Clears the filter.
     void Clear();
 
     const uint8* RawData() const { return data_; }
     int64 BitSize() const { return bit_size_; }
+    Indexing GetIndexing() const { return indexing_; }
     int64 NumElements() const { return num_inserts_; }
+    int NumHashes() const { return hash_keys_.size(); }
+
+    // Saves the filter to the given file: a versioned header of one page, with the sizes and hash
+    // keys, followed by the bit vector as is. Returns false on I/O error.
+    bool SaveToFile(const std::string& path) const;
+
+    // Loads a filter saved by SaveToFile() into memory, for further insertions. Returns null if
+    // the file cannot be read or is not such a filter.
+    static std::unique_ptr<BloomFilter> LoadFromFile(const std::string& path);
 
-    void SaveToFile(const std::string& path) { /*TODO(kianoosh)*/ }
-    void LoadFromFile(const std::string& path) { /*TODO(kianoosh)*/ }
+    // Like LoadFromFile(), but maps the file read-only rather than copying it: opening is O(1)
+    // regardless of the filter size, pages are read on demand, and all the processes mapping the
+    // same file share one copy of it in the page cache. The filter is read-only: Insert() and
+    // Clear() on it CHECK-fail. The file must not be modified while mapped.
+    static std::unique_ptr<BloomFilter> MapFromFile(const std::string& path);
+
+    // Whether the filter is mapped from a file by MapFromFile().
+    bool IsReadOnly() const { return mapping_size_ > 0; }
 
     static inline bool IsPowerOf2(int64 x) { return (x & (x - 1)) == 0 || x == 1; }
 
+    // Max number of keys hashed and prefetched at once by the batched calls.
+    static const int kBatchSize = 16;
+
+    // Number of keys hashed by each task in a round of InsertInParallel().
+    static const int kKeysPerTask = 1 << 16;
+
+    // Size of a block with kBlocked indexing.
+    static const int kBlockBits = 128;
+
+    // With kBlocked indexing, the bit of a key in word i of its block, out of the 16, given the
+    // hash of the key: the i-th 4 bits of its low 32 bits, the high ones giving the block.
+    static inline int BlockedWordPosition(uint64 hash, int i) {
+        return (hash >> (4 * i)) & 0xF;
+    }
+
   private:
+    // Constructs a filter over the given bit vector, as read from a file, which is either
+    // allocated with new[] or, if 'mapping_size' is positive, mapped with mmap().
+    BloomFilter(int64 bit_size, int64 expected_num_elements, int64 num_inserts,
+                std::vector<uint64> hash_keys, Indexing indexing, uint8* data,
+                int64 mapping_size);
+
+    // The bit positions of a key, one per hash function, computed on demand.
+    class BitPositions;
+
+    // Maps the given file and checks its header. Returns null on failure.
+    static std::unique_ptr<BloomFilter> OpenFile(const std::string& path);
+
+    // Sets 'byte_indices' and 'bit_masks' to the bytes and bits of the given key, one per hash.
+    inline void GetBits(uint64 key, int64* byte_indices, uint8* bit_masks) const;
+
+    // Counts an insertion, warning if the filter is over-used.
+    inline void CountInsert();
+
     const int64 byte_size_;         // Size in bytes
     const int64 bit_size_;          // Size in bits
     uint8* data_;                   // The underlying bit vector
@@ -51,8 +162,16 @@ class BloomFilter {
     const int64 expected_num_elements_;
     int64 log_regulator_ = 0;
 
-    // Random keys used for hashing.
+    // Random keys used for hashing. With kDoubleHashing or kBlocked, only the first one is used,
+    // but there are still as many as hash functions.
     std::vector<uint64> hash_keys_;
+    const Indexing indexing_;
+
+    // The size of the file mapping of 'data_' if mapped, 0 otherwise.
+    int64 mapping_size_ = 0;
+
+    // Builds its snapshots with the private constructor.
+    friend class CountingBloomFilter;
 
     DISALLOW_COPY_AND_ASSIGN(BloomFilter);
 };
@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/file/file.h"
+#include "cpp-base/file/temp_file_test_util.h"
+#include "cpp-base/thread/threadpool.h"
+
+using cpp_base::BloomFilter;
+using cpp_base::File;
+using cpp_base::TempFile;
+using cpp_base::ThreadPool;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+class BloomFilterTest : public ::testing::Test {
+  public:
+    BloomFilterTest() { }
+    ~BloomFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    // Returns the time per key of running the given function on 'num_keys' keys.
+    static double NanosPerKey(int64 num_keys, const std::function<void()>& f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / num_keys;
+    }
+};
+
+TEST_F(BloomFilterTest, BatchBenchmark) {
+    // 512 MB, larger than the last-level cache, so nearly every probe misses the cache.
+    const int64 kBitSize = 1LL << 32;
+    const int64 kNumKeys = 8000000;
+    const int64 kBatch = 1024;
+    BloomFilter bf(kBitSize, kBitSize / 10);
+    std::mt19937_64 rand_gen(1);
+    vector<uint64> keys(2 * kNumKeys);  // The first half inserted, the second half not
+    for (uint64& key : keys)
+        key = rand_gen();
+    const uint64* present = keys.data();
+    const uint64* absent = keys.data() + kNumKeys;
+    bool batch_results[kBatch];
+
+    const int64 half = kNumKeys / 2;
+    double insert_ns = NanosPerKey(half, [&] {
+        for (int64 i = 0; i < half; ++i)
+            bf.Insert(present[i]);
+    });
+    double batch_insert_ns = NanosPerKey(half, [&] {
+        for (int64 i = half; i < kNumKeys; i += kBatch)
+            bf.InsertBatch(present + i, std::min(kBatch, kNumKeys - i));
+    });
+    for (const uint64* probe : {present, absent}) {
+        int64 num_found = 0;
+        double ns = NanosPerKey(kNumKeys, [&] {
+            for (int64 i = 0; i < kNumKeys; ++i)
+                num_found += bf.Contains(probe[i]);
+        });
+        int64 num_batch_found = 0;
+        double batch_ns = NanosPerKey(kNumKeys, [&] {
+            for (int64 i = 0; i < kNumKeys; i += kBatch) {
+                const int64 n = std::min(kBatch, kNumKeys - i);
+                bf.ContainsBatch(probe + i, n, batch_results);
+                num_batch_found += std::count(batch_results, batch_results + n, true);
+            }
+        });
+        EXPECT_EQ(num_found, num_batch_found);
+        LOG(INFO) << "Contains() of " << (probe == present ? "present" : "absent") << " keys: "
+                  << ns << " ns/key; ContainsBatch(): " << batch_ns << " ns/key";
+    }
+    LOG(INFO) << "Insert(): " << insert_ns << " ns/key; InsertBatch(): " << batch_insert_ns
+              << " ns/key, into a filter of " << kBitSize / 8 / 1024 / 1024 << " MB";
+}
+
+TEST_F(BloomFilterTest, FileBenchmark) {
+    // Rebuilding from the keys vs. loading vs. mapping a 512 MB filter.
+    const int64 kBitSize = 1LL << 32;
+    const int64 kNumKeys = 20000000;
+    const string path = TempFile("bloom_filter_benchmark.bf");
+    std::mt19937_64 rand_gen(1);
+    vector<uint64> keys(kNumKeys);
+    for (uint64& key : keys)
+        key = rand_gen();
+
+    BloomFilter bf(kBitSize, kNumKeys * 10);
+    const double build_ms = NanosPerKey(1e6, [&] { bf.InsertBatch(keys.data(), kNumKeys); });
+    const double save_ms = NanosPerKey(1e6, [&] { ASSERT_TRUE(bf.SaveToFile(path)); });
+    LOG(INFO) << "Filter of " << kBitSize / 8 / 1024 / 1024 << " MB: built from "
+              << kNumKeys << " keys in " << build_ms << " ms, saved in " << save_ms << " ms";
+
+    // The file is in the page cache by now, so this excludes disk reads.
+    unique_ptr<BloomFilter> loaded, mapped;
+    const double load_ms = NanosPerKey(1e6, [&] { loaded = BloomFilter::LoadFromFile(path); });
+    const double map_ms = NanosPerKey(1e6, [&] { mapped = BloomFilter::MapFromFile(path); });
+    ASSERT_TRUE(loaded != nullptr);
+    ASSERT_TRUE(mapped != nullptr);
+
+    // Lookups in the mapping fault its pages in, on first touch.
+    const int64 kNumLookups = 1000000;
+    int64 num_found = 0;
+    const double first_ns = NanosPerKey(kNumLookups, [&] {
+        for (int64 i = 0; i < kNumLookups; ++i)
+            num_found += mapped->Contains(keys[i]);
+    });
+    const double second_ns = NanosPerKey(kNumLookups, [&] {
+        for (int64 i = 0; i < kNumLookups; ++i)
+            num_found += mapped->Contains(keys[i]);
+    });
+    const double loaded_ns = NanosPerKey(kNumLookups, [&] {
+        for (int64 i = 0; i < kNumLookups; ++i)
+            num_found += loaded->Contains(keys[i]);
+    });
+    EXPECT_EQ(3 * kNumLookups, num_found);
+    LOG(INFO) << "LoadFromFile(): " << load_ms << " ms; MapFromFile(): " << map_ms << " ms";
+    LOG(INFO) << "Contains() on the mapped filter: " << first_ns << " ns/key first, "
+              << second_ns << " ns/key then; on the loaded one: " << loaded_ns << " ns/key";
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
+
+TEST_F(BloomFilterTest, ParallelBenchmark) {
+    const int64 kBitSize = 1LL << 32;  // 512 MB
+    const int64 kNumKeys = 20000000;
+    std::mt19937_64 rand_gen(1);
+    vector<uint64> keys(kNumKeys);
+    for (uint64& key : keys)
+        key = rand_gen();
+
+    BloomFilter bf(kBitSize, kNumKeys * 10);
+    LOG(INFO) << "Insert(): " << NanosPerKey(kNumKeys, [&] {
+        for (uint64 key : keys)
+            bf.Insert(key);
+    }) << " ns/key";
+    for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+        ThreadPool pool(num_threads);
+        pool.StartWorkers();
+        BloomFilter parallel_bf(kBitSize, kNumKeys * 10);
+        LOG(INFO) << "InsertInParallel() with " << num_threads << " threads: " << NanosPerKey(
+                kNumKeys, [&] {
+            parallel_bf.InsertInParallel(keys.data(), kNumKeys, &pool, num_threads);
+        }) << " ns/key";
+        EXPECT_EQ(0, memcmp(bf.RawData(), parallel_bf.RawData(), kBitSize / 8));
+    }
+
+    BloomFilter other(kBitSize, kNumKeys * 10);
+    const double union_ms = NanosPerKey(1e6, [&] { other.Union(bf); });
+    const double intersect_ms = NanosPerKey(1e6, [&] { other.Intersect(bf); });
+    double estimate = 0;
+    const double estimate_ms = NanosPerKey(1e6, [&] { estimate = bf.EstimateNumElements(); });
+    LOG(INFO) << "On " << kBitSize / 8 / 1024 / 1024 << " MB: Union(): " << union_ms
+              << " ms, Intersect(): " << intersect_ms << " ms, EstimateNumElements(): "
+              << estimate_ms << " ms, estimating " << estimate << " for " << kNumKeys << " keys";
+    EXPECT_NEAR(kNumKeys, estimate, kNumKeys * 0.01);
+}
+
+TEST_F(BloomFilterTest, IndexingBenchmark) {
+    // False positive ratio of the indexing modes vs. memory, and the time per operation on a
+    // filter in cache and on one much larger than it.
+    const int64 kNumKeys = 1000000;
+    std::mt19937_64 rand_gen(1);
+    vector<uint64> keys(2 * kNumKeys);  // The first half inserted, the second half not
+    for (uint64& key : keys)
+        key = rand_gen();
+    for (int64 bits_per_key : {4, 6, 8, 10, 12, 16, 20}) {
+        double fp[3];
+        for (BloomFilter::Indexing indexing : {BloomFilter::kSeededHashes,
+                                               BloomFilter::kDoubleHashing,
+                                               BloomFilter::kBlocked}) {
+            BloomFilter bf(kNumKeys * bits_per_key, kNumKeys, indexing);
+            for (int64 i = 0; i < kNumKeys; ++i)
+                bf.Insert(keys[i]);
+            int64 num_false_positives = 0;
+            for (int64 i = kNumKeys; i < 2 * kNumKeys; ++i)
+                num_false_positives += bf.Contains(keys[i]);
+            fp[indexing] = num_false_positives * 1. / kNumKeys;
+        }
+        LOG(INFO) << bits_per_key << " bits/key: false positives " << fp[0] * 100
+                  << "% with seeded hashes, " << fp[1] * 100 << "% with double hashing, "
+                  << fp[2] * 100 << "% blocked";
+        EXPECT_LT(fp[1], fp[0] * 1.1 + 20. / kNumKeys);
+    }
+
+    for (int64 bits_per_key : {10, 1000}) {  // 1.2 MB and 120 MB
+        for (BloomFilter::Indexing indexing : {BloomFilter::kSeededHashes,
+                                               BloomFilter::kDoubleHashing,
+                                               BloomFilter::kBlocked}) {
+            BloomFilter bf(kNumKeys * bits_per_key, kNumKeys, indexing);
+            const double insert_ns = NanosPerKey(kNumKeys, [&] {
+                for (int64 i = 0; i < kNumKeys; ++i)
+                    bf.Insert(keys[i]);
+            });
+            int64 num_found = 0;
+            const double hit_ns = NanosPerKey(kNumKeys, [&] {
+                for (int64 i = 0; i < kNumKeys; ++i)
+                    num_found += bf.Contains(keys[i]);
+            });
+            const double miss_ns = NanosPerKey(kNumKeys, [&] {
+                for (int64 i = kNumKeys; i < 2 * kNumKeys; ++i)
+                    num_found += bf.Contains(keys[i]);
+            });
+            EXPECT_GE(num_found, kNumKeys);
+            const char* const kNames[] = {"Seeded hashes", "Double hashing", "Blocked"};
+            LOG(INFO) << kNames[indexing] << " on " << bf.BitSize() / 8 / 1024 << " KB: "
+                      << insert_ns << " ns/insert, " << hit_ns << " ns/hit, " << miss_ns
+                      << " ns/miss";
+        }
+    }
+}
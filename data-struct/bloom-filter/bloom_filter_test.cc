@@ -1,13 +1,29 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cmath>
+#include <memory>
+#include <random>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/file/file.h"
+#include "cpp-base/file/file_output_stream.h"
+#include "cpp-base/file/temp_file_test_util.h"
+#include "cpp-base/thread/threadpool.h"
 #include "cpp-base/util/map_util.h"
 
 using cpp_base::BloomFilter;
 using cpp_base::ContainsKey;
+using cpp_base::File;
+using cpp_base::FileOutputStream;
+using cpp_base::TempFile;
+using cpp_base::ThreadPool;
+using std::string;
+using std::unique_ptr;
+using std::vector;
 
 class BloomFilterTest : public ::testing::Test {
   public:
@@ -65,3 +81,277 @@ TEST_F(BloomFilterTest, StatisticalTest) {
     LOG(INFO) << "False positive ratio: " << fp << "%";
     CHECK_LT(fp, 10);
 }
+
+TEST_F(BloomFilterTest, BatchTest) {
+    BloomFilter bf(10000, 1000);
+    BloomFilter batch_bf(10000, 1000);
+    vector<uint64> keys;
+    for (int i = 0; i < 3000; ++i)
+        keys.push_back(rand() % 2000);  // NOLINT; with duplicates, also within a batch
+
+    // Same results as one by one, and the very same bits.
+    bool results[1000];
+    const int64 num_inserted = batch_bf.InsertBatch(keys.data(), 1000, results);
+    EXPECT_EQ(num_inserted, std::count(results, results + 1000, true));
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(bf.Insert(keys[i]), results[i]) << i;
+    EXPECT_EQ(batch_bf.NumElements(), bf.NumElements());
+    EXPECT_EQ(0, memcmp(bf.RawData(), batch_bf.RawData(), bf.BitSize() / 8));
+
+    // Sizes that are not a multiple of the batch size.
+    for (int64 n : {0, 1, 17, 3000}) {
+        bool contains[3000];
+        batch_bf.ContainsBatch(keys.data(), n, contains);
+        for (int i = 0; i < n; ++i)
+            EXPECT_EQ(bf.Contains(keys[i]), contains[i]) << i;
+    }
+    batch_bf.InsertBatch(keys.data() + 1000, 2000);
+    for (int i = 0; i < keys.size(); ++i)
+        EXPECT_TRUE(batch_bf.Contains(keys[i]));
+}
+
+TEST_F(BloomFilterTest, SaveAndLoadTest) {
+    const string path = TempFile("bloom_filter_test.bf");
+    for (int64 bit_size : {8, 1000, 12345, 1000000}) {
+        BloomFilter bf(bit_size, 1000);
+        for (int i = 0; i < 1000; ++i)
+            bf.Insert(rand());  // NOLINT
+        ASSERT_TRUE(bf.SaveToFile(path));
+
+        unique_ptr<BloomFilter> loaded = BloomFilter::LoadFromFile(path);
+        unique_ptr<BloomFilter> mapped = BloomFilter::MapFromFile(path);
+        ASSERT_TRUE(loaded != nullptr);
+        ASSERT_TRUE(mapped != nullptr);
+        EXPECT_FALSE(loaded->IsReadOnly());
+        EXPECT_TRUE(mapped->IsReadOnly());
+        for (const BloomFilter* other : {loaded.get(), mapped.get()}) {
+            EXPECT_EQ(bf.BitSize(), other->BitSize());
+            EXPECT_EQ(bf.NumElements(), other->NumElements());
+            EXPECT_EQ(0, memcmp(bf.RawData(), other->RawData(), bf.BitSize() / 8));
+        }
+
+        // Answers identically, including false positives.
+        vector<uint64> keys;
+        for (int i = 0; i < 10000; ++i)
+            keys.push_back(rand());  // NOLINT
+        bool results[10000];
+        mapped->ContainsBatch(keys.data(), keys.size(), results);
+        for (int i = 0; i < keys.size(); ++i) {
+            EXPECT_EQ(bf.Contains(keys[i]), loaded->Contains(keys[i]));
+            EXPECT_EQ(bf.Contains(keys[i]), mapped->Contains(keys[i]));
+            EXPECT_EQ(bf.Contains(keys[i]), results[i]);
+        }
+
+        // The loaded copy is independent of the file, and takes more keys just the same.
+        for (int i = 0; i < 100; ++i)
+            EXPECT_EQ(bf.Insert(keys[i]), loaded->Insert(keys[i]));
+        EXPECT_EQ(0, memcmp(bf.RawData(), loaded->RawData(), bf.BitSize() / 8));
+        EXPECT_EQ(bf.NumElements(), loaded->NumElements());
+    }
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
+
+TEST_F(BloomFilterTest, LoadMalformedFileTest) {
+    const string path = TempFile("bloom_filter_test.bf");
+    EXPECT_TRUE(BloomFilter::LoadFromFile(path + ".absent") == nullptr);
+
+    BloomFilter bf(100000, 1000);
+    bf.Insert(25);
+    ASSERT_TRUE(bf.SaveToFile(path));
+    const int32 size = File::Size(path.c_str());
+
+    // Truncated, or not a filter at all.
+    unique_ptr<File> file(File::Open(path.c_str(), "r"));
+    string contents(size, 0);
+    ASSERT_EQ(size, file->Read(&contents[0], size));
+    file.reset();
+    for (const string& bad : {contents.substr(0, size - 1), contents.substr(0, 100),
+                              string(size, 'x')}) {
+        unique_ptr<FileOutputStream> out(FileOutputStream::OpenOrDie(path.c_str()));
+        out->WriteOrDie(bad);
+        ASSERT_TRUE(out->Close());
+        EXPECT_TRUE(BloomFilter::LoadFromFile(path) == nullptr);
+        EXPECT_TRUE(BloomFilter::MapFromFile(path) == nullptr);
+    }
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
+
+TEST_F(BloomFilterTest, UnionAndIntersectTest) {
+    // Sizes with a tail that is not a multiple of a word nor of 32 bytes.
+    for (int64 bit_size : {8, 1000, 12344, 100000}) {
+        BloomFilter a(bit_size, 1000), b(bit_size, 1000), both(bit_size, 1000);
+        BloomFilter a_and_b(bit_size, 1000);
+        vector<uint64> keys;
+        for (int i = 0; i < 2000; ++i)
+            keys.push_back(rand());  // NOLINT
+        for (int i = 0; i < 1500; ++i)
+            a.Insert(keys[i]);
+        for (int i = 500; i < 2000; ++i)
+            b.Insert(keys[i]);
+        for (int i = 0; i < 2000; ++i)
+            both.Insert(keys[i]);
+        for (int i = 500; i < 1500; ++i)
+            a_and_b.Insert(keys[i]);
+
+        BloomFilter intersection(bit_size, 1000);
+        intersection.Union(a);
+        intersection.Intersect(b);
+        for (int i = 500; i < 1500; ++i)
+            EXPECT_TRUE(intersection.Contains(keys[i]));
+        for (int64 byte = 0; byte < bit_size / 8; ++byte) {
+            // A superset of the filter of the common keys.
+            EXPECT_EQ(a_and_b.RawData()[byte],
+                      a_and_b.RawData()[byte] & intersection.RawData()[byte]);
+        }
+        EXPECT_EQ(1500, intersection.NumElements());  // The smaller count, an upper bound
+
+        a.Union(b);
+        EXPECT_EQ(0, memcmp(a.RawData(), both.RawData(), bit_size / 8));
+        EXPECT_EQ(3000, a.NumElements());
+        EXPECT_TRUE(a.IsCompatible(both));
+    }
+    EXPECT_FALSE(BloomFilter(1000, 100).IsCompatible(BloomFilter(1008, 100)));
+    EXPECT_FALSE(BloomFilter(1000, 100).IsCompatible(BloomFilter(1000, 200)));  // Fewer hashes
+}
+
+TEST_F(BloomFilterTest, UnionWithFileTest) {
+    const string path = TempFile("bloom_filter_test.bf");
+    BloomFilter a(100000, 10000), b(100000, 10000), both(100000, 10000);
+    for (int i = 0; i < 20000; ++i) {
+        uint64 key = rand();  // NOLINT
+        (i % 2 ? a : b).Insert(key);
+        both.Insert(key);
+    }
+    ASSERT_TRUE(b.SaveToFile(path));
+    EXPECT_TRUE(a.UnionWithFile(path));
+    EXPECT_EQ(0, memcmp(a.RawData(), both.RawData(), a.BitSize() / 8));
+
+    BloomFilter incompatible(100000, 1000);
+    ASSERT_TRUE(incompatible.SaveToFile(path));
+    EXPECT_FALSE(a.UnionWithFile(path));
+    EXPECT_FALSE(a.UnionWithFile(path + ".absent"));
+    EXPECT_EQ(0, memcmp(a.RawData(), both.RawData(), a.BitSize() / 8));
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
+
+TEST_F(BloomFilterTest, EstimateNumElementsTest) {
+    BloomFilter bf(1000000, 100000);
+    EXPECT_EQ(0, bf.EstimateNumElements());
+    for (int64 n : {1000, 10000, 100000, 300000}) {
+        bf.Clear();
+        for (int64 i = 0; i < n; ++i) {
+            bf.Insert(i);
+            bf.Insert(i);  // Duplicates are not counted
+        }
+        EXPECT_NEAR(n, bf.EstimateNumElements(), n * 0.02);
+    }
+}
+
+TEST_F(BloomFilterTest, InsertInParallelTest) {
+    ThreadPool pool(4);
+    pool.StartWorkers();
+    vector<uint64> keys;
+    for (int i = 0; i < 300000; ++i)
+        keys.push_back(rand());  // NOLINT
+    BloomFilter bf(1000000, 100000);
+    for (uint64 key : keys)
+        bf.Insert(key);
+    for (int num_tasks : {1, 3, 4, 8}) {
+        BloomFilter parallel_bf(1000000, 100000);
+        parallel_bf.InsertInParallel(keys.data(), keys.size(), &pool, num_tasks);
+        EXPECT_EQ(0, memcmp(bf.RawData(), parallel_bf.RawData(), bf.BitSize() / 8));
+        EXPECT_EQ(bf.NumElements(), parallel_bf.NumElements());
+    }
+    BloomFilter tiny_bf(8, 1);
+    tiny_bf.InsertInParallel(keys.data(), 100, &pool, 4);
+    tiny_bf.InsertInParallel(keys.data(), 0, &pool, 4);
+    EXPECT_TRUE(tiny_bf.Contains(keys[99]));
+}
+
+TEST_F(BloomFilterTest, DoubleHashingTest) {
+    BloomFilter bf(1000, 100, BloomFilter::kDoubleHashing);
+    EXPECT_EQ(BloomFilter::kDoubleHashing, bf.GetIndexing());
+    EXPECT_FALSE(bf.Contains(25));
+    EXPECT_TRUE(bf.Insert(25));
+    EXPECT_TRUE(bf.Contains(25));
+    EXPECT_FALSE(bf.Contains(35));
+    EXPECT_FALSE(bf.Insert(25));
+    EXPECT_FALSE(bf.IsCompatible(BloomFilter(1000, 100)));
+
+    // The batched, parallel and file paths index the same way.
+    vector<uint64> keys;
+    for (int i = 0; i < 20000; ++i)
+        keys.push_back(rand());  // NOLINT
+    BloomFilter batch_bf(100000, 10000, BloomFilter::kDoubleHashing);
+    BloomFilter parallel_bf(100000, 10000, BloomFilter::kDoubleHashing);
+    BloomFilter single_bf(100000, 10000, BloomFilter::kDoubleHashing);
+    batch_bf.InsertBatch(keys.data(), 10000);
+    ThreadPool pool(2);
+    pool.StartWorkers();
+    parallel_bf.InsertInParallel(keys.data(), 10000, &pool, 3);
+    for (int i = 0; i < 10000; ++i)
+        single_bf.Insert(keys[i]);
+    EXPECT_EQ(0, memcmp(single_bf.RawData(), batch_bf.RawData(), single_bf.BitSize() / 8));
+    EXPECT_EQ(0, memcmp(single_bf.RawData(), parallel_bf.RawData(), single_bf.BitSize() / 8));
+
+    const string path = TempFile("bloom_filter_test.bf");
+    ASSERT_TRUE(single_bf.SaveToFile(path));
+    unique_ptr<BloomFilter> mapped = BloomFilter::MapFromFile(path);
+    ASSERT_TRUE(mapped != nullptr);
+    EXPECT_EQ(BloomFilter::kDoubleHashing, mapped->GetIndexing());
+    bool results[20000];
+    mapped->ContainsBatch(keys.data(), keys.size(), results);
+    for (int i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(single_bf.Contains(keys[i]), results[i]);
+        EXPECT_EQ(single_bf.Contains(keys[i]), mapped->Contains(keys[i]));
+    }
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
+
+TEST_F(BloomFilterTest, BlockedIndexingTest) {
+    BloomFilter bf(1000, 100, BloomFilter::kBlocked);
+    EXPECT_EQ(1024, bf.BitSize());  // Whole blocks
+    EXPECT_EQ(8, bf.NumHashes());
+    EXPECT_TRUE(bf.Insert(25));
+    EXPECT_TRUE(bf.Contains(25));
+    EXPECT_FALSE(bf.Contains(35));
+    EXPECT_FALSE(bf.Insert(25));
+
+    // Exactly 8 bits are set, in one 16-byte block, one per 16-bit word.
+    int num_bits = 0;
+    int block = -1;
+    for (int i = 0; i < bf.BitSize() / 8; ++i) {
+        if (bf.RawData()[i] != 0 && block < 0)
+            block = i / 16;
+        num_bits += __builtin_popcount(bf.RawData()[i]);
+    }
+    EXPECT_EQ(8, num_bits);
+    const uint8* words = bf.RawData() + block * 16;
+    for (int i = 0; i < 8; ++i)
+        EXPECT_EQ(1, __builtin_popcount(words[2 * i] | words[2 * i + 1] << 8)) << i;
+
+    // The batched, parallel and file paths index the same way.
+    vector<uint64> keys;
+    for (int i = 0; i < 20000; ++i)
+        keys.push_back(rand());  // NOLINT
+    BloomFilter batch_bf(100000, 10000, BloomFilter::kBlocked);
+    BloomFilter parallel_bf(100000, 10000, BloomFilter::kBlocked);
+    BloomFilter single_bf(100000, 10000, BloomFilter::kBlocked);
+    batch_bf.InsertBatch(keys.data(), 10000);
+    ThreadPool pool(2);
+    pool.StartWorkers();
+    parallel_bf.InsertInParallel(keys.data(), 10000, &pool, 3);
+    for (int i = 0; i < 10000; ++i)
+        single_bf.Insert(keys[i]);
+    EXPECT_EQ(0, memcmp(single_bf.RawData(), batch_bf.RawData(), single_bf.BitSize() / 8));
+    EXPECT_EQ(0, memcmp(single_bf.RawData(), parallel_bf.RawData(), single_bf.BitSize() / 8));
+
+    const string path = TempFile("bloom_filter_test.bf");
+    ASSERT_TRUE(single_bf.SaveToFile(path));
+    unique_ptr<BloomFilter> loaded = BloomFilter::LoadFromFile(path);
+    ASSERT_TRUE(loaded != nullptr);
+    EXPECT_TRUE(loaded->IsCompatible(single_bf));
+    for (uint64 key : keys)
+        EXPECT_EQ(single_bf.Contains(key), loaded->Contains(key));
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
@@ -0,0 +1,103 @@
+#include "cpp-base/data-struct/bloom-filter/concurrent_bloom_filter.h"
+
+#include <glog/logging.h>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <thread>
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/hash/hash.h"
+
+namespace cpp_base {
+
+namespace {
+
+// The counter shard of the calling thread.
+int ThisThreadShard() {
+    static thread_local const int shard =
+            std::hash<std::thread::id>()(std::this_thread::get_id()) %
+            ConcurrentBloomFilter::kNumCounterShards;
+    return shard;
+}
+
+}  // namespace
+
+ConcurrentBloomFilter::ConcurrentBloomFilter(int64 bit_size, int64 expected_num_elements)
+        : bit_size_(((bit_size - 1) / 8 + 1) * 8),
+          num_words_((bit_size_ - 1) / 64 + 1),
+          expected_num_elements_(expected_num_elements) {
+    words_ = new std::atomic<uint64>[num_words_];
+    Clear();
+
+    // Same hash functions as BloomFilter.
+    int64 num_hashes = std::round(bit_size_ * 1. / expected_num_elements * std::log(2));
+    if (num_hashes == 0)
+        num_hashes = 1;
+    else if (num_hashes > 8)
+        num_hashes = 8;
+
+    std::mt19937_64 rand_gen(1000);
+    for (int64 i = 0; i < num_hashes; ++i)
+        hash_keys_.push_back(rand_gen());
+}
+
+ConcurrentBloomFilter::~ConcurrentBloomFilter() {
+    delete[] words_;
+}
+
+bool ConcurrentBloomFilter::Insert(uint64 key) {
+    bool inserted = false;
+    for (int64 i = 0; i < hash_keys_.size(); ++i) {
+        uint64 mix = Hash64NumWithSeed(key, hash_keys_[i]);
+        int64 index = mix % bit_size_;
+        std::atomic<uint64>& word = words_[index / 64];
+        const uint64 mask = 1ULL << (index % 64);
+        // Read first: if the bit is set already, which is the common case for hot keys, do not
+        // take the cache line exclusive.
+        if ((word.load(std::memory_order_relaxed) & mask) == 0 &&
+            (word.fetch_or(mask, std::memory_order_relaxed) & mask) == 0) {
+            inserted = true;
+        }
+    }
+
+    // If we went beyond the expected size, log a warning, but only at a regulated rate: when the
+    // count of this thread's shard hits a power of 2.
+    const int64 shard_count =
+            counters_[ThisThreadShard()].count.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (BloomFilter::IsPowerOf2(shard_count) && shard_count * kNumCounterShards >
+                                                expected_num_elements_) {
+        const int64 num_inserts = NumElements();
+        if (num_inserts > expected_num_elements_) {
+            LOG(WARNING) << "BF insertions (" << num_inserts << ") exceeded the expected maximum ("
+                         << expected_num_elements_ << "). Accuracy will degrade. Need more memory.";
+        }
+    }
+
+    return inserted;
+}
+
+bool ConcurrentBloomFilter::Contains(uint64 key) const {
+    for (int64 i = 0; i < hash_keys_.size(); ++i) {
+        uint64 mix = Hash64NumWithSeed(key, hash_keys_[i]);
+        int64 index = mix % bit_size_;
+        if (!(words_[index / 64].load(std::memory_order_relaxed) & (1ULL << (index % 64))))
+            return false;
+    }
+    return true;
+}
+
+void ConcurrentBloomFilter::Clear() {
+    for (int64 i = 0; i < num_words_; ++i)
+        words_[i].store(0, std::memory_order_relaxed);
+    for (CounterShard& counter : counters_)
+        counter.count.store(0, std::memory_order_relaxed);
+}
+
+int64 ConcurrentBloomFilter::NumElements() const {
+    int64 sum = 0;
+    for (const CounterShard& counter : counters_)
+        sum += counter.count.load(std::memory_order_relaxed);
+    return sum;
+}
+
+}  // namespace cpp_base
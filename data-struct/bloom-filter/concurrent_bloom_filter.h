@@ -0,0 +1,66 @@
+#ifndef CPP_BASE_DATA_STRUCT_BLOOM_FILTER_CONCURRENT_BLOOM_FILTER_H_
+#define CPP_BASE_DATA_STRUCT_BLOOM_FILTER_CONCURRENT_BLOOM_FILTER_H_
+
+#include <atomic>
+#include <vector>
+
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+
+namespace cpp_base {
+
+// A thread-safe Bloom filter, for many threads inserting into and looking up one shared filter
+// rather than each keeping its own. It hashes like BloomFilter, and ends up with the very same
+// bits for the same keys.
+//
+// Bits are set with a relaxed atomic fetch-or on their 64-bit word, and only if not set already,
+// so inserts of keys already present do not write. Contains() is wait-free: plain relaxed loads.
+// Lookups racing with an insert of the same key may or may not see it; a lookup that starts
+// after an Insert() returned on another thread, and is ordered after it by other means, does.
+// The insert count is sharded over cache lines by thread, so inserting threads do not all
+// contend on one counter; NumElements() sums the shards.
+class ConcurrentBloomFilter {
+  public:
+    // Same as BloomFilter.
+    ConcurrentBloomFilter(int64 bit_size, int64 expected_num_elements);
+
+    ~ConcurrentBloomFilter();
+
+    // Returns true if the key was inserted, i.e., if this call set any bit. When several
+    // threads insert the same new key at the same time, one or more of them return true.
+    bool Insert(uint64 key);
+
+    // Returns whether the given key exists in the filter.
+    bool Contains(uint64 key) const;
+
+    // Clears the filter. Must not run concurrently with other calls.
+    void Clear();
+
+    const uint8* RawData() const { return reinterpret_cast<const uint8*>(words_); }
+    int64 BitSize() const { return bit_size_; }
+    int64 NumElements() const;
+
+    static const int kNumCounterShards = 16;
+
+  private:
+    struct alignas(64) CounterShard {
+        std::atomic<int64> count{0};
+    };
+
+    const int64 bit_size_;          // Size in bits, a multiple of 8 like in BloomFilter
+    const int64 num_words_;
+    std::atomic<uint64>* words_;    // The underlying bit vector
+    CounterShard counters_[kNumCounterShards];  // Num elements inserted so far, by thread
+
+    // Used for logging a warning if the Bloom Filter is over-used.
+    const int64 expected_num_elements_;
+
+    // Random keys used for hashing.
+    std::vector<uint64> hash_keys_;
+
+    DISALLOW_COPY_AND_ASSIGN(ConcurrentBloomFilter);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_BLOOM_FILTER_CONCURRENT_BLOOM_FILTER_H_
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/data-struct/bloom-filter/concurrent_bloom_filter.h"
+#include "cpp-base/thread/run_threads_test_util.h"
+
+using cpp_base::BloomFilter;
+using cpp_base::ConcurrentBloomFilter;
+using cpp_base::RunThreads;
+using std::vector;
+
+class ConcurrentBloomFilterTest : public ::testing::Test {
+  public:
+    ConcurrentBloomFilterTest() { }
+    ~ConcurrentBloomFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+};
+
+TEST_F(ConcurrentBloomFilterTest, Benchmark) {
+    // Total insert throughput of threads sharing one filter, vs. a mutex around a BloomFilter,
+    // vs. one BloomFilter per thread (which take N times the memory).
+    const int64 kNumKeys = 4000000;
+    const int64 kBitSize = kNumKeys * 10;
+    vector<uint64> keys = RandomKeys(kNumKeys, 1);
+    for (int num_threads = 1; num_threads <= 32; num_threads *= 2) {
+        const int64 keys_per_thread = kNumKeys / num_threads;
+
+        ConcurrentBloomFilter cbf(kBitSize, kNumKeys);
+        double secs = RunThreads(num_threads, [&](int t) {
+            for (int64 i = t * keys_per_thread; i < (t + 1) * keys_per_thread; ++i)
+                cbf.Insert(keys[i]);
+        });
+        const double concurrent_mops = kNumKeys / secs / 1e6;
+
+        BloomFilter bf(kBitSize, kNumKeys);
+        std::mutex mutex;
+        secs = RunThreads(num_threads, [&](int t) {
+            for (int64 i = t * keys_per_thread; i < (t + 1) * keys_per_thread; ++i) {
+                std::lock_guard<std::mutex> lock(mutex);
+                bf.Insert(keys[i]);
+            }
+        });
+        const double mutex_mops = kNumKeys / secs / 1e6;
+
+        vector<std::unique_ptr<BloomFilter>> filters;
+        for (int t = 0; t < num_threads; ++t)
+            filters.emplace_back(new BloomFilter(kBitSize, kNumKeys));
+        secs = RunThreads(num_threads, [&](int t) {
+            for (int64 i = t * keys_per_thread; i < (t + 1) * keys_per_thread; ++i)
+                filters[t]->Insert(keys[i]);
+        });
+        const double per_thread_mops = kNumKeys / secs / 1e6;
+
+        LOG(INFO) << num_threads << " threads: insert Mops/s: ConcurrentBloomFilter: "
+                  << concurrent_mops << ", mutex: " << mutex_mops << ", per-thread filters: "
+                  << per_thread_mops << " (" << num_threads * kBitSize / 8 / 1024 / 1024
+                  << " MB)";
+    }
+    LOG(INFO) << "Hardware threads: " << std::thread::hardware_concurrency();
+}
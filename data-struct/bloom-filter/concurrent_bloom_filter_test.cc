@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/data-struct/bloom-filter/concurrent_bloom_filter.h"
+#include "cpp-base/thread/run_threads_test_util.h"
+
+using cpp_base::BloomFilter;
+using cpp_base::ConcurrentBloomFilter;
+using cpp_base::RunThreads;
+using std::vector;
+
+class ConcurrentBloomFilterTest : public ::testing::Test {
+  public:
+    ConcurrentBloomFilterTest() { }
+    ~ConcurrentBloomFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+};
+
+TEST_F(ConcurrentBloomFilterTest, BasicTest) {
+    ConcurrentBloomFilter bf(1000, 100);
+    EXPECT_EQ(0, bf.NumElements());
+    EXPECT_FALSE(bf.Contains(25));
+
+    EXPECT_TRUE(bf.Insert(25));
+    EXPECT_TRUE(bf.Contains(25));
+    EXPECT_EQ(1, bf.NumElements());
+
+    EXPECT_FALSE(bf.Contains(35));
+    EXPECT_FALSE(bf.Insert(25));
+
+    bf.Clear();
+    EXPECT_EQ(0, bf.NumElements());
+    EXPECT_FALSE(bf.Contains(25));
+}
+
+TEST_F(ConcurrentBloomFilterTest, SameAsBloomFilter) {
+    for (int64 bit_size : {1000, 1001, 12345, 100000}) {
+        BloomFilter bf(bit_size, 1000);
+        ConcurrentBloomFilter cbf(bit_size, 1000);
+        EXPECT_EQ(bf.BitSize(), cbf.BitSize());
+        for (uint64 key : RandomKeys(1000, bit_size))
+            EXPECT_EQ(bf.Insert(key), cbf.Insert(key));
+        EXPECT_EQ(0, memcmp(bf.RawData(), cbf.RawData(), bf.BitSize() / 8));
+        for (uint64 key : RandomKeys(1000, 1))
+            EXPECT_EQ(bf.Contains(key), cbf.Contains(key));
+    }
+}
+
+TEST_F(ConcurrentBloomFilterTest, ConcurrentTest) {
+    const int kNumThreads = 8;
+    const int64 kNumKeysPerThread = 50000;
+    const int64 kNumKeys = kNumThreads * kNumKeysPerThread;
+    vector<uint64> keys = RandomKeys(kNumKeys, 1);
+    ConcurrentBloomFilter cbf(kNumKeys * 10, kNumKeys);
+
+    // Half the threads insert, while the other half keep looking up what was inserted before.
+    BloomFilter bf(kNumKeys * 10, kNumKeys);
+    for (int64 i = 0; i < kNumKeys / 2; ++i) {
+        cbf.Insert(keys[i]);
+        bf.Insert(keys[i]);
+    }
+    std::atomic<int64> num_misses(0);
+    RunThreads(kNumThreads, [&](int t) {
+        const int64 begin = t * kNumKeysPerThread;
+        for (int64 i = begin; i < begin + kNumKeysPerThread; ++i) {
+            if (t >= kNumThreads / 2)
+                cbf.Insert(keys[i]);
+            else if (!cbf.Contains(keys[i]))
+                ++num_misses;
+        }
+    });
+    EXPECT_EQ(0, num_misses);
+    EXPECT_EQ(kNumKeys, cbf.NumElements());
+
+    // No bit lost to a race.
+    for (int64 i = kNumKeys / 2; i < kNumKeys; ++i)
+        bf.Insert(keys[i]);
+    EXPECT_EQ(0, memcmp(bf.RawData(), cbf.RawData(), bf.BitSize() / 8));
+}
@@ -0,0 +1,190 @@
+#include "cpp-base/data-struct/bloom-filter/counting_bloom_filter.h"
+
+#include <glog/logging.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include <random>
+#include "cpp-base/hash/hash.h"
+
+namespace cpp_base {
+
+namespace {
+
+#ifdef __AVX2__
+// The counters of a key in the two halves of its block: words 0-3 and 4-7.
+struct Counters {
+    __m256i shifts[2];  // Of each counter in its word
+    __m256i counts[2];
+};
+
+// Sets 'shifts' to those of the counters of 'hash', as in BloomFilter::BlockedWordPosition(), and
+// 'counts' to their values in the given block words.
+inline void LoadCounters(uint64 hash, const __m256i* words, Counters* counters) {
+    const __m256i positions = _mm256_and_si256(
+            _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<uint32>(hash)),
+                              _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28)),
+            _mm256_set1_epi32(0xF));
+    const __m256i shifts = _mm256_slli_epi32(positions, 2);
+    counters->shifts[0] = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(shifts));
+    counters->shifts[1] = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(shifts, 1));
+    const __m256i nibble = _mm256_set1_epi64x(0xF);
+    for (int i = 0; i < 2; ++i) {
+        counters->counts[i] = _mm256_and_si256(
+                _mm256_srlv_epi64(_mm256_load_si256(words + i), counters->shifts[i]), nibble);
+    }
+}
+
+// Whether any of the counters is zero.
+inline bool AnyZero(const Counters& counters) {
+    const __m256i zero = _mm256_setzero_si256();
+    return !_mm256_testz_si256(_mm256_or_si256(_mm256_cmpeq_epi64(counters.counts[0], zero),
+                                               _mm256_cmpeq_epi64(counters.counts[1], zero)),
+                               _mm256_set1_epi64x(-1));
+}
+
+// One in each of the counters that are not saturated, to add to or subtract from the words.
+inline __m256i Deltas(const Counters& counters, int i) {
+    const __m256i max = _mm256_set1_epi64x(CountingBloomFilter::kMaxCount);
+    return _mm256_andnot_si256(_mm256_cmpeq_epi64(counters.counts[i], max),
+                               _mm256_sllv_epi64(_mm256_set1_epi64x(1), counters.shifts[i]));
+}
+#endif
+
+// Gathers bits 0, 4, 8, ..., 60 of 'x' into its 16 lowest bits.
+inline uint16 GatherNibbleBits(uint64 x) {
+    x &= 0x1111111111111111ULL;
+    x = (x | (x >> 3)) & 0x0303030303030303ULL;
+    x = (x | (x >> 6)) & 0x000F000F000F000FULL;
+    x = (x | (x >> 12)) & 0x000000FF000000FFULL;
+    x = (x | (x >> 24)) & 0xFFFFULL;
+    return x;
+}
+
+}  // namespace
+
+CountingBloomFilter::CountingBloomFilter(int64 num_counters, int64 expected_num_elements)
+        : num_blocks_(std::max<int64>(1, (num_counters + kCountersPerBlock - 1) /
+                                         kCountersPerBlock)),
+          expected_num_elements_(expected_num_elements) {
+    CHECK_LE(num_blocks_, 1LL << 32) << "Block index is 32 bits";
+    void* data;
+    CHECK_EQ(posix_memalign(&data, kBlockBytes, num_blocks_ * kBlockBytes), 0);
+    blocks_ = static_cast<Block*>(data);
+    memset(blocks_, 0, num_blocks_ * kBlockBytes);
+
+    // Same as BloomFilter.
+    std::mt19937_64 rand_gen(1000);
+    for (int i = 0; i < 8; ++i)
+        hash_keys_.push_back(rand_gen());
+}
+
+CountingBloomFilter::~CountingBloomFilter() {
+    free(blocks_);
+}
+
+bool CountingBloomFilter::Insert(uint64 key) {
+    const uint64 hash = Hash64NumWithSeed(key, hash_keys_[0]);
+    Block* block = BlockOf(hash);
+    bool inserted;
+#ifdef __AVX2__
+    __m256i* words = reinterpret_cast<__m256i*>(block->words);
+    Counters counters;
+    LoadCounters(hash, words, &counters);
+    inserted = AnyZero(counters);
+    for (int i = 0; i < 2; ++i) {
+        _mm256_store_si256(words + i,
+                           _mm256_add_epi64(_mm256_load_si256(words + i), Deltas(counters, i)));
+    }
+#else
+    inserted = false;
+    for (int i = 0; i < 8; ++i) {
+        const int shift = BloomFilter::BlockedWordPosition(hash, i) * 4;
+        const uint64 count = (block->words[i] >> shift) & 0xF;
+        inserted |= count == 0;
+        if (count < kMaxCount)
+            block->words[i] += 1ULL << shift;
+    }
+#endif
+    ++num_elements_;
+
+    // If we went beyond the expected size, log a warning, but only at a regulated rate.
+    if (num_elements_ > expected_num_elements_ && BloomFilter::IsPowerOf2(++log_regulator_)) {
+        LOG(WARNING) << "CBF insertions (" << num_elements_ << ") exceeded the expected maximum ("
+                     << expected_num_elements_ << "). Accuracy will degrade. Need more memory.";
+    }
+    return inserted;
+}
+
+bool CountingBloomFilter::Remove(uint64 key) {
+    const uint64 hash = Hash64NumWithSeed(key, hash_keys_[0]);
+    Block* block = BlockOf(hash);
+#ifdef __AVX2__
+    __m256i* words = reinterpret_cast<__m256i*>(block->words);
+    Counters counters;
+    LoadCounters(hash, words, &counters);
+    if (AnyZero(counters))
+        return false;
+    for (int i = 0; i < 2; ++i) {
+        _mm256_store_si256(words + i,
+                           _mm256_sub_epi64(_mm256_load_si256(words + i), Deltas(counters, i)));
+    }
+#else
+    int shifts[8];
+    for (int i = 0; i < 8; ++i) {
+        shifts[i] = BloomFilter::BlockedWordPosition(hash, i) * 4;
+        if (((block->words[i] >> shifts[i]) & 0xF) == 0)
+            return false;
+    }
+    for (int i = 0; i < 8; ++i) {
+        if (((block->words[i] >> shifts[i]) & 0xF) < kMaxCount)
+            block->words[i] -= 1ULL << shifts[i];
+    }
+#endif
+    --num_elements_;
+    return true;
+}
+
+bool CountingBloomFilter::Contains(uint64 key) const {
+    const uint64 hash = Hash64NumWithSeed(key, hash_keys_[0]);
+    const Block* block = BlockOf(hash);
+#ifdef __AVX2__
+    Counters counters;
+    LoadCounters(hash, reinterpret_cast<const __m256i*>(block->words), &counters);
+    return !AnyZero(counters);
+#else
+    for (int i = 0; i < 8; ++i) {
+        const int shift = BloomFilter::BlockedWordPosition(hash, i) * 4;
+        if (((block->words[i] >> shift) & 0xF) == 0)
+            return false;
+    }
+    return true;
+#endif
+}
+
+void CountingBloomFilter::Clear() {
+    memset(blocks_, 0, num_blocks_ * kBlockBytes);
+    num_elements_ = 0;
+}
+
+std::unique_ptr<BloomFilter> CountingBloomFilter::ToBloomFilter() const {
+    // Counter j of word i of a block is bit 16 * i + j of the 16-byte block of the Bloom filter.
+    const int64 byte_size = num_blocks_ * (BloomFilter::kBlockBits / 8);
+    uint8* data = new uint8[byte_size];
+    for (int64 b = 0; b < num_blocks_; ++b) {
+        for (int i = 0; i < 8; ++i) {
+            const uint64 word = blocks_[b].words[i];
+            const uint16 nonzero = GatherNibbleBits(word | (word >> 1) | (word >> 2) |
+                                                    (word >> 3));
+            memcpy(data + (b * 8 + i) * 2, &nonzero, 2);  // Little-endian
+        }
+    }
+    return std::unique_ptr<BloomFilter>(new BloomFilter(
+            byte_size * 8, expected_num_elements_, num_elements_, hash_keys_,
+            BloomFilter::kBlocked, data, 0));
+}
+
+}  // namespace cpp_base
@@ -0,0 +1,88 @@
+#ifndef CPP_BASE_DATA_STRUCT_BLOOM_FILTER_COUNTING_BLOOM_FILTER_H_
+#define CPP_BASE_DATA_STRUCT_BLOOM_FILTER_COUNTING_BLOOM_FILTER_H_
+
+#include <memory>
+#include <vector>
+
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+
+namespace cpp_base {
+
+// A counting Bloom filter: an approximate set that allows Remove() as well, like CuckooFilter,
+// but whose insertions never fail however full it gets; it only degrades, like a Bloom filter.
+// Each bit of a Bloom filter is a 4-bit counter instead, so it takes 4 times the memory of one.
+//
+// The counters are in 64-byte blocks of 128, as eight 64-bit words of 16 counters. Each key
+// hashes once, to one block, and to one counter in each of its words; so an operation touches a
+// single cache line. When compiled with AVX2, the 8 counters are incremented, decremented or
+// tested in one go with vector instructions; otherwise a scalar loop does the very same.
+//
+// Counters saturate at 15: a counter that reached it is never decremented again, since it no
+// longer knows how many keys it counts. Such a counter, and the keys on it, stays for good, which
+// takes 15 keys on one counter, i.e., a badly over-used filter or a key inserted that many times.
+// Inserting a key twice takes removing it twice.
+//
+// ToBloomFilter() takes a plain BloomFilter snapshot of the set, with kBlocked indexing: one bit
+// per counter, set if the counter is not zero. This class is *not* thread-safe.
+class CountingBloomFilter {
+  public:
+    // Constructs an empty filter of at least 'num_counters' counters, rounded up to whole blocks.
+    // 'expected_num_elements' is only used for warning when the filter is over-used.
+    CountingBloomFilter(int64 num_counters, int64 expected_num_elements);
+
+    ~CountingBloomFilter();
+
+    // Adds the given key. Returns true if it was not in the filter, i.e., if any of its counters
+    // was zero.
+    bool Insert(uint64 key);
+
+    // Removes the given key. Returns false and does nothing if it is not in the filter. Removing a
+    // key that was not inserted, but is a false positive, removes other keys.
+    bool Remove(uint64 key);
+
+    // Returns whether the given key exists in the filter.
+    bool Contains(uint64 key) const;
+
+    // Clears the filter.
+    void Clear();
+
+    // Returns a Bloom filter with the same keys, and the same false positives.
+    std::unique_ptr<BloomFilter> ToBloomFilter() const;
+
+    int64 NumCounters() const { return num_blocks_ * kCountersPerBlock; }
+    int64 SizeInBytes() const { return num_blocks_ * kBlockBytes; }
+    int64 NumElements() const { return num_elements_; }
+
+    static const int kBlockBytes = 64;
+    static const int kCountersPerBlock = kBlockBytes * 2;
+    static const int kMaxCount = 15;
+
+  private:
+    struct alignas(kBlockBytes) Block {
+        uint64 words[8];
+    };
+
+    // The block of 'hash', by multiply-shift of its high 32 bits, as in BloomFilter.
+    Block* BlockOf(uint64 hash) const {
+        return blocks_ + (((hash >> 32) * num_blocks_) >> 32);
+    }
+
+    const int64 num_blocks_;
+    Block* blocks_;                 // The counters, cache-line aligned
+    int64 num_elements_ = 0;        // Num elements inserted and not removed
+
+    // These are used for logging a warning if the filter is over-used.
+    const int64 expected_num_elements_;
+    int64 log_regulator_ = 0;
+
+    // The hash keys of BloomFilter with kBlocked indexing, of which the first seeds the hash.
+    std::vector<uint64> hash_keys_;
+
+    DISALLOW_COPY_AND_ASSIGN(CountingBloomFilter);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_BLOOM_FILTER_COUNTING_BLOOM_FILTER_H_
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/data-struct/bloom-filter/counting_bloom_filter.h"
+#include "cpp-base/data-struct/cuckoo-filter/cuckoo_filter.h"
+
+using cpp_base::BloomFilter;
+using cpp_base::CountingBloomFilter;
+using cpp_base::CuckooFilter;
+using std::unique_ptr;
+using std::vector;
+
+class CountingBloomFilterTest : public ::testing::Test {
+  public:
+    CountingBloomFilterTest() { }
+    ~CountingBloomFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+
+    // Returns the average ns per call of f(key) over the given keys.
+    template <class F>
+    static double NanosPerKey(const vector<uint64>& keys, const F& f) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64 key : keys)
+            f(key);
+        return std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / keys.size();
+    }
+};
+
+TEST_F(CountingBloomFilterTest, Benchmark) {
+    // Memory, false positives and throughput vs. CuckooFilter with 12-bit tags, on filters much
+    // larger than the last-level cache. The Bloom filters get 12 counters per key.
+    const int64 kNumKeys = 20000000;
+    vector<uint64> keys = RandomKeys(kNumKeys, 1);
+    vector<uint64> absent_keys = RandomKeys(kNumKeys, 2);
+    int64 num_found = 0;
+
+    CountingBloomFilter cbf(kNumKeys * 12, kNumKeys);
+    const double cbf_insert_ns = NanosPerKey(keys, [&](uint64 key) { cbf.Insert(key); });
+    const double cbf_hit_ns =
+            NanosPerKey(keys, [&](uint64 key) { num_found += cbf.Contains(key); });
+    const double cbf_miss_ns =
+            NanosPerKey(absent_keys, [&](uint64 key) { num_found += cbf.Contains(key); });
+    EXPECT_GE(num_found, kNumKeys);
+    const double cbf_fp = (num_found - kNumKeys) * 1. / kNumKeys;
+    const double cbf_remove_ns = NanosPerKey(keys, [&](uint64 key) { cbf.Remove(key); });
+    EXPECT_EQ(0, cbf.NumElements());
+    LOG(INFO) << "CountingBloomFilter of " << cbf.SizeInBytes() / 1e6 << " MB ("
+              << cbf.SizeInBytes() * 8. / kNumKeys << " bits/key): " << cbf_insert_ns
+              << " ns/insert, " << cbf_hit_ns << " ns/hit, " << cbf_miss_ns << " ns/miss, "
+              << cbf_remove_ns << " ns/remove; false positives: " << cbf_fp * 100 << "%";
+
+    CuckooFilter<12> cf(kNumKeys);
+    int64 num_failed = 0;
+    const double cf_insert_ns =
+            NanosPerKey(keys, [&](uint64 key) { num_failed += !cf.Insert(key); });
+    num_found = 0;
+    const double cf_hit_ns =
+            NanosPerKey(keys, [&](uint64 key) { num_found += cf.Contains(key); });
+    const double cf_miss_ns =
+            NanosPerKey(absent_keys, [&](uint64 key) { num_found += cf.Contains(key); });
+    const double cf_fp = (num_found - kNumKeys + num_failed) * 1. / kNumKeys;
+    const double cf_remove_ns = NanosPerKey(keys, [&](uint64 key) { cf.Delete(key); });
+    LOG(INFO) << "CuckooFilter of " << cf.SizeInBytes() / 1e6 << " MB ("
+              << cf.SizeInBytes() * 8. / kNumKeys << " bits/key): " << cf_insert_ns
+              << " ns/insert, " << cf_hit_ns << " ns/hit, " << cf_miss_ns << " ns/miss, "
+              << cf_remove_ns << " ns/remove; false positives: " << cf_fp * 100
+              << "%; failed inserts: " << num_failed;
+
+    // Snapshotting.
+    for (uint64 key : keys)
+        cbf.Insert(key);
+    auto start = std::chrono::steady_clock::now();
+    unique_ptr<BloomFilter> bf = cbf.ToBloomFilter();
+    LOG(INFO) << "ToBloomFilter(): " << std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start).count()
+              << " ms for a Bloom filter of " << bf->BitSize() / 8e6 << " MB";
+}
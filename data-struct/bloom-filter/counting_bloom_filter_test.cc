@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/data-struct/bloom-filter/counting_bloom_filter.h"
+
+using cpp_base::BloomFilter;
+using cpp_base::CountingBloomFilter;
+using std::unique_ptr;
+using std::vector;
+
+class CountingBloomFilterTest : public ::testing::Test {
+  public:
+    CountingBloomFilterTest() { }
+    ~CountingBloomFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+};
+
+TEST_F(CountingBloomFilterTest, BasicTest) {
+    CountingBloomFilter cbf(1000, 100);
+    EXPECT_EQ(1024, cbf.NumCounters());  // Eight blocks
+    EXPECT_EQ(512, cbf.SizeInBytes());
+    EXPECT_EQ(0, cbf.NumElements());
+    EXPECT_FALSE(cbf.Contains(25));
+    EXPECT_FALSE(cbf.Remove(25));
+
+    EXPECT_TRUE(cbf.Insert(25));
+    EXPECT_TRUE(cbf.Contains(25));
+    EXPECT_EQ(1, cbf.NumElements());
+    EXPECT_FALSE(cbf.Contains(35));
+
+    // Twice in, twice out.
+    EXPECT_FALSE(cbf.Insert(25));
+    EXPECT_EQ(2, cbf.NumElements());
+    EXPECT_TRUE(cbf.Remove(25));
+    EXPECT_TRUE(cbf.Contains(25));
+    EXPECT_TRUE(cbf.Remove(25));
+    EXPECT_FALSE(cbf.Contains(25));
+    EXPECT_FALSE(cbf.Remove(25));
+    EXPECT_EQ(0, cbf.NumElements());
+
+    cbf.Insert(25);
+    cbf.Clear();
+    EXPECT_EQ(0, cbf.NumElements());
+    EXPECT_FALSE(cbf.Contains(25));
+}
+
+TEST_F(CountingBloomFilterTest, RemoveTest) {
+    const int64 N = 100000;
+    vector<uint64> keys = RandomKeys(2 * N, 1);
+    CountingBloomFilter cbf(N * 12, 2 * N);
+    for (uint64 key : keys)
+        cbf.Insert(key);
+    for (int64 i = N; i < 2 * N; ++i)
+        EXPECT_TRUE(cbf.Remove(keys[i]));
+    EXPECT_EQ(N, cbf.NumElements());
+
+    // No false negatives for the rest, and the removed keys are gone but for false positives.
+    for (int64 i = 0; i < N; ++i)
+        EXPECT_TRUE(cbf.Contains(keys[i]));
+    int64 num_false_positives = 0;
+    for (int64 i = N; i < 2 * N; ++i)
+        num_false_positives += cbf.Contains(keys[i]);
+    LOG(INFO) << "False positive ratio of removed keys: " << num_false_positives * 100. / N << "%";
+    EXPECT_LT(num_false_positives, N / 100);
+
+    // All removed, all counters back to zero.
+    for (int64 i = 0; i < N; ++i)
+        EXPECT_TRUE(cbf.Remove(keys[i]));
+    unique_ptr<BloomFilter> bf = cbf.ToBloomFilter();
+    for (int64 i = 0; i < bf->BitSize() / 8; ++i)
+        ASSERT_EQ(0, bf->RawData()[i]) << i;
+}
+
+TEST_F(CountingBloomFilterTest, SaturationTest) {
+    CountingBloomFilter cbf(1000, 100);
+    for (int i = 0; i < 20; ++i)
+        cbf.Insert(25);
+
+    // The counters stopped at 15 and stay there.
+    for (int i = 0; i < 20; ++i)
+        EXPECT_TRUE(cbf.Remove(25));
+    EXPECT_TRUE(cbf.Contains(25));
+    EXPECT_EQ(0, cbf.NumElements());
+
+    // The counters of other keys in the same blocks still count.
+    for (uint64 key = 0; key < 1000; ++key) {
+        if (cbf.Contains(key))
+            continue;
+        cbf.Insert(key);
+        EXPECT_TRUE(cbf.Remove(key));
+        EXPECT_FALSE(cbf.Contains(key)) << key;
+    }
+}
+
+TEST_F(CountingBloomFilterTest, ToBloomFilterTest) {
+    // The snapshot of the keys left after removals is the Bloom filter of those keys.
+    const int64 N = 100000;
+    vector<uint64> keys = RandomKeys(3 * N, 2);
+    CountingBloomFilter cbf(N * 12, 2 * N);
+    BloomFilter expected_bf(cbf.NumCounters(), N, BloomFilter::kBlocked);
+    for (int64 i = 0; i < 2 * N; ++i)
+        cbf.Insert(keys[i]);
+    for (int64 i = N; i < 2 * N; ++i)
+        cbf.Remove(keys[i]);
+    for (int64 i = 0; i < N; ++i)
+        expected_bf.Insert(keys[i]);
+
+    unique_ptr<BloomFilter> bf = cbf.ToBloomFilter();
+    EXPECT_EQ(BloomFilter::kBlocked, bf->GetIndexing());
+    EXPECT_EQ(cbf.NumCounters(), bf->BitSize());
+    EXPECT_EQ(N, bf->NumElements());
+    ASSERT_TRUE(bf->IsCompatible(expected_bf));
+    EXPECT_EQ(0, memcmp(expected_bf.RawData(), bf->RawData(), bf->BitSize() / 8));
+    for (uint64 key : keys)
+        EXPECT_EQ(cbf.Contains(key), bf->Contains(key));
+}
@@ -1,20 +1,54 @@
 #include "cpp-base/data-struct/bloom-filter/expandable_bloom_filter.h"
 
 #include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
 
 namespace cpp_base {
 
-ExpandableBloomFilter::ExpandableBloomFilter(int64 initial_bit_size, int64 initial_cutoff_size) {
-    BfInstance instance;
-    instance.bf_.reset(new BloomFilter(initial_bit_size, initial_cutoff_size));
-    instance.cutoff_size_ = initial_cutoff_size;
-    instances_.push_back(std::move(instance));
+ExpandableBloomFilter::ExpandableBloomFilter(int64 initial_bit_size, int64 initial_cutoff_size,
+                                             double tightening_ratio, int64 max_consolidated_keys)
+        : initial_bit_size_(initial_bit_size),
+          initial_cutoff_size_(initial_cutoff_size),
+          tightening_ratio_(tightening_ratio),
+          max_consolidated_keys_(max_consolidated_keys) {
+    CHECK_GT(tightening_ratio, 0);
+    CHECK_LE(tightening_ratio, 1);
+    CHECK_GE(max_consolidated_keys, 0);
+    Clear();
+
+    const BloomFilter& bf = *instances_.front().bf_;
+    const int k = bf.NumHashes();
+    initial_fpr_ = std::pow(-std::expm1(-k * 1. * initial_cutoff_size / bf.BitSize()), k);
 }
 
 bool ExpandableBloomFilter::Insert(uint64 key) {
+    const bool inserted = InsertNew(key, 0);
+    KeepKey(key);
+    return inserted;
+}
+
+inline void ExpandableBloomFilter::KeepKey(uint64 key) {
+    // Including the keys found already, which may be false positives: after a consolidation,
+    // they have to be found still.
+    if (keep_keys_) {
+        consolidated_keys_.push_back(key);
+        if (consolidated_keys_.size() > 2 * max_consolidated_keys_)
+            StopKeepingKeys();  // Too many repeats
+    }
+}
+
+void ExpandableBloomFilter::StopKeepingKeys() {
+    keep_keys_ = false;
+    std::vector<uint64>().swap(consolidated_keys_);
+}
+
+bool ExpandableBloomFilter::InsertNew(uint64 key, int64 first) {
     // If the key exists in any of the bloom filters, do not insert.
-    if (Contains(key))
-        return false;
+    for (int64 i = instances_.size() - 1; i >= first; --i) {
+        if (instances_[i].bf_->Contains(key))
+            return false;
+    }
 
     // Insert in the last filter.
     BfInstance* last = &instances_.back();
@@ -22,17 +56,7 @@ bool ExpandableBloomFilter::Insert(uint64 key) {
 
     // Is the last filter full?
     if (last->bf_->NumElements() == last->cutoff_size_) {
-        // Create a new filter with a size equal to all existing filters' size.
-        int64 capacity = 0;
-        int64 bit_size = 0;
-        for (const BfInstance& b : instances_) {
-            capacity += b.cutoff_size_;
-            bit_size += b.bf_->BitSize();
-        }
-        BfInstance instance;
-        instance.cutoff_size_ = capacity;
-        instance.bf_.reset(new BloomFilter(bit_size, capacity));
-        instances_.push_back(std::move(instance));
+        Expand();
         last = &instances_.back();
     }
 
@@ -42,9 +66,68 @@ bool ExpandableBloomFilter::Insert(uint64 key) {
     return true;
 }
 
+void ExpandableBloomFilter::Expand() {
+    int64 capacity = 0;
+    for (const BfInstance& b : instances_)
+        capacity += b.cutoff_size_;
+
+    // Replace all the filters with one built from their keys, at the false positive ratio of the
+    // initial filter.
+    if (keep_keys_ && instances_.size() > 1) {
+        std::sort(consolidated_keys_.begin(), consolidated_keys_.end());
+        consolidated_keys_.erase(std::unique(consolidated_keys_.begin(), consolidated_keys_.end()),
+                                 consolidated_keys_.end());
+        instances_.clear();
+        AddInstance(std::max<int64>(capacity, consolidated_keys_.size()), initial_fpr_);
+        instances_.back().bf_->InsertBatch(consolidated_keys_.data(), consolidated_keys_.size());
+        ++num_consolidations_;
+    }
+
+    // The new filter doubles the capacity; stop keeping the keys once they would be too many.
+    if (keep_keys_ && 2 * capacity > max_consolidated_keys_)
+        StopKeepingKeys();
+
+    // Create a new filter with a capacity equal to all existing filters' capacity.
+    AddInstance(capacity, initial_fpr_ * std::pow(tightening_ratio_, instances_.size()));
+}
+
+void ExpandableBloomFilter::AddInstance(int64 capacity, double false_positive_ratio) {
+    // At the ratio of the initial filter, as many bits per element as it has.
+    const int64 bit_size = false_positive_ratio == initial_fpr_ ?
+            std::llround(initial_bit_size_ * 1. / initial_cutoff_size_ * capacity) :
+            BitSizeFor(capacity, false_positive_ratio);
+    BfInstance instance;
+    instance.cutoff_size_ = capacity;
+    instance.bf_.reset(new BloomFilter(bit_size, capacity, BloomFilter::kDoubleHashing));
+    instances_.push_back(std::move(instance));
+}
+
+int64 ExpandableBloomFilter::BitSizeFor(int64 num_elements, double false_positive_ratio) {
+    // The optimal number of hash functions, and for it, the size at which a full filter has the
+    // given ratio: (1 - e^(-k*n/m))^k = p.
+    const int k = std::min(8, std::max(1, static_cast<int>(std::round(
+            -std::log2(false_positive_ratio)))));
+    const double bits = -k * num_elements / std::log1p(-std::pow(false_positive_ratio, 1. / k));
+    return std::max<int64>(8, std::ceil(bits));
+}
+
+double ExpandableBloomFilter::MaxFalsePositiveRatio() const {
+    if (tightening_ratio_ == 1)
+        return 1;
+    return std::min(1., initial_fpr_ / (1 - tightening_ratio_));
+}
+
 bool ExpandableBloomFilter::Contains(uint64 key) const {
     // Search the list of bloom filters from last to first, because larger filters are
-    // exponentially more likely to get a hit.
+    // exponentially more likely to get a hit. Fetch the bits of the key beforehand, so their
+    // cache misses overlap instead of coming one after the other: all of them in the last filter,
+    // which holds half the keys, and the first few in the others, as about half the bits of a
+    // full filter are set, so most lookups of absent keys stop at the first or second one.
+    if (instances_.size() > 1) {
+        instances_.back().bf_->Prefetch(key);
+        for (int64 i = 0; i + 1 < instances_.size(); ++i)
+            instances_[i].bf_->Prefetch(key, kNumPrefetchedHashes);
+    }
     for (auto it = instances_.rbegin(); it != instances_.rend(); ++it) {
         if (it->bf_->Contains(key))
             return true;
@@ -52,10 +135,81 @@ bool ExpandableBloomFilter::Contains(uint64 key) const {
     return false;
 }
 
+int64 ExpandableBloomFilter::InsertBatch(const uint64* keys, int64 num_keys, bool* results) {
+    bool found[BloomFilter::kBatchSize];
+    int64 num_inserted = 0;
+    for (int64 start = 0; start < num_keys; start += BloomFilter::kBatchSize) {
+        const int64 n = std::min<int64>(BloomFilter::kBatchSize, num_keys - start);
+        ContainsBatch(keys + start, n, found);
+
+        // The absent keys go to the last filter, most likely. Keys of this group inserted before
+        // a given key went to the last filter or newer ones, so only those need a second look.
+        // Unless the filters got consolidated meanwhile: that rebuilt them, so 'found' no longer
+        // holds and the rest of the keys are looked up again in all of them.
+        int64 first = instances_.size() - 1;
+        const BloomFilter& last = *instances_.back().bf_;
+        for (int64 k = 0; k < n; ++k) {
+            if (!found[k])
+                last.Prefetch(keys[start + k]);
+        }
+        const int64 num_consolidations = num_consolidations_;
+        bool consolidated = false;
+        for (int64 k = 0; k < n; ++k) {
+            if (!consolidated && num_consolidations_ != num_consolidations) {
+                consolidated = true;
+                first = 0;
+            }
+            const bool inserted = (consolidated || !found[k]) && InsertNew(keys[start + k], first);
+            KeepKey(keys[start + k]);
+            num_inserted += inserted;
+            if (results != nullptr)
+                results[start + k] = inserted;
+        }
+    }
+    return num_inserted;
+}
+
+void ExpandableBloomFilter::ContainsBatch(const uint64* keys, int64 num_keys,
+                                          bool* results) const {
+    // Like Contains(), search from the last filter to the first, each time only for the keys
+    // not found yet.
+    bool found[BloomFilter::kBatchSize];
+    for (int64 start = 0; start < num_keys; start += BloomFilter::kBatchSize) {
+        const int64 n = std::min<int64>(BloomFilter::kBatchSize, num_keys - start);
+        uint64 pending[BloomFilter::kBatchSize];
+        int64 positions[BloomFilter::kBatchSize];
+        int64 num_pending = n;
+        for (int64 k = 0; k < n; ++k) {
+            pending[k] = keys[start + k];
+            positions[k] = start + k;
+            results[start + k] = false;
+        }
+        for (auto it = instances_.rbegin(); it != instances_.rend() && num_pending > 0; ++it) {
+            it->bf_->ContainsBatch(pending, num_pending, found);
+            int64 num_left = 0;
+            for (int64 k = 0; k < num_pending; ++k) {
+                if (found[k]) {
+                    results[positions[k]] = true;
+                } else {
+                    pending[num_left] = pending[k];
+                    positions[num_left++] = positions[k];
+                }
+            }
+            num_pending = num_left;
+        }
+    }
+}
+
 void ExpandableBloomFilter::Clear() {
-    instances_.resize(1);
-    instances_.front().bf_->Clear();
+    instances_.clear();
+    BfInstance instance;
+    instance.bf_.reset(new BloomFilter(initial_bit_size_, initial_cutoff_size_,
+                                       BloomFilter::kDoubleHashing));
+    instance.cutoff_size_ = initial_cutoff_size_;
+    instances_.push_back(std::move(instance));
     num_inserts_ = 0;
+    std::vector<uint64>().swap(consolidated_keys_);
+    keep_keys_ = initial_cutoff_size_ <= max_consolidated_keys_;
 }
 
 int64 ExpandableBloomFilter::BitSize() const {
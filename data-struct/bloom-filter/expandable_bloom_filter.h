@@ -8,19 +8,35 @@
 
 namespace cpp_base {
 
-// A wrapper on Bloom Filter that allows to create a small bloom filter and expand as necessary.
-// First, we create an initial BF for e.g. 1000 elements. Upon insertion of the 1001st element,
-// a new BF is created for 1000 elements so the total size increases to 2000. On the 2001st element,
-// the next BF is created for 2000 elements, and so on.
+// A wrapper on Bloom Filter that allows to create a small bloom filter and expand as necessary:
+// a scalable Bloom filter (Almeida et al., 2007). First, we create an initial BF for e.g. 1000
+// elements. Upon insertion of the 1001st element, a new BF is created for 1000 elements so the
+// total capacity increases to 2000. On the 2001st element, the next BF is created for 2000
+// elements, and so on.
+// A key is a false positive if it is one in any of the filters, so rather than giving all of them
+// the false positive ratio p of the initial one, which would add up with every expansion, filter
+// i is sized for p * r^i, with r the tightening ratio: the total stays below p / (1 - r) however
+// far the filter grows, at the cost of a few more bits per element in every new filter.
 // Lookup is done in O(log(n/initial_cutoff_size)). So is insertion, because it does a lookup first.
-// Note that the false positive ratio of such a filter is lower than a normal Bloom Filter:
-// Pr(false pos) = Pr(false pos in BF 1 | false pos in BF 2 | ...).
+// Optionally, to keep the small filters of the start from adding up to many lookups, the keys are
+// kept as long as the filters hold at most 'max_consolidated_keys' of them in total, and on every
+// expansion up to then, all the filters are rebuilt from those keys into one.
 class ExpandableBloomFilter {
   public:
+    // The defaults of the constructor. The total false positive ratio stays below 5 times that of
+    // the initial filter, and each expansion costs about 0.46 more bits per element.
+    static constexpr double kDefaultTighteningRatio = 0.8;
+
     // initial_bit_size: capacity of the BF in number of bits.
     // initial_cutoff_size: after this many insertions, double the size.
     // Num bits per element is: initial_bit_size / initial_cutoff_size.
-    ExpandableBloomFilter(int64 initial_bit_size, int64 initial_cutoff_size);
+    // tightening_ratio: the false positive ratio of each new filter relative to the one before,
+    // in (0, 1]. 1 keeps the same number of bits per element in all of them.
+    // max_consolidated_keys: keep up to this many keys for consolidating the first filters; 0, the
+    // default, to never consolidate. The keys are kept as is, 8 bytes each, until then.
+    ExpandableBloomFilter(int64 initial_bit_size, int64 initial_cutoff_size,
+                          double tightening_ratio = kDefaultTighteningRatio,
+                          int64 max_consolidated_keys = 0);
 
     // Returns true if the given key is inserted, false if it already existed.
     bool Insert(uint64 key);
@@ -28,6 +44,14 @@ class ExpandableBloomFilter {
     // Returns whether the given key exists in the filter.
     bool Contains(uint64 key) const;
 
+    // Batched versions of Insert() and Contains(); see BloomFilter::InsertBatch(). Each group of
+    // keys is looked up in all the filters with their memory accesses overlapped; only the keys
+    // found absent are then inserted, one by one. Sets 'results[i]' to what Insert(keys[i]) or
+    // Contains(keys[i]) would return; 'results' may be null for InsertBatch(), which returns the
+    // number of keys actually inserted.
+    int64 InsertBatch(const uint64* keys, int64 num_keys, bool* results = nullptr);
+    void ContainsBatch(const uint64* keys, int64 num_keys, bool* results) const;
+
     // Clears the filter.
     void Clear();
 
@@ -35,13 +59,53 @@ class ExpandableBloomFilter {
 
     int64 NumInserts() const { return num_inserts_; }
 
+    // The number of Bloom filters a lookup goes through.
+    int64 NumFilters() const { return instances_.size(); }
+
+    // The bound on the false positive ratio of the filter, however far it expands.
+    double MaxFalsePositiveRatio() const;
+
+    // The number of bits a Bloom filter needs for 'num_elements' at the given false positive
+    // ratio, with at most the 8 hash functions of BloomFilter.
+    static int64 BitSizeFor(int64 num_elements, double false_positive_ratio);
+
   private:
+    // Inserts the given key, which is known to be absent from the filters before 'first'.
+    bool InsertNew(uint64 key, int64 first);
+
+    // Keeps the given key for the next consolidation, if still keeping keys.
+    void KeepKey(uint64 key);
+    void StopKeepingKeys();
+
+    // Adds a filter once the last one is full, after consolidating the filters so far if their
+    // keys were kept.
+    void Expand();
+
+    // The number of hash functions of each filter but the last that Contains() prefetches the
+    // bits of.
+    static const int kNumPrefetchedHashes = 2;
+
+    // Appends a new filter for the given capacity and false positive ratio.
+    void AddInstance(int64 capacity, double false_positive_ratio);
+
     struct BfInstance {
         std::unique_ptr<BloomFilter> bf_;
         int64 cutoff_size_;
     };
     std::vector<BfInstance> instances_;
     int64 num_inserts_ = 0;
+    int64 num_consolidations_ = 0;  // Lets InsertBatch() tell when the filters were rebuilt
+
+    const int64 initial_bit_size_;
+    const int64 initial_cutoff_size_;
+    const double tightening_ratio_;
+    const int64 max_consolidated_keys_;
+    double initial_fpr_;  // False positive ratio of the initial filter when full
+
+    // All the keys inserted so far, repeats included, while there are at most
+    // 'max_consolidated_keys_' distinct ones.
+    std::vector<uint64> consolidated_keys_;
+    bool keep_keys_;
 };
 
 }  // namespace cpp_base
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cpp-base/data-struct/bloom-filter/expandable_bloom_filter.h"
+#include "cpp-base/hash/hash.h"
+
+using cpp_base::ExpandableBloomFilter;
+using std::vector;
+
+class ExpandableBloomFilterTest : public ::testing::Test {
+  public:
+    ExpandableBloomFilterTest() { }
+    ~ExpandableBloomFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+TEST_F(ExpandableBloomFilterTest, BatchBenchmark) {
+    // Four filters of 64, 65, 135 and 278 MB, 543 MB in total, larger than the last-level cache:
+    // the first one has 512 bits per element, and each next one a tighter ratio.
+    const int64 kInitialBitSize = 1LL << 29;
+    const int64 kInitialCutoff = 1000000;
+    const int64 kNumKeys = 8000000;
+    const int64 kBatch = 1024;
+    std::mt19937_64 rand_gen(1);
+    vector<uint64> keys(2 * kNumKeys);  // The first half inserted, the second half not
+    for (uint64& key : keys)
+        key = rand_gen();
+    const uint64* present = keys.data();
+    const uint64* absent = keys.data() + kNumKeys;
+    bool results[kBatch];
+
+    ExpandableBloomFilter bf(kInitialBitSize, kInitialCutoff);
+    ExpandableBloomFilter batch_bf(kInitialBitSize, kInitialCutoff);
+    auto start = std::chrono::steady_clock::now();
+    for (int64 i = 0; i < kNumKeys; ++i)
+        bf.Insert(present[i]);
+    auto end = std::chrono::steady_clock::now();
+    double insert_ns = std::chrono::duration<double, std::nano>(end - start).count() / kNumKeys;
+    start = std::chrono::steady_clock::now();
+    for (int64 i = 0; i < kNumKeys; i += kBatch)
+        batch_bf.InsertBatch(present + i, std::min(kBatch, kNumKeys - i));
+    end = std::chrono::steady_clock::now();
+    double batch_insert_ns =
+            std::chrono::duration<double, std::nano>(end - start).count() / kNumKeys;
+    EXPECT_EQ(bf.NumInserts(), batch_bf.NumInserts());
+    LOG(INFO) << "Insert(): " << insert_ns << " ns/key; InsertBatch(): " << batch_insert_ns
+              << " ns/key, into filters of " << bf.BitSize() / 8 / 1024 / 1024 << " MB in total";
+
+    for (const uint64* probe : {present, absent}) {
+        int64 num_found = 0;
+        start = std::chrono::steady_clock::now();
+        for (int64 i = 0; i < kNumKeys; ++i)
+            num_found += bf.Contains(probe[i]);
+        end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / kNumKeys;
+
+        int64 num_batch_found = 0;
+        start = std::chrono::steady_clock::now();
+        for (int64 i = 0; i < kNumKeys; i += kBatch) {
+            const int64 n = std::min(kBatch, kNumKeys - i);
+            bf.ContainsBatch(probe + i, n, results);
+            num_batch_found += std::count(results, results + n, true);
+        }
+        end = std::chrono::steady_clock::now();
+        double batch_ns = std::chrono::duration<double, std::nano>(end - start).count() / kNumKeys;
+        EXPECT_EQ(num_found, num_batch_found);
+        LOG(INFO) << "Contains() of " << (probe == present ? "present" : "absent") << " keys: "
+                  << ns << " ns/key; ContainsBatch(): " << batch_ns << " ns/key";
+    }
+}
+
+TEST_F(ExpandableBloomFilterTest, LookupBenchmark) {
+    // Lookup latency as the filter grows from 1M to 100M elements, through 8 filters of 10 bits
+    // per element and more, 195 MB in total at the end. A kMaxNumKeys of 1B makes 11 filters of
+    // about 1.7 GB.
+    const int64 kInitialCutoff = 1000000;
+    const int64 kMaxNumKeys = 100000000;
+    const int64 kNumProbes = 1000000;
+    const int64 kBatch = 1024;
+    auto key = [](int64 i) { return cpp_base::Hash64NumWithSeed(i, 1); };
+    std::mt19937_64 rand_gen(1);
+    vector<uint64> keys(kBatch);
+    vector<uint64> probes(kNumProbes);
+    bool results[kBatch];
+
+    ExpandableBloomFilter bf(kInitialCutoff * 10, kInitialCutoff);
+    int64 num_keys = 0;
+    for (int64 checkpoint = kInitialCutoff; checkpoint <= kMaxNumKeys; checkpoint *= 10) {
+        while (num_keys < checkpoint) {
+            const int64 n = std::min(kBatch, checkpoint - num_keys);
+            for (int64 k = 0; k < n; ++k)
+                keys[k] = key(num_keys + k);
+            bf.InsertBatch(keys.data(), n);
+            num_keys += n;
+        }
+
+        for (bool present : {true, false}) {
+            // Absent keys are the ones numbered past the inserted ones.
+            for (uint64& probe : probes)
+                probe = key(present ? rand_gen() % num_keys : num_keys + rand_gen() % num_keys);
+            int64 num_found = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (uint64 probe : probes)
+                num_found += bf.Contains(probe);
+            auto end = std::chrono::steady_clock::now();
+            const double ns =
+                    std::chrono::duration<double, std::nano>(end - start).count() / kNumProbes;
+
+            int64 num_batch_found = 0;
+            start = std::chrono::steady_clock::now();
+            for (int64 i = 0; i < kNumProbes; i += kBatch) {
+                const int64 n = std::min(kBatch, kNumProbes - i);
+                bf.ContainsBatch(probes.data() + i, n, results);
+                num_batch_found += std::count(results, results + n, true);
+            }
+            end = std::chrono::steady_clock::now();
+            const double batch_ns =
+                    std::chrono::duration<double, std::nano>(end - start).count() / kNumProbes;
+            EXPECT_EQ(num_found, num_batch_found);
+            if (present) {
+                EXPECT_EQ(kNumProbes, num_found);
+            }
+
+            LOG(INFO) << num_keys << " keys, " << bf.NumFilters() << " filters of "
+                      << bf.BitSize() / 8 / 1024 / 1024 << " MB: Contains() of "
+                      << (present ? "present" : "absent") << " keys: " << ns
+                      << " ns/key; ContainsBatch(): " << batch_ns << " ns/key"
+                      << (present ? "" : ", false positives: " +
+                                         std::to_string(num_found * 100. / kNumProbes) + "%");
+        }
+    }
+    LOG(INFO) << "Bound on false positives: " << bf.MaxFalsePositiveRatio() * 100 << "%";
+}
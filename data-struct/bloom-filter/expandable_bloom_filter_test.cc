@@ -1,13 +1,17 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cmath>
+#include <random>
 #include <set>
+#include <vector>
 
 #include "cpp-base/data-struct/bloom-filter/expandable_bloom_filter.h"
 #include "cpp-base/util/map_util.h"
 
 using cpp_base::ContainsKey;
 using cpp_base::ExpandableBloomFilter;
+using std::vector;
 
 class ExpandableBloomFilterTest : public ::testing::Test {
   public:
@@ -64,8 +68,9 @@ TEST_F(ExpandableBloomFilterTest, BasicTest) {
     // need to try more than one insertion.
     for (int i = 101; !bf.Insert(i); ++i) {}
 
-    // The filter should have expanded.
-    EXPECT_EQ(2000, bf.BitSize());
+    // The filter should have expanded, by a filter for 0.8 times the false positive ratio of the
+    // first one: 1048 bits for 100 elements.
+    EXPECT_EQ(2048, bf.BitSize());
 #endif
 
 
@@ -107,3 +112,121 @@ TEST_F(ExpandableBloomFilterTest, StatisticalTest) {
     LOG(INFO) << "False positive ratio: " << fp << "%";
     CHECK_LE(fp, 1);
 }
+
+TEST_F(ExpandableBloomFilterTest, ScalableTest) {
+    // 10 bits per element, growing 1024 times: 11 filters.
+    const int64 kNumKeys = 1000 << 10;
+    std::mt19937_64 rand_gen(1);
+    vector<uint64> keys(kNumKeys);
+    for (uint64& key : keys)
+        key = rand_gen();
+
+    ExpandableBloomFilter bf(10000, 1000, 1);
+    ExpandableBloomFilter scalable_bf(10000, 1000);
+    for (uint64 key : keys) {
+        bf.Insert(key);
+        scalable_bf.Insert(key);
+    }
+    EXPECT_EQ(11, scalable_bf.NumFilters());
+    for (uint64 key : keys)
+        EXPECT_TRUE(scalable_bf.Contains(key));
+
+    int64 num_fp = 0, num_scalable_fp = 0;
+    for (int64 i = 0; i < kNumKeys; ++i) {
+        const uint64 key = rand_gen();
+        num_fp += bf.Contains(key);
+        num_scalable_fp += scalable_bf.Contains(key);
+    }
+    const double fpr = num_fp * 1. / kNumKeys;
+    const double scalable_fpr = num_scalable_fp * 1. / kNumKeys;
+    LOG(INFO) << "False positive ratio: " << fpr * 100 << "% with " << bf.BitSize() * 1. / kNumKeys
+              << " bits/key; tightened: " << scalable_fpr * 100 << "% with "
+              << scalable_bf.BitSize() * 1. / kNumKeys << " bits/key, bound "
+              << scalable_bf.MaxFalsePositiveRatio() * 100 << "%";
+    EXPECT_LT(scalable_fpr, fpr / 2);
+    EXPECT_LT(scalable_fpr, scalable_bf.MaxFalsePositiveRatio());
+    EXPECT_EQ(1, bf.MaxFalsePositiveRatio());
+
+    // Each filter is sized for its ratio.
+    EXPECT_NEAR(0.01, std::pow(1 - std::exp(-7. * 1000000 /
+                                            ExpandableBloomFilter::BitSizeFor(1000000, 0.01)), 7),
+                1e-4);
+    EXPECT_NEAR(0.0001, std::pow(1 - std::exp(-8. * 1000000 /
+                                              ExpandableBloomFilter::BitSizeFor(1000000, 0.0001)),
+                                 8), 1e-6);
+}
+
+TEST_F(ExpandableBloomFilterTest, ConsolidationTest) {
+    ExpandableBloomFilter bf(1000, 100, ExpandableBloomFilter::kDefaultTighteningRatio, 1 << 16);
+    ExpandableBloomFilter unconsolidated_bf(1000, 100);
+    std::mt19937_64 rand_gen(1);
+    vector<uint64> keys(200000);
+    for (uint64& key : keys)
+        key = rand_gen();
+
+    // Up to 2^16 keys, the first filters get merged at each expansion: there are only two.
+    for (int64 i = 0; i < keys.size(); ++i) {
+        bf.Insert(keys[i]);
+        unconsolidated_bf.Insert(keys[i]);
+        if (bf.NumInserts() <= 1 << 16) {
+            EXPECT_LE(bf.NumFilters(), 2) << i;
+        }
+    }
+    EXPECT_EQ(unconsolidated_bf.NumFilters() - 9, bf.NumFilters());
+    for (uint64 key : keys)
+        EXPECT_TRUE(bf.Contains(key));
+
+    int64 num_fp = 0;
+    for (int64 i = 0; i < keys.size(); ++i)
+        num_fp += bf.Contains(rand_gen());
+    EXPECT_LT(num_fp * 1. / keys.size(), bf.MaxFalsePositiveRatio());
+
+    bf.Clear();
+    EXPECT_EQ(1000, bf.BitSize());
+    EXPECT_EQ(1, bf.NumFilters());
+    EXPECT_FALSE(bf.Contains(keys[0]));
+}
+
+TEST_F(ExpandableBloomFilterTest, BatchTest) {
+    ExpandableBloomFilter bf(1000, 100);
+    ExpandableBloomFilter batch_bf(1000, 100);
+    vector<uint64> keys;
+    for (int i = 0; i < 3000; ++i)
+        keys.push_back(rand() % 2000);  // NOLINT; with duplicates, also within a batch
+
+    // Same results as one by one, across several expansions.
+    bool results[3000];
+    const int64 num_inserted = batch_bf.InsertBatch(keys.data(), 1000, results);
+    EXPECT_EQ(num_inserted, std::count(results, results + 1000, true));
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(bf.Insert(keys[i]), results[i]) << i;
+    EXPECT_EQ(batch_bf.NumInserts(), bf.NumInserts());
+    EXPECT_EQ(batch_bf.BitSize(), bf.BitSize());
+    EXPECT_GT(bf.BitSize(), 1000);
+
+    for (int64 n : {0, 1, 17, 3000}) {
+        batch_bf.ContainsBatch(keys.data(), n, results);
+        for (int i = 0; i < n; ++i)
+            EXPECT_EQ(bf.Contains(keys[i]), results[i]) << i;
+    }
+}
+
+TEST_F(ExpandableBloomFilterTest, BatchConsolidationTest) {
+    // At 4 bits per key, many keys of a batch are false positives of the filters they are looked
+    // up in, which get consolidated during the batch.
+    ExpandableBloomFilter bf(400, 100, ExpandableBloomFilter::kDefaultTighteningRatio, 1 << 16);
+    ExpandableBloomFilter batch_bf(400, 100, ExpandableBloomFilter::kDefaultTighteningRatio,
+                                   1 << 16);
+    std::mt19937_64 rand_gen(1);
+    vector<uint64> keys(50000);
+    for (uint64& key : keys)
+        key = rand_gen();
+
+    bool results[50000];
+    batch_bf.InsertBatch(keys.data(), keys.size(), results);
+    for (int64 i = 0; i < keys.size(); ++i)
+        ASSERT_EQ(bf.Insert(keys[i]), results[i]) << i;
+    EXPECT_EQ(batch_bf.NumFilters(), bf.NumFilters());
+    for (uint64 key : keys)
+        ASSERT_TRUE(batch_bf.Contains(key));
+}
@@ -0,0 +1,58 @@
+#ifndef CPP_BASE_DATA_STRUCT_CACHE_TRACE_TEST_UTIL_H_
+#define CPP_BASE_DATA_STRUCT_CACHE_TRACE_TEST_UTIL_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "cpp-base/hash/hash.h"
+#include "cpp-base/integral_types.h"
+
+namespace cpp_base {
+
+// Access traces to compare the hit ratios of caches in tests.
+
+// Returns 'n' keys drawn from a Zipf distribution over 'num_keys' distinct
+// keys with exponent 's'. Each key is a hash of its popularity rank in
+// [0, num_keys), a non-negative 63-bit value, so that popularity is scattered
+// over the key space.
+inline std::vector<int64> ZipfTrace(int64 num_keys, double s, int64 n) {
+    std::vector<double> cdf(num_keys);
+    double sum = 0;
+    for (int64 i = 0; i < num_keys; ++i) {
+        sum += 1. / std::pow(i + 1, s);
+        cdf[i] = sum;
+    }
+    std::mt19937_64 rand_gen(1234);
+    std::uniform_real_distribution<double> uniform(0, sum);
+    std::vector<int64> trace(n);
+    for (int64& key : trace) {
+        int64 rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(rand_gen)) - cdf.begin();
+        key = Hash64NumWithSeed(rank, 17) >> 1;
+    }
+    return trace;
+}
+
+// Replays the trace as a read-through cache: look up, and Put() on a miss.
+// Returns the hit ratio; 'ns_per_op' is set to the average time per access.
+template <class Map>
+double Replay(const std::vector<int64>& trace, Map* m, double* ns_per_op) {
+    int64 hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int64 key : trace) {
+        int64 value;
+        if (m->GetWithTouch(key, &value))
+            ++hits;
+        else
+            m->Put(key, key);
+    }
+    *ns_per_op = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / trace.size();
+    return hits * 1. / trace.size();
+}
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_CACHE_TRACE_TEST_UTIL_H_
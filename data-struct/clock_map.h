@@ -0,0 +1,191 @@
+#ifndef CPP_BASE_DATA_STRUCT_CLOCK_MAP_H_
+#define CPP_BASE_DATA_STRUCT_CLOCK_MAP_H_
+
+#include <glog/logging.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cpp-base/hash/hash.h"
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+#include "cpp-base/util/map_util.h"
+
+namespace cpp_base {
+
+// A bounded-size map with the same API as LruMap, but evicting by the CLOCK
+// algorithm, an approximation of LRU: entries sit in a circular array, each
+// with a 'referenced' bit. A hit only sets that bit; eviction sweeps a hand
+// around the array, clearing set bits and evicting the first entry whose bit
+// is already clear. So a read hit writes a single byte, instead of relinking
+// three list nodes as in LruMap::GetWithTouch().
+//
+// This class is *not* thread safe in general. As an exception, GetWithTouch()
+// and Touch() change nothing but the (atomic) reference bits, so they may run
+// concurrently with each other and with the other const methods, e.g., all
+// under the reader side of a reader-writer lock.
+template <class KeyType, class ValueType>
+class ClockMap {
+  public:
+    explicit ClockMap(int64 capacity)
+            : capacity_(capacity),
+              referenced_(new std::atomic<uint8>[capacity]()) {
+        CHECK_GT(capacity, 0);
+    }
+    ~ClockMap() {}
+
+    bool Empty() const { return map_.empty(); }
+    size_t Size() const { return map_.size(); }
+    int64 Capacity() const { return capacity_; }
+    bool Contains(const KeyType& key) const { return ContainsKey(map_, key); }
+
+    void Clear() {
+        map_.clear();
+        entries_.clear();
+        used_.clear();
+        free_slots_.clear();
+        hand_ = 0;
+    }
+
+    // Insert the given key and value. If the key existed, its value is updated
+    // and it is marked as referenced. Returns whether the key already existed.
+    bool Put(const KeyType& key,
+             const ValueType& value,
+             ValueType* evicted_value = nullptr) {
+        typename MapType::iterator map_it = map_.find(key);
+        if (map_it != map_.end()) {
+            entries_[map_it->second].second = value;
+            referenced_[map_it->second].store(1, std::memory_order_relaxed);
+            return true;
+        }
+        CHECK_LE(map_.size(), capacity_);
+        if (map_.size() == capacity_)
+            CHECK(EvictOldest(evicted_value));
+
+        int64 slot;
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+            entries_[slot] = std::make_pair(key, value);
+        } else {
+            slot = entries_.size();
+            entries_.push_back(std::make_pair(key, value));
+            used_.push_back(false);
+        }
+        used_[slot] = true;
+        // New entries start unreferenced: one that is never hit again is
+        // evicted at the first sweep that reaches it.
+        referenced_[slot].store(0, std::memory_order_relaxed);
+        map_[key] = slot;
+        return false;
+    }
+
+    // Gets the value mapped for the given key without marking it as referenced.
+    // 'value' cannot be nullptr.
+    bool GetWithoutTouch(const KeyType& key, ValueType* value) const {
+        typename MapType::const_iterator map_it = map_.find(key);
+        if (map_it == map_.end())
+            return false;
+        *value = entries_[map_it->second].second;
+        return true;
+    }
+
+    // Returns whether the map contains 'key'. If so, it is marked as referenced
+    // and optionally the mapped value is copied to 'value', if a non-null
+    // pointer is given. See the class comment for thread safety.
+    bool GetWithTouch(const KeyType& key, ValueType* value /*can be nullptr*/) const {
+        typename MapType::const_iterator map_it = map_.find(key);
+        if (map_it == map_.end())
+            return false;
+        if (value != nullptr)
+            *value = entries_[map_it->second].second;
+        // Skip the store if the bit is set already, to keep the line shared.
+        std::atomic<uint8>& ref = referenced_[map_it->second];
+        if (ref.load(std::memory_order_relaxed) == 0)
+            ref.store(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool Touch(const KeyType& key) const { return GetWithTouch(key, nullptr); }
+
+    // Removes the given key. Returns whether it existed. The mapped value is
+    // filled in 'value', if non-null.
+    bool Erase(const KeyType& key, ValueType* value = nullptr) {
+        typename MapType::iterator map_it = map_.find(key);
+        if (map_it == map_.end())
+            return false;
+        int64 slot = map_it->second;
+        if (value != nullptr)
+            *value = entries_[slot].second;
+        map_.erase(map_it);
+        FreeSlot(slot);
+        return true;
+    }
+
+    // Removes the entry chosen by the clock hand, i.e., the first unreferenced
+    // one, clearing the reference bits it passes. Returns whether the map was
+    // non-empty. The evicted value is filled in 'value', if non-null.
+    bool EvictOldest(ValueType* value /*can be nullptr*/) {
+        if (map_.empty())
+            return false;
+        // Terminates within two rounds: the first one clears all bits.
+        while (true) {
+            if (hand_ >= entries_.size())
+                hand_ = 0;
+            if (used_[hand_]) {
+                if (referenced_[hand_].load(std::memory_order_relaxed) == 0)
+                    break;
+                referenced_[hand_].store(0, std::memory_order_relaxed);
+            }
+            ++hand_;
+        }
+        const int64 slot = hand_++;
+        if (value != nullptr)
+            *value = entries_[slot].second;
+        int ret = map_.erase(entries_[slot].first);
+        CHECK_EQ(ret, 1);  // Must have existed
+        FreeSlot(slot);
+        return true;
+    }
+
+    // An intensive check for internal consistency. Do not call frequently.
+    void CheckInternalCorrectness() const {
+        CHECK_EQ(entries_.size(), used_.size());
+        int64 num_used = 0;
+        for (int64 slot = 0; slot < entries_.size(); ++slot) {
+            if (!used_[slot])
+                continue;
+            ++num_used;
+            typename MapType::const_iterator map_it = map_.find(entries_[slot].first);
+            CHECK(map_it != map_.end());
+            CHECK_EQ(map_it->second, slot);
+        }
+        CHECK_EQ(num_used, map_.size());
+        CHECK_EQ(num_used + free_slots_.size(), entries_.size());
+    }
+
+  private:
+    typedef hash_map<KeyType, int64 /*slot*/> MapType;
+
+    void FreeSlot(int64 slot) {
+        used_[slot] = false;
+        // Release whatever the key and value hold on the heap.
+        entries_[slot] = std::pair<KeyType, ValueType>();
+        free_slots_.push_back(slot);
+    }
+
+    const int64 capacity_;
+    MapType map_;
+    std::vector<std::pair<KeyType, ValueType>> entries_;  // The circular array
+    std::vector<bool> used_;                               // Per slot of entries_
+    std::unique_ptr<std::atomic<uint8>[]> referenced_;     // Per slot; 'capacity_' of them
+    std::vector<int64> free_slots_;                        // Unused slots below entries_.size()
+    int64 hand_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(ClockMap);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_CLOCK_MAP_H_
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "cpp-base/data-struct/cache_trace_test_util.h"
+#include "cpp-base/data-struct/clock_map.h"
+#include "cpp-base/data-struct/lru_map.h"
+
+using cpp_base::ClockMap;
+using cpp_base::LruMap;
+using cpp_base::Replay;
+using cpp_base::ZipfTrace;
+using std::vector;
+
+class ClockMapTest : public ::testing::Test {
+  public:
+    ClockMapTest() { }
+    ~ClockMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+TEST_F(ClockMapTest, Benchmark) {
+    const int64 kNumKeys = 1000000;
+    const int64 kTraceLength = 5000000;
+    for (double s : {0.8, 0.99}) {
+        vector<int64> trace = ZipfTrace(kNumKeys, s, kTraceLength);
+        for (int64 capacity : {kNumKeys / 100, kNumKeys / 10}) {
+            LruMap<int64, int64> lru(capacity);
+            ClockMap<int64, int64> clock(capacity);
+            double lru_ns, clock_ns;
+            double lru_hit = Replay(trace, &lru, &lru_ns);
+            double clock_hit = Replay(trace, &clock, &clock_ns);
+            LOG(INFO) << "Zipf s=" << s << ", capacity=" << capacity
+                      << ": LruMap hit ratio " << lru_hit << ", " << lru_ns << " ns/op"
+                      << "; ClockMap hit ratio " << clock_hit << ", " << clock_ns << " ns/op";
+            // CLOCK approximates LRU; it shouldn't be much worse.
+            EXPECT_GT(clock_hit, lru_hit - 0.02);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "cpp-base/data-struct/clock_map.h"
+
+using cpp_base::ClockMap;
+using std::string;
+
+class ClockMapTest : public ::testing::Test {
+  public:
+    ClockMapTest() { }
+    ~ClockMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+TEST_F(ClockMapTest, BasicTest) {
+    ClockMap<string, int> m(3);
+    int x;
+    EXPECT_TRUE(m.Empty());
+    EXPECT_FALSE(m.Contains("one"));
+    EXPECT_FALSE(m.GetWithTouch("one", &x));
+    EXPECT_FALSE(m.EvictOldest(&x));
+
+    EXPECT_FALSE(m.Put("one", 1));
+    EXPECT_FALSE(m.Put("two", 2));
+    EXPECT_FALSE(m.Put("three", 3));
+    EXPECT_TRUE(m.Put("three", 33));
+    EXPECT_EQ(3, m.Size());
+    EXPECT_TRUE(m.GetWithoutTouch("three", &x));
+    EXPECT_EQ(33, x);
+    m.CheckInternalCorrectness();
+
+    // "one" is referenced, so the hand skips it (clearing its bit) and evicts "two".
+    EXPECT_TRUE(m.Touch("one"));
+    EXPECT_FALSE(m.Put("four", 4, &x));
+    EXPECT_EQ(2, x);
+    EXPECT_FALSE(m.Contains("two"));
+
+    // "three" was referenced by the Put() above; "one" is not referenced any more.
+    EXPECT_FALSE(m.Put("five", 5, &x));
+    EXPECT_EQ(1, x);
+    EXPECT_TRUE(m.Contains("three"));
+    EXPECT_TRUE(m.Contains("four"));
+    m.CheckInternalCorrectness();
+
+    EXPECT_TRUE(m.Erase("four", &x));
+    EXPECT_EQ(4, x);
+    EXPECT_FALSE(m.Erase("four"));
+    EXPECT_EQ(2, m.Size());
+    EXPECT_FALSE(m.Put("six", 6));  // Reuses the freed slot without eviction
+    EXPECT_EQ(3, m.Size());
+    m.CheckInternalCorrectness();
+
+    m.Clear();
+    EXPECT_TRUE(m.Empty());
+    m.CheckInternalCorrectness();
+}
+
+TEST_F(ClockMapTest, RandomOperations) {
+    ClockMap<int, int> m(100);
+    srand(1);
+    for (int i = 0; i < 200000; ++i) {
+        int key = rand() % 300;  // NOLINT
+        int value;
+        switch (rand() % 4) {  // NOLINT
+            case 0: m.Put(key, key); break;
+            case 1:
+                if (m.GetWithTouch(key, &value)) {
+                    EXPECT_EQ(key, value);
+                }
+                break;
+            case 2: m.Erase(key); break;
+            case 3: if (rand() % 10 == 0) m.EvictOldest(nullptr); break;  // NOLINT
+        }
+        EXPECT_LE(m.Size(), 100);
+        if (i % 10000 == 0)
+            m.CheckInternalCorrectness();
+    }
+    m.CheckInternalCorrectness();
+}
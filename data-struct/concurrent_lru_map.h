@@ -0,0 +1,191 @@
+#ifndef CPP_BASE_DATA_STRUCT_CONCURRENT_LRU_MAP_H_
+#define CPP_BASE_DATA_STRUCT_CONCURRENT_LRU_MAP_H_
+
+#include <glog/logging.h>
+#include <atomic>
+#include <memory>
+#include <mutex>    // NOLINT
+#include <vector>
+
+#include "cpp-base/data-struct/lru_map.h"
+#include "cpp-base/hash/hash.h"
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+#include "cpp-base/mutex.h"
+
+namespace cpp_base {
+
+// A thread-safe LruMap. Keys are spread by hash over a number of shards, each
+// being an independently locked LruMap with 1/num_shards of the capacity, so
+// threads working on different shards never contend. The capacity must be at
+// least num_shards; Size() never exceeds it. LRU order (hence
+// eviction) is per shard, which approximates a global LRU well when keys are
+// spread evenly.
+//
+// With 'buffered_reads', GetWithTouch() takes only the shard's reader lock, so
+// concurrent hits on the same shard proceed in parallel. The recency update is
+// deferred: the key is appended to a small per-shard buffer which is applied
+// to the LRU order under the writer lock once it fills up, or at the next
+// write to that shard. Under heavy contention some of these deferred touches
+// are dropped rather than waited for, which only makes the LRU order slightly
+// less exact.
+template <class KeyType, class ValueType>
+class ConcurrentLruMap {
+  public:
+    ConcurrentLruMap(int64 capacity, int num_shards, bool buffered_reads = false)
+            : capacity_(capacity), buffered_reads_(buffered_reads) {
+        CHECK_GT(num_shards, 0);
+        CHECK_GE(capacity, num_shards);
+        // The first capacity % num_shards shards hold one entry more, so that
+        // the shards' capacities add up to exactly 'capacity'.
+        for (int i = 0; i < num_shards; ++i)
+            shards_.emplace_back(new Shard(capacity / num_shards + (i < capacity % num_shards)));
+    }
+    ~ConcurrentLruMap() {}
+
+    // Sum of the shards' sizes. Lock-free; may be momentarily stale.
+    int64 Size() const { return size_.load(std::memory_order_relaxed); }
+    bool Empty() const { return Size() == 0; }
+    int64 Capacity() const { return capacity_; }
+    int NumShards() const { return shards_.size(); }
+
+    // Same as LruMap::Put(). The evicted value, if any, is of the key's shard.
+    bool Put(const KeyType& key, const ValueType& value, ValueType* evicted_value = nullptr) {
+        Shard* shard = GetShard(key);
+        WriterMutexLock lock(&shard->mutex);
+        DrainReadBuffer(shard);
+        const int64 old_size = shard->map.Size();
+        bool existed = shard->map.Put(key, value, evicted_value);
+        size_.fetch_add(shard->map.Size() - old_size, std::memory_order_relaxed);
+        return existed;
+    }
+
+    // Same as LruMap::GetWithTouch(); see the class comment for 'buffered_reads'.
+    bool GetWithTouch(const KeyType& key, ValueType* value /*can be nullptr*/) {
+        Shard* shard = GetShard(key);
+        if (!buffered_reads_) {
+            WriterMutexLock lock(&shard->mutex);
+            return shard->map.GetWithTouch(key, value);
+        }
+        {
+            ReaderMutexLock lock(&shard->mutex);
+            if (value != nullptr) {
+                if (!shard->map.GetWithoutTouch(key, value))
+                    return false;
+            } else if (!shard->map.Contains(key)) {
+                return false;
+            }
+        }
+        RecordRead(shard, key);
+        return true;
+    }
+
+    bool Touch(const KeyType& key) { return GetWithTouch(key, nullptr); }
+
+    bool GetWithoutTouch(const KeyType& key, ValueType* value) const {
+        Shard* shard = GetShard(key);
+        ReaderMutexLock lock(&shard->mutex);
+        return shard->map.GetWithoutTouch(key, value);
+    }
+
+    bool Contains(const KeyType& key) const {
+        Shard* shard = GetShard(key);
+        ReaderMutexLock lock(&shard->mutex);
+        return shard->map.Contains(key);
+    }
+
+    bool Erase(const KeyType& key, ValueType* value = nullptr) {
+        Shard* shard = GetShard(key);
+        WriterMutexLock lock(&shard->mutex);
+        DrainReadBuffer(shard);
+        if (!shard->map.Erase(key, value))
+            return false;
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void Clear() {
+        for (auto& shard : shards_) {
+            WriterMutexLock lock(&shard->mutex);
+            {
+                std::lock_guard<std::mutex> buffer_lock(shard->read_buffer_mutex);
+                shard->read_buffer.clear();
+            }
+            size_.fetch_sub(shard->map.Size(), std::memory_order_relaxed);
+            shard->map.Clear();
+        }
+    }
+
+    // An intensive check for internal consistency. Do not call frequently,
+    // and not concurrently with writers.
+    void CheckInternalCorrectness() const {
+        int64 size = 0;
+        for (const auto& shard : shards_) {
+            ReaderMutexLock lock(&shard->mutex);
+            shard->map.CheckInternalCorrectness();
+            size += shard->map.Size();
+        }
+        CHECK_EQ(size, Size());
+    }
+
+  private:
+    // Number of deferred touches per shard that triggers applying them.
+    static const int kReadBufferSize = 64;
+
+    struct Shard {
+        explicit Shard(int64 capacity) : map(capacity) {
+            read_buffer.reserve(kReadBufferSize);
+        }
+        mutable Mutex mutex;                // Guards 'map'
+        LruMap<KeyType, ValueType> map;
+        std::mutex read_buffer_mutex;       // Guards 'read_buffer'
+        std::vector<KeyType> read_buffer;   // Keys of deferred touches
+    };
+
+    Shard* GetShard(const KeyType& key) const {
+        // Re-mix the hash: hash<> is the identity for integers and the shards'
+        // hash_maps already bucket by its low bits.
+        uint64 h = Hash64NumWithSeed(hash<KeyType>()(key), 0x9ae16a3b2f90404fULL);
+        return shards_[h % shards_.size()].get();
+    }
+
+    // Called after a hit under the reader lock. Never blocks: if the buffer is
+    // busy the touch is dropped, and if the shard is busy draining is left to
+    // whoever holds the writer lock next.
+    void RecordRead(Shard* shard, const KeyType& key) {
+        bool full;
+        {
+            std::unique_lock<std::mutex> buffer_lock(shard->read_buffer_mutex, std::try_to_lock);
+            if (!buffer_lock.owns_lock())
+                return;
+            if (shard->read_buffer.size() < kReadBufferSize)
+                shard->read_buffer.push_back(key);
+            full = shard->read_buffer.size() >= kReadBufferSize;
+        }
+        if (full && shard->mutex.TryLock()) {
+            DrainReadBuffer(shard);
+            shard->mutex.Unlock();
+        }
+    }
+
+    // Applies the deferred touches. Must hold the shard's writer lock.
+    void DrainReadBuffer(Shard* shard) {
+        if (!buffered_reads_)
+            return;
+        std::lock_guard<std::mutex> buffer_lock(shard->read_buffer_mutex);
+        for (const KeyType& key : shard->read_buffer)
+            shard->map.Touch(key);  // A no-op if the key is gone since
+        shard->read_buffer.clear();
+    }
+
+    const int64 capacity_;
+    const bool buffered_reads_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<int64> size_{0};
+
+    DISALLOW_COPY_AND_ASSIGN(ConcurrentLruMap);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_CONCURRENT_LRU_MAP_H_
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "cpp-base/data-struct/concurrent_lru_map.h"
+#include "cpp-base/mutex.h"
+
+using cpp_base::ConcurrentLruMap;
+using cpp_base::LruMap;
+
+class ConcurrentLruMapTest : public ::testing::Test {
+  public:
+    ConcurrentLruMapTest() { }
+    ~ConcurrentLruMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    // Runs 'num_threads' threads each doing 'num_ops' lookups of keys all
+    // present in the cache. Returns the total throughput in million ops/sec.
+    template <class Lookup>
+    static double MeasureHitThroughput(int num_threads, int num_ops, int num_keys,
+                                       const Lookup& lookup) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                uint64 key = t;
+                for (int i = 0; i < num_ops; ++i) {
+                    key = (key * 6364136223846793005ULL + 1442695040888963407ULL);
+                    lookup((key >> 33) % num_keys);
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+        double secs = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+        return num_threads * 1. * num_ops / secs / 1e6;
+    }
+};
+
+TEST_F(ConcurrentLruMapTest, Benchmark) {
+    const int kNumKeys = 100000;
+    const int kNumOpsPerThread = 20000;
+
+    cpp_base::Mutex global_mutex;
+    LruMap<int, int> global_map(kNumKeys);
+    ConcurrentLruMap<int, int> sharded(kNumKeys * 2, 64);
+    ConcurrentLruMap<int, int> buffered(kNumKeys * 2, 64, true);
+    for (int i = 0; i < kNumKeys; ++i) {
+        global_map.Put(i, i);
+        sharded.Put(i, i);
+        buffered.Put(i, i);
+    }
+
+    for (int num_threads = 1; num_threads <= 64; num_threads *= 2) {
+        double global = MeasureHitThroughput(num_threads, kNumOpsPerThread, kNumKeys,
+                [&](int key) {
+                    cpp_base::MutexLock lock(&global_mutex);
+                    int value;
+                    CHECK(global_map.GetWithTouch(key, &value));
+                });
+        double sharded_mops = MeasureHitThroughput(num_threads, kNumOpsPerThread, kNumKeys,
+                [&](int key) {
+                    int value;
+                    CHECK(sharded.GetWithTouch(key, &value));
+                });
+        double buffered_mops = MeasureHitThroughput(num_threads, kNumOpsPerThread, kNumKeys,
+                [&](int key) {
+                    int value;
+                    CHECK(buffered.GetWithTouch(key, &value));
+                });
+        LOG(INFO) << num_threads << " threads: hit Mops/s: global mutex: " << global
+                  << "; 64 shards: " << sharded_mops
+                  << "; 64 shards + buffered reads: " << buffered_mops;
+    }
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cpp-base/data-struct/concurrent_lru_map.h"
+
+using cpp_base::ConcurrentLruMap;
+using std::string;
+
+class ConcurrentLruMapTest : public ::testing::Test {
+  public:
+    ConcurrentLruMapTest() { }
+    ~ConcurrentLruMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+TEST_F(ConcurrentLruMapTest, BasicTest) {
+    ConcurrentLruMap<string, int> m(100, 8);
+    int x;
+    EXPECT_TRUE(m.Empty());
+    EXPECT_EQ(8, m.NumShards());
+    EXPECT_FALSE(m.Contains("one"));
+    EXPECT_FALSE(m.GetWithTouch("one", &x));
+
+    EXPECT_FALSE(m.Put("one", 1));
+    EXPECT_FALSE(m.Put("two", 2));
+    EXPECT_TRUE(m.Put("two", 22));
+    EXPECT_EQ(2, m.Size());
+    EXPECT_TRUE(m.GetWithTouch("one", &x));
+    EXPECT_EQ(1, x);
+    EXPECT_TRUE(m.GetWithoutTouch("two", &x));
+    EXPECT_EQ(22, x);
+
+    EXPECT_TRUE(m.Erase("one", &x));
+    EXPECT_EQ(1, x);
+    EXPECT_FALSE(m.Erase("one"));
+    EXPECT_EQ(1, m.Size());
+    m.CheckInternalCorrectness();
+
+    m.Clear();
+    EXPECT_TRUE(m.Empty());
+    EXPECT_FALSE(m.Contains("two"));
+    m.CheckInternalCorrectness();
+}
+
+TEST_F(ConcurrentLruMapTest, CapacityIsSplitExactly) {
+    // 100 entries over 8 shards: 4 shards of 13 and 4 of 12.
+    ConcurrentLruMap<int, int> m(100, 8);
+    for (int i = 0; i < 10000; ++i)
+        m.Put(i, i);
+    EXPECT_EQ(m.Capacity(), m.Size());
+    m.CheckInternalCorrectness();
+}
+
+TEST_F(ConcurrentLruMapTest, EvictionWithinShard) {
+    for (bool buffered_reads : {false, true}) {
+        // With a single shard this is an exact LRU.
+        ConcurrentLruMap<int, int> m(3, 1, buffered_reads);
+        m.Put(1, 1);
+        m.Put(2, 2);
+        m.Put(3, 3);
+        EXPECT_TRUE(m.Touch(1));
+        int evicted = -1;
+        m.Put(4, 4, &evicted);
+        EXPECT_EQ(2, evicted) << buffered_reads;
+        EXPECT_TRUE(m.Contains(1));
+        EXPECT_FALSE(m.Contains(2));
+        EXPECT_EQ(3, m.Size());
+        m.CheckInternalCorrectness();
+    }
+}
+
+TEST_F(ConcurrentLruMapTest, ConcurrentTest) {
+    for (bool buffered_reads : {false, true}) {
+        ConcurrentLruMap<int, int> m(1000, 16, buffered_reads);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&m, t]() {
+                unsigned int seed = t;
+                for (int i = 0; i < 100000; ++i) {
+                    int key = rand_r(&seed) % 5000;
+                    int op = rand_r(&seed) % 10;
+                    int value;
+                    if (op < 3) {
+                        m.Put(key, key * 2);
+                    } else if (op < 4) {
+                        m.Erase(key);
+                    } else if (m.GetWithTouch(key, &value)) {
+                        EXPECT_EQ(key * 2, value);
+                    }
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+        m.CheckInternalCorrectness();
+        EXPECT_LE(m.Size(), m.Capacity());
+    }
+}
@@ -2,6 +2,11 @@
 #define CPP_BASE_DATA_STRUCT_COUNT_MIN_SKETCH_H_
 
 #include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <vector>
 
 #include "cpp-base/hash/hash.h"
 #include "cpp-base/integral_types.h"
@@ -92,12 +97,30 @@ class CountMinSketch {
         sum_counts_ = 0;
     }
 
+    // Halves all counts (rounding down). Calling this periodically ages the
+    // counts, so that the sketch reflects recent rather than all-time frequency.
+    // SumCounts() becomes the least sum of the halved cells of a row: each
+    // cell rounds down on its own, and a row where fewer keys share cells
+    // rounds down more, closer to the sum of the halved counts of the keys.
+    void HalveCounts() {
+        int64 min_sum = std::numeric_limits<int64>::max();
+        for (int64 row = 0; row < num_rows_; ++row) {
+            int64 sum = 0;
+            for (int64 col = 0; col < num_cols_; ++col) {
+                matrix_[row][col] >>= 1;
+                sum += matrix_[row][col];
+            }
+            min_sum = std::min(min_sum, sum);
+        }
+        sum_counts_ = min_sum;
+    }
+
     int64 SumCounts() const { return sum_counts_; }
 
     // Prints a distribution of the values of the count-min sketch cells.
     void DumpDistrOfCellValues() const {
         // Find out the frequency of values 1, 2, ..., 100 in CMS cells.
-        vector<int64> freq(100);
+        std::vector<int64> freq(100);
         int64 sum_freqs = 0;
         for (int64 row = 0; row < num_rows_; ++row) {
             for (int64 col = 0; col < num_cols_; ++col) {
@@ -132,7 +155,7 @@ class CountMinSketch {
     const int64 num_rows_;
     const int64 num_cols_;
     T** matrix_;
-    int64 sum_counts_;  // Overall sum across all increments and decrements
+    int64 sum_counts_;  // Overall sum across all increments and decrements, as halved
 
     // Dummy variable to catch invalid <T> instantiations at compile/link time.
     valid_type_for_cms<T> im_here_to_catch_instantiations_with_invalid_types_;
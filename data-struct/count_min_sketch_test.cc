@@ -43,6 +43,16 @@ TEST_F(CountMinSketchTest, BasicTest) {
     EXPECT_EQ(0, sketch.GetCount(200));
 }
 
+TEST_F(CountMinSketchTest, HalveCounts) {
+    CountMinSketch<uint8> sketch(1000, 0.01);
+    EXPECT_EQ(7, sketch.AddCount(100, 7));
+    EXPECT_EQ(1, sketch.AddCount(200, 1));
+    sketch.HalveCounts();
+    EXPECT_EQ(3, sketch.GetCount(100));
+    EXPECT_EQ(0, sketch.GetCount(200));
+    EXPECT_EQ(3, sketch.SumCounts());  // 7 / 2 + 1 / 2, each rounded down
+}
+
 TEST_F(CountMinSketchTest, OverflowTest) {
     // Test overflow with uint8, uint16 and uint32:
     CountMinSketch<uint8> sketch1(1000, 0.01);
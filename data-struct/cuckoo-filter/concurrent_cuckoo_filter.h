@@ -0,0 +1,324 @@
+#ifndef CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CONCURRENT_CUCKOO_FILTER_H_
+#define CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CONCURRENT_CUCKOO_FILTER_H_
+
+#include <glog/logging.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <thread>
+#include <type_traits>
+
+#include "cpp-base/data-struct/cuckoo-filter/util.h"
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+
+namespace cpp_base {
+
+// A thread-safe cuckoo filter, for many threads inserting into, deleting from and looking up one
+// shared filter rather than a CuckooFilter behind a mutex. Places keys like CuckooFilter, in
+// buckets of 4 tags of 4, 8 or 16 bits; each bucket is one atomic word.
+//
+// As in libcuckoo, buckets are guarded by a fixed number of lock stripes, each a version counter
+// that is odd while locked:
+//  - Insert() and Delete() lock the stripes of the key's two buckets, in stripe order.
+//  - When both buckets are full, Insert() first looks for a cuckoo path, i.e., tags to move each
+//    to its other bucket until one lands in an empty slot, with no lock held. Then it makes the
+//    moves, last first, each under the locks of the two buckets involved and only if they are
+//    still possible; otherwise it starts over.
+//  - Contains() takes no lock: it reads the stripe versions, the two buckets, then the versions
+//    again, and retries if a bucket was locked or changed meanwhile, so it never misses a key
+//    being moved between its buckets. Seeing the tag is enough for a positive answer.
+// Unlike CuckooFilter, there is no last victim: an Insert() that finds no path within
+// kMaxPathLength moves leaves the filter unchanged and returns false.
+template <int bits_per_tag>
+class ConcurrentCuckooFilter {
+    static_assert(bits_per_tag == 4 || bits_per_tag == 8 || bits_per_tag == 16,
+                  "Unsupported bits_per_tag");
+
+  public:
+    static const int kBitsPerElement = bits_per_tag;
+    static const int kTagsPerBucket = 4;
+
+    // Max number of lock stripes; there are fewer only for filters of fewer buckets.
+    static const int64 kMaxNumStripes = 4096;
+
+    // Max number of moves of a cuckoo path.
+    static const int kMaxPathLength = 500;
+
+    static const int kNumCounterShards = 16;
+
+    // Sized like CuckooFilter.
+    explicit ConcurrentCuckooFilter(int64 expected_num_elements) {
+        const double min_num_buckets = expected_num_elements * 1. / kTagsPerBucket;
+        num_buckets_ = upperpower2(std::ceil(min_num_buckets));
+        if (min_num_buckets / num_buckets_ >= 0.96)
+            num_buckets_ *= 2;
+        num_stripes_ = num_buckets_ < kMaxNumStripes ? num_buckets_ : kMaxNumStripes;
+        buckets_ = new std::atomic<Bucket>[num_buckets_];
+        void* stripes;
+        CHECK_EQ(posix_memalign(&stripes, sizeof(Stripe), num_stripes_ * sizeof(Stripe)), 0);
+        stripes_ = static_cast<Stripe*>(stripes);
+        for (int64 i = 0; i < num_stripes_; ++i)
+            new (&stripes_[i]) Stripe;
+        Clear();
+    }
+
+    ~ConcurrentCuckooFilter() {
+        delete[] buckets_;
+        free(stripes_);
+    }
+
+    // Returns true if the key was inserted, false if no room was found for it.
+    bool Insert(uint64 key) {
+        int64 index1;
+        uint32 tag;
+        CuckooIndexAndTag(key, num_buckets_, bits_per_tag, &index1, &tag);
+        const int64 index2 = CuckooAltIndex(index1, tag, num_buckets_);
+        Move path[kMaxPathLength];
+        for (;;) {
+            {
+                StripeLock lock(this, index1, index2);
+                if (InsertTagToBucket(index1, tag) || InsertTagToBucket(index2, tag)) {
+                    counters_[ThisThreadShard()].count.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            // Both buckets full: make room in one of them.
+            const int path_length = FindPath(index1, index2, path);
+            if (path_length < 0)
+                return false;
+            MovePath(path, path_length);
+        }
+    }
+
+    // Returns whether the given key exists in the filter, with false positives.
+    bool Contains(uint64 key) const {
+        int64 index1;
+        uint32 tag;
+        CuckooIndexAndTag(key, num_buckets_, bits_per_tag, &index1, &tag);
+        const int64 index2 = CuckooAltIndex(index1, tag, num_buckets_);
+        const std::atomic<uint64>& version1 = stripes_[StripeIndex(index1)].version;
+        const std::atomic<uint64>& version2 = stripes_[StripeIndex(index2)].version;
+        for (;;) {
+            const uint64 v1 = version1.load(std::memory_order_acquire);
+            const uint64 v2 = version2.load(std::memory_order_acquire);
+            // Both buckets read before testing either, so that their cache misses overlap.
+            const Bucket bucket1 = buckets_[index1].load(std::memory_order_relaxed);
+            const Bucket bucket2 = buckets_[index2].load(std::memory_order_relaxed);
+            if (HasTag(bucket1, tag) || HasTag(bucket2, tag))
+                return true;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (((v1 | v2) & 1) == 0 && version1.load(std::memory_order_relaxed) == v1 &&
+                version2.load(std::memory_order_relaxed) == v2) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    // Deletes the given key, which must have been inserted. Returns false if it is not found.
+    bool Delete(uint64 key) {
+        int64 index1;
+        uint32 tag;
+        CuckooIndexAndTag(key, num_buckets_, bits_per_tag, &index1, &tag);
+        const int64 index2 = CuckooAltIndex(index1, tag, num_buckets_);
+        StripeLock lock(this, index1, index2);
+        if (DeleteTagFromBucket(index1, tag) || DeleteTagFromBucket(index2, tag)) {
+            counters_[ThisThreadShard()].count.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    // Clears the filter. Must not run concurrently with other calls.
+    void Clear() {
+        for (int64 i = 0; i < num_buckets_; ++i)
+            buckets_[i].store(0, std::memory_order_relaxed);
+        for (CounterShard& counter : counters_)
+            counter.count.store(0, std::memory_order_relaxed);
+    }
+
+    int64 NumElements() const {
+        int64 sum = 0;
+        for (const CounterShard& counter : counters_)
+            sum += counter.count.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+    int64 SizeInBytes() const { return num_buckets_ * sizeof(Bucket); }
+
+    int64 NumBuckets() const { return num_buckets_; }
+
+  private:
+    // The 4 tags of a bucket, the k-th in bits k * bits_per_tag and up.
+    typedef typename std::conditional<
+            bits_per_tag == 4, uint16,
+            typename std::conditional<bits_per_tag == 8, uint32, uint64>::type>::type Bucket;
+
+    static const Bucket kTagMask = (1ULL << bits_per_tag) - 1;
+
+    struct alignas(64) Stripe {
+        std::atomic<uint64> version{0};  // Odd while locked
+    };
+
+    struct alignas(64) CounterShard {
+        std::atomic<int64> count{0};
+    };
+
+    // The move of the tag in a slot to its other bucket.
+    struct Move {
+        int64 index;
+        int slot;
+        uint32 tag;
+    };
+
+    // Locks the stripes of two buckets for its lifetime.
+    class StripeLock {
+      public:
+        StripeLock(ConcurrentCuckooFilter* filter, int64 index1, int64 index2) {
+            int64 stripe1 = filter->StripeIndex(index1);
+            int64 stripe2 = filter->StripeIndex(index2);
+            if (stripe1 > stripe2)
+                std::swap(stripe1, stripe2);
+            first_ = &filter->stripes_[stripe1];
+            second_ = stripe1 != stripe2 ? &filter->stripes_[stripe2] : nullptr;
+            Lock(first_);
+            if (second_ != nullptr)
+                Lock(second_);
+        }
+
+        ~StripeLock() {
+            if (second_ != nullptr)
+                Unlock(second_);
+            Unlock(first_);
+        }
+
+      private:
+        static void Lock(Stripe* stripe) {
+            uint64 version = stripe->version.load(std::memory_order_relaxed);
+            while ((version & 1) != 0 || !stripe->version.compare_exchange_weak(
+                    version, version + 1, std::memory_order_acquire)) {
+                std::this_thread::yield();
+                version = stripe->version.load(std::memory_order_relaxed);
+            }
+            // The odd version is visible to any reader that sees the writes that follow.
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        static void Unlock(Stripe* stripe) {
+            stripe->version.store(stripe->version.load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_release);
+        }
+
+        Stripe* first_;
+        Stripe* second_;
+
+        DISALLOW_COPY_AND_ASSIGN(StripeLock);
+    };
+
+    // The counter shard of the calling thread.
+    static int ThisThreadShard() {
+        static thread_local const int shard =
+                std::hash<std::thread::id>()(std::this_thread::get_id()) % kNumCounterShards;
+        return shard;
+    }
+
+    int64 StripeIndex(int64 index) const { return index & (num_stripes_ - 1); }
+
+    static uint32 TagAt(Bucket bucket, int slot) {
+        return (bucket >> (slot * bits_per_tag)) & kTagMask;
+    }
+
+    static bool HasTag(Bucket bucket, uint32 tag) {
+        if (bits_per_tag == 4)
+            return hasvalue4(bucket, tag);
+        if (bits_per_tag == 8)
+            return hasvalue8(bucket, tag);
+        return hasvalue16(bucket, tag);
+    }
+
+    // The first empty slot of the given bucket, or -1.
+    static int EmptySlot(Bucket bucket) {
+        for (int slot = 0; slot < kTagsPerBucket; ++slot) {
+            if (TagAt(bucket, slot) == 0)
+                return slot;
+        }
+        return -1;
+    }
+
+    // Must hold the lock of bucket i's stripe.
+    void WriteTag(int64 i, int slot, uint32 tag) {
+        const int shift = slot * bits_per_tag;
+        const Bucket bucket = buckets_[i].load(std::memory_order_relaxed);
+        buckets_[i].store((bucket & ~(kTagMask << shift)) | (static_cast<Bucket>(tag) << shift),
+                          std::memory_order_relaxed);
+    }
+
+    bool InsertTagToBucket(int64 i, uint32 tag) {
+        const int slot = EmptySlot(buckets_[i].load(std::memory_order_relaxed));
+        if (slot < 0)
+            return false;
+        WriteTag(i, slot, tag);
+        return true;
+    }
+
+    bool DeleteTagFromBucket(int64 i, uint32 tag) {
+        const Bucket bucket = buckets_[i].load(std::memory_order_relaxed);
+        for (int slot = 0; slot < kTagsPerBucket; ++slot) {
+            if (TagAt(bucket, slot) == tag) {
+                WriteTag(i, slot, 0);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Looks for a cuckoo path from one of the given buckets, by a random walk, with no lock held.
+    // Returns its number of moves, the last of which is to a bucket that had an empty slot, or -1
+    // if none was found.
+    int FindPath(int64 index1, int64 index2, Move* path) const {
+        static thread_local std::minstd_rand rand_gen(ThisThreadShard() + 1);
+        int64 index = rand_gen() % 2 == 0 ? index1 : index2;
+        for (int n = 0; n < kMaxPathLength; ++n) {
+            const int slot = rand_gen() % kTagsPerBucket;
+            const uint32 tag = TagAt(buckets_[index].load(std::memory_order_relaxed), slot);
+            if (tag == 0)
+                return n;  // Emptied since
+            path[n] = {index, slot, tag};
+            index = CuckooAltIndex(index, tag, num_buckets_);
+            if (EmptySlot(buckets_[index].load(std::memory_order_relaxed)) >= 0)
+                return n + 1;
+        }
+        return -1;
+    }
+
+    // Makes the moves of the given path, last first, while they are still possible.
+    void MovePath(const Move* path, int path_length) {
+        for (int n = path_length - 1; n >= 0; --n) {
+            const Move& move = path[n];
+            const int64 to = CuckooAltIndex(move.index, move.tag, num_buckets_);
+            StripeLock lock(this, move.index, to);
+            if (TagAt(buckets_[move.index].load(std::memory_order_relaxed), move.slot) !=
+                move.tag || !InsertTagToBucket(to, move.tag)) {
+                return;  // Raced with another writer
+            }
+            WriteTag(move.index, move.slot, 0);
+        }
+    }
+
+    int64 num_buckets_;             // A power of 2
+    int64 num_stripes_;             // A power of 2, at most num_buckets_
+    std::atomic<Bucket>* buckets_;
+    Stripe* stripes_;
+    CounterShard counters_[kNumCounterShards];  // Num elements inserted so far, by thread
+
+    DISALLOW_COPY_AND_ASSIGN(ConcurrentCuckooFilter);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CONCURRENT_CUCKOO_FILTER_H_
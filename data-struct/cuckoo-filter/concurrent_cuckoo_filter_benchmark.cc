@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "cpp-base/data-struct/cuckoo-filter/concurrent_cuckoo_filter.h"
+#include "cpp-base/data-struct/cuckoo-filter/cuckoo_filter.h"
+#include "cpp-base/thread/run_threads_test_util.h"
+
+using cpp_base::ConcurrentCuckooFilter;
+using cpp_base::CuckooFilter;
+using cpp_base::RunThreads;
+using std::vector;
+
+class ConcurrentCuckooFilterTest : public ::testing::Test {
+  public:
+    ConcurrentCuckooFilterTest() { }
+    ~ConcurrentCuckooFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+};
+
+TEST_F(ConcurrentCuckooFilterTest, Benchmark) {
+    // Total throughput of threads sharing one filter filled up to 50%, then to 90%, by 90%
+    // lookups (half of them hits) and 10% inserts, vs. a mutex around a CuckooFilter.
+    const int64 kCapacity = 16000000;
+    const int64 kNumOps = 4000000;
+    vector<uint64> keys = RandomKeys(kCapacity * 9 / 10, 1);
+    vector<uint64> absent_keys = RandomKeys(kNumOps, 2);
+    const int64 num_prefilled = kCapacity / 2;
+    for (int num_threads = 1; num_threads <= 32; num_threads *= 2) {
+        const int64 ops_per_thread = kNumOps / num_threads;
+        // Op i of thread t: inserts a new key every 10 ops, else looks up a present or absent key.
+        auto run_ops = [&](int t, const std::function<void(uint64)>& insert,
+                           const std::function<void(uint64)>& contains) {
+            int64 next_insert = num_prefilled + t;
+            for (int64 i = t * ops_per_thread; i < (t + 1) * ops_per_thread; ++i) {
+                if (i % 10 == 0) {
+                    insert(keys[next_insert]);
+                    next_insert += num_threads;
+                } else {
+                    contains(i % 2 == 0 ? keys[i % num_prefilled] : absent_keys[i]);
+                }
+            }
+        };
+
+        ConcurrentCuckooFilter<16> cf(kCapacity);
+        for (int64 i = 0; i < num_prefilled; ++i)
+            cf.Insert(keys[i]);
+        std::atomic<int64> num_found(0);
+        double secs = RunThreads(num_threads, [&](int t) {
+            int64 found = 0;
+            run_ops(t, [&](uint64 key) { cf.Insert(key); },
+                    [&](uint64 key) { found += cf.Contains(key); });
+            num_found += found;
+        });
+        const double concurrent_mops = kNumOps / secs / 1e6;
+
+        CuckooFilter<16> single_cf(kCapacity);
+        for (int64 i = 0; i < num_prefilled; ++i)
+            single_cf.Insert(keys[i]);
+        std::mutex mutex;
+        secs = RunThreads(num_threads, [&](int t) {
+            int64 found = 0;
+            run_ops(t, [&](uint64 key) {
+                std::lock_guard<std::mutex> lock(mutex);
+                single_cf.Insert(key);
+            }, [&](uint64 key) {
+                std::lock_guard<std::mutex> lock(mutex);
+                found += single_cf.Contains(key);
+            });
+            num_found += found;
+        });
+        const double mutex_mops = kNumOps / secs / 1e6;
+
+        // Up to 90% load, with inserts only.
+        secs = RunThreads(num_threads, [&](int t) {
+            for (int64 i = num_prefilled + kNumOps / 10 + t; i < keys.size(); i += num_threads)
+                cf.Insert(keys[i]);
+        });
+        const int64 num_fill_inserts = keys.size() - num_prefilled - kNumOps / 10;
+        LOG(INFO) << num_threads << " threads: mixed Mops/s: ConcurrentCuckooFilter: "
+                  << concurrent_mops << ", mutex: " << mutex_mops << "; inserts up to 90% load: "
+                  << num_fill_inserts / secs / 1e6 << " Mops/s";
+        EXPECT_GT(num_found, 0);
+    }
+    LOG(INFO) << "Hardware threads: " << std::thread::hardware_concurrency();
+}
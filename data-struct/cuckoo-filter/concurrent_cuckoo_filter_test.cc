@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+#include "cpp-base/data-struct/cuckoo-filter/concurrent_cuckoo_filter.h"
+#include "cpp-base/data-struct/cuckoo-filter/cuckoo_filter.h"
+#include "cpp-base/thread/run_threads_test_util.h"
+
+using cpp_base::ConcurrentCuckooFilter;
+using cpp_base::CuckooFilter;
+using cpp_base::RunThreads;
+using std::vector;
+
+class ConcurrentCuckooFilterTest : public ::testing::Test {
+  public:
+    ConcurrentCuckooFilterTest() { }
+    ~ConcurrentCuckooFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+};
+
+TEST_F(ConcurrentCuckooFilterTest, BasicTest) {
+    ConcurrentCuckooFilter<8> cf(10);
+    EXPECT_EQ(0, cf.NumElements());
+    EXPECT_FALSE(cf.Contains(25));
+
+    EXPECT_TRUE(cf.Insert(25));
+    EXPECT_TRUE(cf.Contains(25));
+    EXPECT_EQ(1, cf.NumElements());
+    EXPECT_FALSE(cf.Contains(35));
+
+    EXPECT_TRUE(cf.Delete(25));
+    EXPECT_FALSE(cf.Contains(25));
+    EXPECT_FALSE(cf.Delete(25));
+    EXPECT_EQ(0, cf.NumElements());
+
+    EXPECT_TRUE(cf.Insert(25));
+    cf.Clear();
+    EXPECT_EQ(0, cf.NumElements());
+    EXPECT_FALSE(cf.Contains(25));
+}
+
+TEST_F(ConcurrentCuckooFilterTest, FullTest) {
+    // Fills up to where inserts fail, with no false negatives, and false positives like those of
+    // a CuckooFilter of as many bits per tag.
+    const int64 kCapacity = 100000;
+    ConcurrentCuckooFilter<16> cf(kCapacity);
+    CuckooFilter<16> single_cf(kCapacity);
+    EXPECT_EQ(single_cf.SizeInBytes(), cf.SizeInBytes());
+    vector<uint64> keys = RandomKeys(cf.NumBuckets() * 4, 1);
+    int64 num_keys = 0;
+    while (num_keys < keys.size() && cf.Insert(keys[num_keys]))
+        ++num_keys;
+    EXPECT_EQ(num_keys, cf.NumElements());
+    const double load_factor = num_keys * 1. / (cf.NumBuckets() * 4);
+    LOG(INFO) << "Full at load factor " << load_factor;
+    EXPECT_GT(load_factor, 0.94);
+    for (int64 i = 0; i < num_keys; ++i) {
+        ASSERT_TRUE(cf.Contains(keys[i]));
+        single_cf.Insert(keys[i]);
+    }
+
+    int64 num_found = 0;
+    int64 num_single_found = 0;
+    for (uint64 key : RandomKeys(1000000, 2)) {
+        num_found += cf.Contains(key);
+        num_single_found += single_cf.Contains(key);
+    }
+    LOG(INFO) << "False positives: " << num_found << " vs " << num_single_found;
+    EXPECT_NEAR(num_single_found, num_found, 0.2 * num_single_found + 20);
+
+    // Deletes free the room up.
+    for (int64 i = 0; i < num_keys; i += 2)
+        ASSERT_TRUE(cf.Delete(keys[i]));
+    for (int64 i = 1; i < num_keys; i += 2)
+        ASSERT_TRUE(cf.Contains(keys[i]));
+    for (int64 i = 0; i < num_keys; i += 4)
+        ASSERT_TRUE(cf.Insert(keys[i]));
+    EXPECT_EQ(num_keys / 2 + (num_keys + 3) / 4, cf.NumElements());
+}
+
+TEST_F(ConcurrentCuckooFilterTest, ConcurrentTest) {
+    // From 80% to 94% load, so that inserts move tags about: 2 threads insert and 2 delete, while
+    // the other 4 keep looking up keys that are neither, which must never be missed.
+    const int kNumThreads = 8;
+    ConcurrentCuckooFilter<8> cf(400000);
+    const int64 num_slots = cf.NumBuckets() * 4;
+    vector<uint64> keys = RandomKeys(num_slots * 94 / 100, 1);
+    const int64 num_stable = num_slots * 70 / 100;
+    const int64 num_deleted = num_slots * 10 / 100;
+    const int64 num_prefilled = num_stable + num_deleted;
+    for (int64 i = 0; i < num_prefilled; ++i)
+        ASSERT_TRUE(cf.Insert(keys[i]));
+
+    std::atomic<int64> num_misses(0);
+    std::atomic<int64> num_failed(0);
+    RunThreads(kNumThreads, [&](int t) {
+        if (t < 2) {
+            for (int64 i = num_prefilled + t; i < keys.size(); i += 2)
+                num_failed += !cf.Insert(keys[i]);
+        } else if (t < 4) {
+            for (int64 i = num_stable + t - 2; i < num_prefilled; i += 2)
+                num_failed += !cf.Delete(keys[i]);
+        } else {
+            for (int round = 0; round < 3; ++round) {
+                for (int64 i = t - 4; i < num_stable; i += 4)
+                    num_misses += !cf.Contains(keys[i]);
+            }
+        }
+    });
+    EXPECT_EQ(0, num_misses);
+    EXPECT_EQ(0, num_failed);
+    EXPECT_EQ(keys.size() - num_deleted, cf.NumElements());
+    for (int64 i = 0; i < num_stable; ++i)
+        ASSERT_TRUE(cf.Contains(keys[i]));
+    for (int64 i = num_prefilled; i < keys.size(); ++i)
+        ASSERT_TRUE(cf.Contains(keys[i]));
+}
@@ -3,8 +3,17 @@
 #ifndef CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CUCKOO_FILTER_H_
 #define CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CUCKOO_FILTER_H_
 
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "cpp-base/data-struct/cuckoo-filter/cuckoo_filter_file.h"
+#include "cpp-base/data-struct/cuckoo-filter/packed_table.h"
 #include "cpp-base/data-struct/cuckoo-filter/single_table.h"
 #include "cpp-base/data-struct/cuckoo-filter/util.h"
 #include "cpp-base/hash/fingerprint2011.h"
@@ -16,86 +25,142 @@ namespace cpp_base {
 // maximum number of cuckoo kicks before claiming failure
 const int64 kMaxCuckooCount = 500;
 
-class CuckooFilter {
+// A cuckoo filter storing its tags in a TableType: SingleTable or PackedTable of a given number
+// of bits per tag. Use CuckooFilter or PackedCuckooFilter below.
+//
+// The filter can be saved to a file, then loaded or mapped from it with zero copy, rather than
+// rebuilt key by key.
+template <class TableType>
+class BasicCuckooFilter {
   public:
     #if 0
     // Deprecated constructor.
-    explicit CuckooFilter(int64 bit_size) : bits_per_element_(16), num_elements_(0) {
+    explicit CuckooFilter(int64 bit_size) : num_elements_(0) {
         static const int64 kAssociativity = 4;
 
-        int64 bytes_per_bucket = (bits_per_element_ * kAssociativity + 7) >> 3;
+        int64 bytes_per_bucket = (kBitsPerElement * kAssociativity + 7) >> 3;
         double __num_buckets = bit_size / 8. / bytes_per_bucket;
         int64 num_buckets = upperpower2(std::ceil(__num_buckets));
 
         last_victim_.used = false;
-        table_ = new SingleTable(num_buckets, kAssociativity, bits_per_element_);
+        table_ = new TableType(num_buckets);
     }
     #endif
 
-    // bits_per_item: how many bits each item is hashed into.
-    CuckooFilter(int64 expected_num_elements, int bits_per_element)
-            : bits_per_element_(bits_per_element),
-              num_elements_(0),
+    // How many bits each item is hashed into.
+    static const int kBitsPerElement = TableType::kBitsPerTag;
+
+    // How Insert() makes room for a key whose two buckets are full.
+    enum InsertMode {
+        // Kicks a random tag of a bucket to its other bucket, and so on, up to kMaxCuckooCount
+        // times, until one lands in an empty slot. If none does, the last tag kicked is kept
+        // aside as the "victim", and all further insertions fail.
+        kRandomWalk = 0,
+        // First looks for the shortest path of moves to an empty slot by a breadth-first search of
+        // up to kMaxBfsBuckets buckets, so paths are at most kMaxBfsPathLength moves, and makes
+        // its moves only once found: a few bucket reads and writes per insertion even at high
+        // load. Falls back to kRandomWalk if there is no such path.
+        kBreadthFirst = 1,
+        // Same as kBreadthFirst, but rather than falling back to kRandomWalk, chains a new table
+        // twice as large as the last one and inserts into that: insertions never fail, and take
+        // bounded time but for the allocation. Lookups look into all tables, so they read two
+        // more buckets, and have more false positives, for each new table.
+        kDynamic = 2,
+    };
+
+    // Max length of a path found by the breadth-first search, and max buckets it looks into.
+    static const int kMaxBfsPathLength = 5;
+    static const int kMaxBfsBuckets = 512;
+
+    explicit BasicCuckooFilter(int64 expected_num_elements, InsertMode insert_mode = kRandomWalk)
+            : num_elements_(0),
+              insert_mode_(insert_mode),
               expected_num_elements_(expected_num_elements) {
-        static const int64 kAssociativity = 4;
+        static const int64 kAssociativity = TableType::kTagsPerBucket;
 
         double __num_buckets = expected_num_elements * 1. / kAssociativity;
         int64 num_buckets = upperpower2(std::ceil(__num_buckets));
         double frac = __num_buckets / num_buckets;
         if (frac >= 0.96)
             num_buckets *= 2;
+        CHECK_LE(num_buckets, kMaxCuckooBuckets) << "Too many elements for a CuckooFilter";
 
         last_victim_.used = false;
-        table_ = new SingleTable(num_buckets, kAssociativity, bits_per_element);
+        table_ = new TableType(num_buckets);
     }
 
-    ~CuckooFilter() {
+    ~BasicCuckooFilter() {
         delete table_;
+        for (TableType* table : full_tables_)
+            delete table;
+        if (IsReadOnly())
+            UnmapHeaderPageFile(mapping_, mapping_size_);
     }
 
     // Add an item to the filter. Returns true if successfully inserted, false if not enough space.
     // Note: the caller should try to avoid re-insertion.
     bool Insert(uint64 key) {
+        CHECK(!IsReadOnly());
         if (last_victim_.used)
             return false;  // Not enough space
 
         int64 bucket_index;
         uint32 tag;
         GetIndexAndTag(key, &bucket_index, &tag);
-        bool ret = AddInternal(bucket_index, tag);
-
-        // If we went beyond the expected size, log a warning, but only at a regulated rate.
-        if (num_elements_ > expected_num_elements_ && is_power_of_2(++log_regulator_)) {
-            LOG(WARNING) << "CF insertions (" << num_elements_ << ") exceeded the expected max ("
-                         << expected_num_elements_ << "). Accuracy will degrade. Need more memory.";
-        }
-
-        return ret;
+        return InsertIndexAndTag(key, bucket_index, tag);
     }
 
     // Report if the item is inserted, with false positive rate.
     bool Contains(uint64 key) {
-        int64 bucket_index1;
-        int64 bucket_index2;
+        int64 bucket_index;
         uint32 tag;
-        GetIndexAndTag(key, &bucket_index1, &tag);
-
-        bucket_index2 = AltIndex(bucket_index1, tag);
-        CHECK_EQ(bucket_index1, AltIndex(bucket_index2, tag));
+        GetIndexAndTag(key, &bucket_index, &tag);
+        return ContainsIndexAndTag(bucket_index, tag);
+    }
 
-        if (last_victim_.used && tag == last_victim_.tag && (bucket_index1 == last_victim_.index ||
-                                                             bucket_index2 == last_victim_.index)) {
-            return true;
+    // Batched versions of Insert() and Contains(), for when many keys are at hand: they hash a
+    // group of keys first and prefetch both candidate buckets of each, then look them up or
+    // insert them, so the cache misses of the group overlap rather than stall one after another.
+    // Sets 'results[i]' to what Insert(keys[i]) or Contains(keys[i]) would return; 'results' may
+    // be null for InsertBatch(), which returns the number of keys successfully inserted.
+    int64 InsertBatch(const uint64* keys, int64 num_keys, bool* results = nullptr) {
+        CHECK(!IsReadOnly());
+        int64 bucket_indices[kBatchSize];
+        uint32 tags[kBatchSize];
+        int64 num_inserted = 0;
+        for (int64 start = 0; start < num_keys; start += kBatchSize) {
+            const int64 n = std::min<int64>(kBatchSize, num_keys - start);
+            PrefetchBatch(keys + start, n, bucket_indices, tags);
+            const int64 num_buckets = table_->NumBuckets();
+            for (int64 k = 0; k < n; ++k) {
+                if (table_->NumBuckets() != num_buckets)  // Grown since: indices changed
+                    GetIndexAndTag(keys[start + k], &bucket_indices[k], &tags[k]);
+                const bool inserted =
+                        !last_victim_.used &&
+                        InsertIndexAndTag(keys[start + k], bucket_indices[k], tags[k]);
+                num_inserted += inserted;
+                if (results != nullptr)
+                    results[start + k] = inserted;
+            }
         }
-        if (table_->FindTagInBuckets(bucket_index1, bucket_index2, tag)) {
-            return true;
+        return num_inserted;
+    }
+
+    void ContainsBatch(const uint64* keys, int64 num_keys, bool* results) {
+        int64 bucket_indices[kBatchSize];
+        uint32 tags[kBatchSize];
+        for (int64 start = 0; start < num_keys; start += kBatchSize) {
+            const int64 n = std::min<int64>(kBatchSize, num_keys - start);
+            PrefetchBatch(keys + start, n, bucket_indices, tags);
+            for (int64 k = 0; k < n; ++k)
+                results[start + k] = ContainsIndexAndTag(bucket_indices[k], tags[k]);
         }
-        return false;
     }
 
     // Delete an key from the filter.
     // NOTE: Make sure the item exists, before calling this function.
     bool Delete(uint64 key) {
+        CHECK(!IsReadOnly());
         int64 bucket_index1;
         int64 bucket_index2;
         uint32 tag;
@@ -114,9 +179,20 @@ class CuckooFilter {
                  (bucket_index1 == last_victim_.index || bucket_index2 == last_victim_.index)) {
             last_victim_.used = false;
             return true;
-        } else {
-            return false;
         }
+        // Newest table first: deleting a twin tag of another key there rather than the key's own
+        // in an older table, that other key is still found in the older one, where its buckets
+        // are the same.
+        for (auto it = full_tables_.rbegin(); it != full_tables_.rend(); ++it) {
+            TableType* table = *it;
+            const int64 index = bucket_index1 % table->NumBuckets();
+            if (table->DeleteTagFromBucket(index, tag) ||
+                table->DeleteTagFromBucket(CuckooAltIndex(index, tag, table->NumBuckets()), tag)) {
+                --num_elements_;
+                return true;
+            }
+        }
+        return false;
 
       TryEliminateVictim:
         if (last_victim_.used) {
@@ -133,6 +209,15 @@ class CuckooFilter {
     bool Delete(const std::string& str)   { return Delete(Fingerprint2011(str));   }
 
     void Clear() {
+        CHECK(!IsReadOnly());
+        if (!full_tables_.empty()) {
+            // Back to the first table.
+            delete table_;
+            table_ = full_tables_[0];
+            for (int64 i = 1; i < full_tables_.size(); ++i)
+                delete full_tables_[i];
+            full_tables_.clear();
+        }
         table_->Clear();
         num_elements_ = 0;
         last_victim_ = LastVictim();
@@ -142,7 +227,58 @@ class CuckooFilter {
     int64 NumElements() const { return num_elements_; }
 
     // Size of the filter in bytes.
-    int64 SizeInBytes() const { return table_->SizeInBytes(); }
+    int64 SizeInBytes() const {
+        int64 size = table_->SizeInBytes();
+        for (const TableType* table : full_tables_)
+            size += table->SizeInBytes();
+        return size;
+    }
+
+    // Number of tables: 1 but in kDynamic mode, which adds one each time the last one is full.
+    int64 NumTables() const { return full_tables_.size() + 1; }
+
+    // Saves the filter to the given file: a versioned header of one page, with the parameters,
+    // the number of elements and the victim if any, followed by the tables as is (see
+    // cuckoo_filter_file.h). Returns false on I/O error.
+    bool SaveToFile(const std::string& path) const {
+        CuckooFilterFileHeader header;
+        memset(&header, 0, sizeof(header));
+        header.packed = kPacked;
+        header.bits_per_tag = kBitsPerElement;
+        header.insert_mode = insert_mode_;
+        header.num_tables = NumTables();
+        header.num_buckets = (full_tables_.empty() ? table_ : full_tables_[0])->NumBuckets();
+        header.num_elements = num_elements_;
+        header.expected_num_elements = expected_num_elements_;
+        header.victim_index = last_victim_.index;
+        header.victim_tag = last_victim_.tag;
+        header.victim_used = last_victim_.used;
+        std::vector<std::pair<const uint8*, int64>> tables;
+        for (const TableType* table : full_tables_)
+            tables.emplace_back(table->RawData(), TableType::RawSize(table->NumBuckets()));
+        tables.emplace_back(table_->RawData(), TableType::RawSize(table_->NumBuckets()));
+        return WriteCuckooFilterFile(path, header, tables);
+    }
+
+    // Loads a filter saved by SaveToFile() into memory, as it was then, but for the random choices
+    // of kRandomWalk insertions. Returns null if the file cannot be read or is not such a filter
+    // of this type.
+    static std::unique_ptr<BasicCuckooFilter> LoadFromFile(const std::string& path) {
+        return OpenFile(path, false);
+    }
+
+    // Like LoadFromFile(), but maps the file read-only rather than copying it: opening is O(1)
+    // regardless of the filter size and pages are read on demand. The filter can only be looked
+    // up: Insert(), Delete() and Clear() fail a CHECK. The file must not be modified while mapped.
+    static std::unique_ptr<BasicCuckooFilter> MapFromFile(const std::string& path) {
+        return OpenFile(path, true);
+    }
+
+    // Whether the filter is mapped from a file by MapFromFile().
+    bool IsReadOnly() const { return mapping_size_ > 0; }
+
+    // Max number of keys hashed and prefetched at once by the batched calls.
+    static const int kBatchSize = 16;
 
     // Summary info.
     std::string Info() const {
@@ -151,7 +287,7 @@ class CuckooFilter {
            << "\t\t" << table_->Info() << "\n"
            << "\t\tKeys stored: " << NumElements() << "\n"
            << "\t\tLoad facotr: " << LoadFactor() << "\n"
-           << "\t\tHashtable size: " << (table_->SizeInBytes() >> 10)
+           << "\t\tHashtable size: " << (SizeInBytes() >> 10)
            << " KB\n";
         if (NumElements() > 0) {
             ss << "\t\tbit/key:   " << BitsPerItem() << "\n";
@@ -162,36 +298,149 @@ class CuckooFilter {
     }
 
   private:
-    inline int64 BucketIndexHash(uint32 val) const {
-        return val % table_->NumBuckets();
+    static const bool kPacked = std::is_same<TableType, PackedTable<kBitsPerElement>>::value;
+
+    // A filter over the given tables, oldest first, as read from a file with the given header;
+    // 'mapping' is that of the file if the tables are over it, null otherwise.
+    BasicCuckooFilter(const CuckooFilterFileHeader& header, const std::vector<TableType*>& tables,
+                      uint8* mapping, int64 mapping_size)
+            : table_(tables.back()),
+              num_elements_(header.num_elements),
+              full_tables_(tables.begin(), tables.end() - 1),
+              insert_mode_(static_cast<InsertMode>(header.insert_mode)),
+              expected_num_elements_(header.expected_num_elements),
+              mapping_(mapping),
+              mapping_size_(mapping_size) {
+        last_victim_.index = header.victim_index;
+        last_victim_.tag = header.victim_tag;
+        last_victim_.used = header.victim_used != 0;
     }
 
-    inline uint32 TagHash(uint32 val) const {
-        uint32 tag;
-        tag = val & ((1ULL << bits_per_element_) - 1);
-        tag += (tag == 0);
-        return tag;
+    // Maps the given file and checks it is a filter of this type. Returns a filter over the
+    // mapping if 'map', or over a copy of the tables, or null on failure.
+    static std::unique_ptr<BasicCuckooFilter> OpenFile(const std::string& path, bool map) {
+        int64 mapping_size;
+        uint8* mapping = MapCuckooFilterFile(path, &mapping_size);
+        if (mapping == nullptr)
+            return nullptr;
+        const CuckooFilterFileHeader& header =
+                *reinterpret_cast<const CuckooFilterFileHeader*>(mapping);
+        // Up to kMaxCuckooBuckets in the last table, each table twice the one before.
+        bool valid = header.packed == kPacked && header.bits_per_tag == kBitsPerElement &&
+                     header.insert_mode >= kRandomWalk && header.insert_mode <= kDynamic &&
+                     header.num_tables >= 1 && header.num_tables <= 33 && header.num_buckets > 0 &&
+                     header.num_buckets <= (kMaxCuckooBuckets >> (header.num_tables - 1)) &&
+                     header.num_elements >= 0 && header.victim_index >= 0 &&
+                     header.victim_index < (header.num_buckets << (header.num_tables - 1));
+        int64 size = kHeaderPageSize;
+        for (int i = 0; valid && i < header.num_tables; ++i)
+            size += TableType::RawSize(header.num_buckets << i);
+        if (!valid || size != mapping_size) {
+            LOG(ERROR) << path << " is not a file of a cuckoo filter of " << kBitsPerElement
+                       << "-bit tags in " << (kPacked ? "packed" : "single") << " tables";
+            UnmapHeaderPageFile(mapping, mapping_size);
+            return nullptr;
+        }
+
+        std::vector<TableType*> tables;
+        uint8* data = mapping + kHeaderPageSize;
+        for (int i = 0; i < header.num_tables; ++i) {
+            const int64 num_buckets = header.num_buckets << i;
+            const int64 raw_size = TableType::RawSize(num_buckets);
+            if (map) {
+                tables.push_back(new TableType(num_buckets, data, false));
+            } else {
+                uint8* copy = new uint8[raw_size];
+                memcpy(copy, data, raw_size);
+                tables.push_back(new TableType(num_buckets, copy, true));
+            }
+            data += raw_size;
+        }
+        std::unique_ptr<BasicCuckooFilter> filter(new BasicCuckooFilter(
+                header, tables, map ? mapping : nullptr, map ? mapping_size : 0));
+        if (!map)
+            UnmapHeaderPageFile(mapping, mapping_size);
+        return filter;
     }
 
-    inline void GetIndexAndTag(uint64 key, int64* bucket_index, uint32* tag) {
-        // A re-hash is necessary:
-        uint64 h = Hash64NumWithSeed(key, 0xa5b85c5e198ed849ULL /*some big prime number*/);
-        *bucket_index = BucketIndexHash((uint32) (h >> 32));
-        *tag = TagHash((uint32) (h & 0xFFFFFFFF));
+    inline void GetIndexAndTag(uint64 key, int64* bucket_index, uint32* tag) const {
+        CuckooIndexAndTag(key, table_->NumBuckets(), kBitsPerElement, bucket_index, tag);
     }
 
     inline int64 AltIndex(int64 index, uint32 tag) const {
-        // NOTE(binfan): originally we use:
-        // index ^ HashUtil::BobHash((const void*) (&tag), 4)) & table_->INDEXMASK;
-        // now doing a quick-n-dirty way:
-        // 0x5bd1e995 is the hash constant from MurmurHash2
-        return BucketIndexHash((uint32) (index ^ (tag * 0x5bd1e995)));
+        return CuckooAltIndex(index, tag, table_->NumBuckets());
     }
 
+    // Hashes the given keys and prefetches their buckets.
+    void PrefetchBatch(const uint64* keys, int64 num_keys, int64* bucket_indices, uint32* tags) {
+        for (int64 k = 0; k < num_keys; ++k) {
+            GetIndexAndTag(keys[k], &bucket_indices[k], &tags[k]);
+            table_->PrefetchBucket(bucket_indices[k]);
+            table_->PrefetchBucket(AltIndex(bucket_indices[k], tags[k]));
+        }
+    }
+
+    bool InsertIndexAndTag(const uint64 key, int64 bucket_index, uint32 tag) {
+        bool ret = AddInternal(bucket_index, tag);
+        if (!ret) {
+            // Full, in kDynamic mode: chain a new table, where the key has another index.
+            CHECK_LT(table_->NumBuckets(), kMaxCuckooBuckets) << "CuckooFilter cannot grow further";
+            full_tables_.push_back(table_);
+            table_ = new TableType(table_->NumBuckets() * 2);
+            GetIndexAndTag(key, &bucket_index, &tag);
+            ret = AddInternal(bucket_index, tag);
+            CHECK(ret);
+        }
+
+        // If we went beyond the expected size, log a warning, but only at a regulated rate.
+        if (insert_mode_ != kDynamic && num_elements_ > expected_num_elements_ &&
+            is_power_of_2(++log_regulator_)) {
+            LOG(WARNING) << "CF insertions (" << num_elements_ << ") exceeded the expected max ("
+                         << expected_num_elements_ << "). Accuracy will degrade. Need more memory.";
+        }
+
+        return ret;
+    }
+
+    bool ContainsIndexAndTag(const int64 bucket_index1, const uint32 tag) const {
+        int64 bucket_index2 = AltIndex(bucket_index1, tag);
+        CHECK_EQ(bucket_index1, AltIndex(bucket_index2, tag));
+
+        if (last_victim_.used && tag == last_victim_.tag && (bucket_index1 == last_victim_.index ||
+                                                             bucket_index2 == last_victim_.index)) {
+            return true;
+        }
+        if (table_->FindTagInBuckets(bucket_index1, bucket_index2, tag)) {
+            return true;
+        }
+        // The tables are powers of 2 in size, each twice the one before, so the index of a key in
+        // an older one is its index in the last one modulo its size.
+        for (const TableType* table : full_tables_) {
+            const int64 index = bucket_index1 % table->NumBuckets();
+            if (table->FindTagInBuckets(index, CuckooAltIndex(index, tag, table->NumBuckets()),
+                                        tag)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns false if there is no room, only in kDynamic mode.
     bool AddInternal(const int64 bucket_index, const uint32 tag) {
+        uint32 oldtag;
+        if (insert_mode_ != kRandomWalk) {
+            if (table_->InsertTagToBucket(bucket_index, tag, false, oldtag) ||
+                table_->InsertTagToBucket(AltIndex(bucket_index, tag), tag, false, oldtag) ||
+                BreadthFirstInsert(bucket_index, tag)) {
+                ++num_elements_;
+                return true;
+            }
+            if (insert_mode_ == kDynamic)
+                return false;
+        }
+
         int64 curindex = bucket_index;
         uint32 curtag = tag;
-        uint32 oldtag;
 
         for (uint32 count = 0; count < kMaxCuckooCount; count++) {
             bool kickout = count > 0;
@@ -212,14 +461,81 @@ class CuckooFilter {
         return true;
     }
 
+    // Inserts the given tag, whose two buckets are full, at the end of the shortest path of moves
+    // to an empty slot found by a breadth-first search from both buckets. Returns false, with
+    // nothing moved, if there is no path of at most kMaxBfsPathLength moves within the first
+    // kMaxBfsBuckets buckets looked into.
+    bool BreadthFirstInsert(const int64 bucket_index, const uint32 tag) {
+        // A bucket reached by moving a tag to it from its parent bucket; the two roots have none.
+        struct Node {
+            int64 index;
+            int32 parent;
+            int32 depth;
+            uint32 tag;
+        };
+        Node nodes[kMaxBfsBuckets];
+        nodes[0] = {bucket_index, -1, 0, 0};
+        nodes[1] = {AltIndex(bucket_index, tag), -1, 0, 0};
+        int num_nodes = 2;
+        for (int n = 0; n < num_nodes && nodes[n].depth < kMaxBfsPathLength; ++n) {
+            // Tags of the full bucket n, each with its other bucket, prefetched together.
+            uint32 tags[4];
+            int64 indices[4];
+            for (int j = 0; j < 4; ++j) {
+                tags[j] = table_->ReadTag(nodes[n].index, j);
+                indices[j] = AltIndex(nodes[n].index, tags[j]);
+                table_->PrefetchBucket(indices[j]);
+            }
+            for (int j = 0; j < 4; ++j) {
+                if (OnPath(nodes, n, indices[j]))
+                    continue;  // Moving tags in circles
+                if (table_->NumTagsInBucket(indices[j]) < 4) {
+                    // Found: make the moves, last first, each into the slot the one before frees.
+                    int64 to = indices[j];
+                    uint32 moved_tag = tags[j];
+                    uint32 unused;
+                    for (int m = n; m >= 0; m = nodes[m].parent) {
+                        CHECK(table_->DeleteTagFromBucket(nodes[m].index, moved_tag));
+                        CHECK(table_->InsertTagToBucket(to, moved_tag, false, unused));
+                        if (nodes[m].parent < 0) {
+                            CHECK(table_->InsertTagToBucket(nodes[m].index, tag, false, unused));
+                            return true;
+                        }
+                        to = nodes[m].index;
+                        moved_tag = nodes[m].tag;
+                    }
+                }
+                if (num_nodes < kMaxBfsBuckets)
+                    nodes[num_nodes++] = {indices[j], n, nodes[n].depth + 1, tags[j]};
+            }
+        }
+        return false;
+    }
+
+    // Whether the path from a root to the given node goes through the given bucket.
+    template <class Node>
+    static bool OnPath(const Node* nodes, int n, int64 index) {
+        for (; n >= 0; n = nodes[n].parent) {
+            if (nodes[n].index == index)
+                return true;
+        }
+        return false;
+    }
+
     // load factor is the fraction of occupancy.
-    double LoadFactor() const { return 1.0 * NumElements()  / table_->SizeInTags(); }
+    double LoadFactor() const {
+        int64 num_slots = table_->SizeInTags();
+        for (const TableType* table : full_tables_)
+            num_slots += table->SizeInTags();
+        return 1.0 * NumElements() / num_slots;
+    }
 
-    double BitsPerItem() const { return 8.0 * table_->SizeInBytes() / NumElements(); }
+    double BitsPerItem() const { return 8.0 * SizeInBytes() / NumElements(); }
 
-    const int bits_per_element_;
-    SingleTable* table_;  // Storage of items
+    TableType* table_;    // Storage of items
     int64 num_elements_;  // Number of items stored
+    std::vector<TableType*> full_tables_;  // Tables before table_, in kDynamic mode
+    const InsertMode insert_mode_;
 
     struct LastVictim {
         LastVictim() : index(0), tag(0), used(false) {}
@@ -233,9 +549,23 @@ class CuckooFilter {
     const int64 expected_num_elements_;
     int64 log_regulator_ = 0;
 
-    DISALLOW_COPY_AND_ASSIGN(CuckooFilter);
+    // The mapping of the file the tables are over if mapped by MapFromFile(), of 'mapping_size_'
+    // bytes, null and 0 otherwise.
+    uint8* mapping_ = nullptr;
+    int64 mapping_size_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(BasicCuckooFilter);
 };
 
+// E.g., CuckooFilter<12> for 12-bit tags. Takes 2, 4, 8, 12, 16 or 32-bit tags.
+template <int bits_per_tag>
+using CuckooFilter = BasicCuckooFilter<SingleTable<bits_per_tag>>;
+
+// About one bit less per key than CuckooFilter for the same false positive rate, e.g., 11 rather
+// than 12 bits per slot with 12-bit tags, but slower; see PackedTable. Takes 4 to 16-bit tags.
+template <int bits_per_tag>
+using PackedCuckooFilter = BasicCuckooFilter<PackedTable<bits_per_tag>>;
+
 }  // namespace cpp_base
 
 #endif  // CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CUCKOO_FILTER_H_
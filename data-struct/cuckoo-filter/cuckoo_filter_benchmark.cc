@@ -0,0 +1,225 @@
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cpp-base/data-struct/cuckoo-filter/cuckoo_filter.h"
+#include "cpp-base/file/file.h"
+#include "cpp-base/file/temp_file_test_util.h"
+
+using cpp_base::CuckooFilter;
+using cpp_base::File;
+using cpp_base::PackedCuckooFilter;
+using cpp_base::TempFile;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+class CuckooFilterTest : public ::testing::Test {
+  public:
+    CuckooFilterTest() { }
+    ~CuckooFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+
+    // Returns the average ns per call of f(key) over the given keys.
+    template <class F>
+    static double NanosPerKey(const vector<uint64>& keys, const F& f) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64 key : keys)
+            f(key);
+        return std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / keys.size();
+    }
+
+    // Logs the memory, false positives and speed of the given filter at 90% load.
+    template <class Filter>
+    static void Benchmark(const char* name, int64 capacity, const vector<uint64>& absent_keys) {
+        Filter cf(capacity);
+        vector<uint64> keys = RandomKeys(capacity * 9 / 10, 1);
+        const double insert_ns = NanosPerKey(keys, [&](uint64 key) { cf.Insert(key); });
+        keys.resize(absent_keys.size());
+        int64 num_found = 0;
+        const double hit_ns = NanosPerKey(keys, [&](uint64 key) { num_found += cf.Contains(key); });
+        EXPECT_EQ(keys.size(), num_found);
+        const double miss_ns = NanosPerKey(
+                absent_keys, [&](uint64 key) { num_found += cf.Contains(key); });
+        LOG(INFO) << name << " with " << Filter::kBitsPerElement << "-bit tags: "
+                  << cf.SizeInBytes() * 8. / cf.NumElements() << " bits/key, "
+                  << (num_found - keys.size()) * 100. / absent_keys.size()
+                  << "% false positives; " << insert_ns << " ns/insert, " << hit_ns
+                  << " ns/hit, " << miss_ns << " ns/miss";
+    }
+};
+
+TEST_F(CuckooFilterTest, BatchBenchmark) {
+    // 64M buckets of 4 16-bit tags: 512 MB, larger than the last-level cache.
+    const int64 kCapacity = 200000000;
+    const int64 kNumKeys = 8000000;
+    const int64 kBatch = 1024;
+    std::mt19937_64 rand_gen(1);
+    vector<uint64> keys(2 * kNumKeys);  // The first half inserted, the second half not
+    for (uint64& key : keys)
+        key = rand_gen();
+    const uint64* present = keys.data();
+    const uint64* absent = keys.data() + kNumKeys;
+    bool results[kBatch];
+
+    CuckooFilter<16> cf(kCapacity);
+    const int64 half = kNumKeys / 2;
+    auto start = std::chrono::steady_clock::now();
+    for (int64 i = 0; i < half; ++i)
+        cf.Insert(present[i]);
+    auto end = std::chrono::steady_clock::now();
+    double insert_ns = std::chrono::duration<double, std::nano>(end - start).count() / half;
+    start = std::chrono::steady_clock::now();
+    for (int64 i = half; i < kNumKeys; i += kBatch)
+        cf.InsertBatch(present + i, std::min(kBatch, kNumKeys - i));
+    end = std::chrono::steady_clock::now();
+    double batch_insert_ns = std::chrono::duration<double, std::nano>(end - start).count() / half;
+    LOG(INFO) << "Insert(): " << insert_ns << " ns/key; InsertBatch(): " << batch_insert_ns
+              << " ns/key, into a filter of " << cf.SizeInBytes() / 1024 / 1024 << " MB";
+
+    for (const uint64* probe : {present, absent}) {
+        int64 num_found = 0;
+        start = std::chrono::steady_clock::now();
+        for (int64 i = 0; i < kNumKeys; ++i)
+            num_found += cf.Contains(probe[i]);
+        end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / kNumKeys;
+
+        int64 num_batch_found = 0;
+        start = std::chrono::steady_clock::now();
+        for (int64 i = 0; i < kNumKeys; i += kBatch) {
+            const int64 n = std::min(kBatch, kNumKeys - i);
+            cf.ContainsBatch(probe + i, n, results);
+            num_batch_found += std::count(results, results + n, true);
+        }
+        end = std::chrono::steady_clock::now();
+        double batch_ns = std::chrono::duration<double, std::nano>(end - start).count() / kNumKeys;
+        EXPECT_EQ(num_found, num_batch_found);
+        LOG(INFO) << "Contains() of " << (probe == present ? "present" : "absent") << " keys: "
+                  << ns << " ns/key; ContainsBatch(): " << batch_ns << " ns/key";
+    }
+}
+
+TEST_F(CuckooFilterTest, TagWidthBenchmark) {
+    // At 90% load of 4M buckets: larger than the last-level cache.
+    const int64 kCapacity = 16000000;
+    vector<uint64> absent_keys = RandomKeys(kCapacity / 2, 2);
+    Benchmark<CuckooFilter<8>>("SingleTable", kCapacity, absent_keys);
+    Benchmark<CuckooFilter<12>>("SingleTable", kCapacity, absent_keys);
+    Benchmark<CuckooFilter<16>>("SingleTable", kCapacity, absent_keys);
+    Benchmark<CuckooFilter<32>>("SingleTable", kCapacity, absent_keys);
+    Benchmark<PackedCuckooFilter<12>>("PackedTable", kCapacity, absent_keys);
+    Benchmark<PackedCuckooFilter<16>>("PackedTable", kCapacity, absent_keys);
+}
+
+TEST_F(CuckooFilterTest, InsertLatencyBenchmark) {
+    // Latency percentiles of the insertions from 85% to 95% load (or until the first failure),
+    // with 4M buckets, larger than the last-level cache. And of as many insertions into a
+    // kDynamic filter past that, which grows once.
+    const int64 kNumBuckets = 1 << 22;
+    vector<uint64> keys = RandomKeys(kNumBuckets * 4 * 2, 1);
+    auto report = [&](const char* name, auto* cf, int64 begin, int64 end) {
+        int64 i = 0;
+        for (; i < begin; ++i)
+            CHECK(cf->Insert(keys[i]));
+        vector<double> nanos;
+        for (; i < end; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            const bool inserted = cf->Insert(keys[i]);
+            nanos.push_back(std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - start).count());
+            if (!inserted)
+                break;
+        }
+        std::sort(nanos.begin(), nanos.end());
+        auto percentile = [&](double p) { return nanos[std::min<int64>(nanos.size() * p,
+                                                                       nanos.size() - 1)]; };
+        LOG(INFO) << name << ": " << (i == end ? "" : "full at load factor ")
+                  << (i == end ? "" : std::to_string(i * 1. / (kNumBuckets * 4)))
+                  << (i == end ? "" : "; ") << "insert ns: p50: " << percentile(0.5)
+                  << ", p99: " << percentile(0.99) << ", p99.9: " << percentile(0.999)
+                  << ", p99.99: " << percentile(0.9999) << ", max: " << nanos.back();
+    };
+    const int64 begin = kNumBuckets * 4 * 85 / 100;
+    const int64 end = kNumBuckets * 4 * 95 / 100;
+    const int64 capacity = kNumBuckets * 4 * 95 / 100;
+    {
+        CuckooFilter<12> cf(capacity);
+        CHECK_EQ(kNumBuckets * 6, cf.SizeInBytes());
+        report("kRandomWalk", &cf, begin, end);
+    }
+    {
+        CuckooFilter<12> cf(capacity, CuckooFilter<12>::kBreadthFirst);
+        report("kBreadthFirst", &cf, begin, end);
+    }
+    {
+        PackedCuckooFilter<12> cf(capacity, PackedCuckooFilter<12>::kBreadthFirst);
+        report("PackedTable, kBreadthFirst", &cf, begin, end);
+    }
+    {
+        CuckooFilter<12> cf(capacity, CuckooFilter<12>::kDynamic);
+        report("kDynamic", &cf, end, 2 * end - begin);
+        LOG(INFO) << "kDynamic: " << cf.NumTables() << " tables";
+    }
+}
+
+TEST_F(CuckooFilterTest, OpenBenchmark) {
+    // Rebuilding a filter much larger than the last-level cache key by key, vs. loading or mapping
+    // it from a file, and lookups on the mapped filter, whose pages are read on demand.
+    const int64 kNumKeys = 50000000;
+    vector<uint64> keys = RandomKeys(kNumKeys, 1);
+    auto millis = [](const std::function<void()>& f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+    };
+    unique_ptr<CuckooFilter<12>> cf;
+    const double build_ms = millis([&] {
+        cf.reset(new CuckooFilter<12>(kNumKeys));
+        for (uint64 key : keys)
+            cf->Insert(key);
+    });
+
+    const string path = TempFile("cuckoo_filter_benchmark.cf");
+    const double save_ms = millis([&] { ASSERT_TRUE(cf->SaveToFile(path)); });
+    unique_ptr<CuckooFilter<12>> loaded;
+    const double load_ms = millis([&] { loaded = CuckooFilter<12>::LoadFromFile(path); });
+    unique_ptr<CuckooFilter<12>> mapped;
+    const double map_ms = millis([&] { mapped = CuckooFilter<12>::MapFromFile(path); });
+    ASSERT_TRUE(loaded != nullptr);
+    ASSERT_TRUE(mapped != nullptr);
+    keys.resize(1000000);
+    int64 num_found = 0;
+    const double mapped_hit_ns = NanosPerKey(keys, [&](uint64 key) {
+        num_found += mapped->Contains(key);
+    });
+    const double loaded_hit_ns = NanosPerKey(keys, [&](uint64 key) {
+        num_found += loaded->Contains(key);
+    });
+    EXPECT_EQ(2 * keys.size(), num_found);
+    LOG(INFO) << "CuckooFilter<12> of " << cf->SizeInBytes() / 1e6 << " MB: built in "
+              << build_ms << " ms, SaveToFile(): " << save_ms << " ms, LoadFromFile(): "
+              << load_ms << " ms, MapFromFile(): " << map_ms << " ms; hits: " << mapped_hit_ns
+              << " ns mapped, first ones included, " << loaded_hit_ns << " ns loaded";
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
@@ -0,0 +1,38 @@
+#include "cpp-base/data-struct/cuckoo-filter/cuckoo_filter_file.h"
+
+#include <glog/logging.h>
+
+namespace cpp_base {
+
+namespace {
+
+const uint32 kFileMagic = 0x4F4F4B43;  // "CKOO"
+const uint32 kFileVersion = 1;
+
+static_assert(sizeof(CuckooFilterFileHeader) <= kHeaderPageSize,
+              "CuckooFilterFileHeader does not fit its page");
+
+}  // namespace
+
+bool WriteCuckooFilterFile(const std::string& path, const CuckooFilterFileHeader& header,
+                           const std::vector<std::pair<const uint8*, int64>>& tables) {
+    CuckooFilterFileHeader file_header = header;
+    file_header.magic = kFileMagic;
+    file_header.version = kFileVersion;
+    return WriteHeaderPageFile(path, &file_header, sizeof(file_header), tables);
+}
+
+uint8* MapCuckooFilterFile(const std::string& path, int64* mapping_size) {
+    uint8* mapping = MapHeaderPageFile(path, mapping_size);
+    if (mapping == nullptr)
+        return nullptr;
+    const CuckooFilterFileHeader* header = reinterpret_cast<const CuckooFilterFileHeader*>(mapping);
+    if (header->magic != kFileMagic || header->version != kFileVersion) {
+        LOG(ERROR) << path << " is not a CuckooFilter file of version " << kFileVersion;
+        UnmapHeaderPageFile(mapping, *mapping_size);
+        return nullptr;
+    }
+    return mapping;
+}
+
+}  // namespace cpp_base
@@ -0,0 +1,42 @@
+#ifndef CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CUCKOO_FILTER_FILE_H_
+#define CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CUCKOO_FILTER_FILE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cpp-base/file/header_page_file.h"
+#include "cpp-base/integral_types.h"
+
+namespace cpp_base {
+
+// The file format of BasicCuckooFilter::SaveToFile(): a header page (see header_page_file.h),
+// then the bytes of each table as is, back to back, oldest first.
+struct CuckooFilterFileHeader {
+    uint32 magic;                 // Set by WriteCuckooFilterFile()
+    uint32 version;               // Same
+    int32 packed;                 // Whether the tables are PackedTables rather than SingleTables
+    int32 bits_per_tag;
+    int32 insert_mode;
+    int32 num_tables;
+    int64 num_buckets;            // Of the first table; each next one has twice as many
+    int64 num_elements;
+    int64 expected_num_elements;
+    int64 victim_index;
+    uint32 victim_tag;
+    int32 victim_used;
+};
+
+// Writes the given header, whose magic and version it sets, then the given tables' bytes, each
+// given with its size. Returns false on I/O error.
+bool WriteCuckooFilterFile(const std::string& path, const CuckooFilterFileHeader& header,
+                           const std::vector<std::pair<const uint8*, int64>>& tables);
+
+// Maps the given file read-only. Returns the mapping, which starts with the header, and sets its
+// size, or returns null if the file cannot be read or has no header of the current version.
+// The sizes of the tables are left for the caller to check. Unmap with UnmapHeaderPageFile().
+uint8* MapCuckooFilterFile(const std::string& path, int64* mapping_size);
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CUCKOO_FILTER_FILE_H_
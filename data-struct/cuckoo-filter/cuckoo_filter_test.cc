@@ -1,14 +1,30 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cmath>
+#include <memory>
+#include <random>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "cpp-base/data-struct/cuckoo-filter/cuckoo_filter.h"
+#include "cpp-base/file/file.h"
+#include "cpp-base/file/file_output_stream.h"
+#include "cpp-base/file/temp_file_test_util.h"
 #include "cpp-base/util/map_util.h"
 
 using cpp_base::CuckooFilter;
 using cpp_base::ContainsKey;
+using cpp_base::File;
+using cpp_base::FileOutputStream;
+using cpp_base::PackedCuckooFilter;
+using cpp_base::SingleTable;
+using cpp_base::TempFile;
+using std::string;
+using std::unique_ptr;
+using std::vector;
 
 class CuckooFilterTest : public ::testing::Test {
   public:
@@ -18,10 +34,147 @@ class CuckooFilterTest : public ::testing::Test {
   protected:
     void SetUp() override { }
     void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+
+    // Fills the given filter up to 90% of its capacity, and returns the keys inserted.
+    template <class Filter>
+    static vector<uint64> Fill(Filter* cf, int64 capacity, int seed) {
+        vector<uint64> keys = RandomKeys(capacity * 9 / 10, seed);
+        for (uint64 key : keys)
+            CHECK(cf->Insert(key));
+        return keys;
+    }
+
+    // Inserts the given keys in order until one fails, and returns the number inserted, all of
+    // which the filter must contain.
+    template <class Filter>
+    static int64 FillUntilFull(Filter* cf, const vector<uint64>& keys) {
+        int64 num_keys = 0;
+        while (num_keys < keys.size() && cf->Insert(keys[num_keys]))
+            ++num_keys;
+        for (int64 i = 0; i < num_keys; ++i)
+            CHECK(cf->Contains(keys[i])) << i;
+        return num_keys;
+    }
+
+    // Checks that FindTagInBuckets() and FindTagInBucket() of a SingleTable of random tags find
+    // exactly the tags ReadTag() reads.
+    template <int bits>
+    static void CheckProbes() {
+        const int64 kNumBuckets = 1024;
+        SingleTable<bits> table(kNumBuckets);
+        std::mt19937_64 rand_gen(bits);
+        // Few distinct non-zero tags, for many to be found, and the largest ones, to catch
+        // truncations.
+        const uint32 max_tag = (1ULL << bits) - 1;
+        const uint32 num_tags = std::min<uint32>(max_tag, 6);
+        auto random_tag = [&]() -> uint32 { return max_tag - rand_gen() % num_tags; };
+        for (int64 i = 0; i < kNumBuckets; ++i) {
+            for (int j = 0; j < 4; ++j)
+                table.WriteTag(i, j, rand_gen() % 4 == 0 ? 0 : random_tag());
+        }
+        int64 num_found = 0;
+        for (int k = 0; k < 100000; ++k) {
+            const int64 i1 = rand_gen() % kNumBuckets;
+            const int64 i2 = rand_gen() % kNumBuckets;
+            const uint32 tag = random_tag();
+            bool in1 = false, in2 = false;
+            uint32 slots = 0;
+            for (int j = 0; j < 4; ++j) {
+                in1 |= table.ReadTag(i1, j) == tag;
+                in2 |= table.ReadTag(i2, j) == tag;
+                slots |= (table.ReadTag(i1, j) == tag) << j;
+                slots |= (table.ReadTag(i2, j) == tag) << (4 + j);
+            }
+            ASSERT_EQ(in1, table.FindTagInBucket(i1, tag)) << bits;
+            ASSERT_EQ(in1 || in2, table.FindTagInBuckets(i1, i2, tag)) << bits;
+            ASSERT_EQ(slots, table.FindTagSlotsInBuckets(i1, i2, tag)) << bits;
+            num_found += in1 || in2;
+        }
+        EXPECT_GT(num_found, 10000);
+        EXPECT_LT(num_found, 90000);
+    }
+
+    // Checks a PackedCuckooFilter finds all its keys, and deletes them.
+    template <int bits>
+    static void CheckPackedTable() {
+        const int64 kCapacity = 100000;
+        PackedCuckooFilter<bits> packed_cf(kCapacity);
+        EXPECT_EQ(0, packed_cf.NumElements());
+        EXPECT_FALSE(packed_cf.Contains(25));
+        vector<uint64> keys = Fill(&packed_cf, kCapacity, bits);
+        EXPECT_EQ(keys.size(), packed_cf.NumElements());
+        for (uint64 key : keys)
+            ASSERT_TRUE(packed_cf.Contains(key)) << bits;
+
+        // Delete half the keys; the rest are still there.
+        for (int64 i = 0; i < keys.size() / 2; ++i)
+            ASSERT_TRUE(packed_cf.Delete(keys[i]));
+        EXPECT_EQ(keys.size() - keys.size() / 2, packed_cf.NumElements());
+        for (int64 i = keys.size() / 2; i < keys.size(); ++i)
+            ASSERT_TRUE(packed_cf.Contains(keys[i])) << bits;
+
+        packed_cf.Clear();
+        EXPECT_EQ(0, packed_cf.NumElements());
+        EXPECT_FALSE(packed_cf.Contains(keys.back()));
+    }
+
+    // Checks a PackedCuckooFilter takes one bit less per tag than a CuckooFilter of the same tag
+    // width, for the same false positive rate.
+    template <int bits>
+    static void ComparePackedTable(const vector<uint64>& absent_keys) {
+        const int64 kCapacity = 100000;
+        CuckooFilter<bits> cf(kCapacity);
+        PackedCuckooFilter<bits> packed_cf(kCapacity);
+        Fill(&cf, kCapacity, bits);
+        Fill(&packed_cf, kCapacity, bits);
+        EXPECT_EQ(cf.SizeInBytes() * (4 * bits - 4) / (4 * bits), packed_cf.SizeInBytes());
+        int64 num_found = 0;
+        int64 num_packed_found = 0;
+        for (uint64 key : absent_keys) {
+            num_found += cf.Contains(key);
+            num_packed_found += packed_cf.Contains(key);
+        }
+        LOG(INFO) << bits << "-bit tags: false positives: "
+                  << num_found * 100. / absent_keys.size() << "%; packed: "
+                  << num_packed_found * 100. / absent_keys.size() << "%";
+        EXPECT_NEAR(num_found, num_packed_found, 0.1 * num_found + 100);
+    }
+
+    // Saves the given filter, of the given keys, to the given file, then checks the filter loaded
+    // and the one mapped from it answer identically, including false positives.
+    template <class Filter>
+    static void CheckSaveAndLoad(Filter* cf, const vector<uint64>& keys,
+                                 const vector<uint64>& absent_keys, const string& path) {
+        ASSERT_TRUE(cf->SaveToFile(path));
+        unique_ptr<Filter> loaded = Filter::LoadFromFile(path);
+        unique_ptr<Filter> mapped = Filter::MapFromFile(path);
+        ASSERT_TRUE(loaded != nullptr);
+        ASSERT_TRUE(mapped != nullptr);
+        EXPECT_FALSE(cf->IsReadOnly());
+        EXPECT_FALSE(loaded->IsReadOnly());
+        EXPECT_TRUE(mapped->IsReadOnly());
+        for (Filter* other : {loaded.get(), mapped.get()}) {
+            EXPECT_EQ(cf->NumElements(), other->NumElements());
+            EXPECT_EQ(cf->NumTables(), other->NumTables());
+            EXPECT_EQ(cf->SizeInBytes(), other->SizeInBytes());
+            for (uint64 key : keys)
+                ASSERT_TRUE(other->Contains(key));
+            for (uint64 key : absent_keys)
+                ASSERT_EQ(cf->Contains(key), other->Contains(key));
+        }
+    }
 };
 
 TEST_F(CuckooFilterTest, BasicTest) {
-    CuckooFilter cf(10, 8);
+    CuckooFilter<8> cf(10);
     EXPECT_EQ(0, cf.NumElements());
     EXPECT_FALSE(cf.Contains(25));
 
@@ -35,7 +188,7 @@ TEST_F(CuckooFilterTest, StatisticalTest) {
     const int NUM_ELEMENTS = 1000000;
     const int KEY_RANGE = 10 * NUM_ELEMENTS;
 
-    CuckooFilter cf(NUM_ELEMENTS, 12);
+    CuckooFilter<12> cf(NUM_ELEMENTS);
 
     std::set<int> keys;
     for (int i = 0; i < NUM_ELEMENTS; ++i) {
@@ -66,3 +219,204 @@ TEST_F(CuckooFilterTest, StatisticalTest) {
     LOG(INFO) << "False positive ratio: " << fp << "%";
     CHECK_LT(fp, 1);
 }
+
+TEST_F(CuckooFilterTest, BatchTest) {
+    CuckooFilter<12> cf(1000);
+    CuckooFilter<12> batch_cf(1000);
+    vector<uint64> keys;
+    for (int i = 0; i < 3000; ++i)
+        keys.push_back(rand());  // NOLINT
+
+    // Same results as one by one, up to and beyond the filter being full.
+    bool results[3000];
+    const int64 num_inserted = batch_cf.InsertBatch(keys.data(), 2500, results);
+    EXPECT_EQ(num_inserted, std::count(results, results + 2500, true));
+    EXPECT_LT(num_inserted, 2500);
+    for (int i = 0; i < 2500; ++i)
+        EXPECT_EQ(cf.Insert(keys[i]), results[i]) << i;
+    EXPECT_EQ(batch_cf.NumElements(), cf.NumElements());
+
+    for (int64 n : {0, 1, 17, 3000}) {
+        batch_cf.ContainsBatch(keys.data(), n, results);
+        for (int i = 0; i < n; ++i)
+            EXPECT_EQ(cf.Contains(keys[i]), results[i]) << i;
+    }
+}
+
+TEST_F(CuckooFilterTest, BreadthFirstTest) {
+    // Fills about as much as kRandomWalk, whose path search it falls back to at the end, with no
+    // false negatives, and deletes alike.
+    const int64 kCapacity = 100000;
+    vector<uint64> keys = RandomKeys(kCapacity * 2, 1);
+    CuckooFilter<12> cf(kCapacity);
+    CuckooFilter<12> bfs_cf(kCapacity, CuckooFilter<12>::kBreadthFirst);
+    PackedCuckooFilter<12> packed_bfs_cf(kCapacity, PackedCuckooFilter<12>::kBreadthFirst);
+    const int64 num_keys = FillUntilFull(&cf, keys);
+    const int64 num_bfs_keys = FillUntilFull(&bfs_cf, keys);
+    const int64 num_packed_keys = FillUntilFull(&packed_bfs_cf, keys);
+    const int64 num_slots = cf.SizeInBytes() * 8 / 12;
+    LOG(INFO) << "Full at load factor " << num_keys * 1. / num_slots << ", with BFS: "
+              << num_bfs_keys * 1. / num_slots << ", packed: " << num_packed_keys * 1. / num_slots;
+    EXPECT_GT(num_bfs_keys, num_slots * 0.95);
+    EXPECT_GT(num_packed_keys, num_slots * 0.95);
+
+    for (int64 i = 0; i < num_bfs_keys; i += 2)
+        ASSERT_TRUE(bfs_cf.Delete(keys[i]));
+    for (int64 i = 1; i < num_bfs_keys; i += 2)
+        ASSERT_TRUE(bfs_cf.Contains(keys[i]));
+    EXPECT_EQ(num_bfs_keys / 2, bfs_cf.NumElements());
+}
+
+TEST_F(CuckooFilterTest, DynamicTest) {
+    // Never full, and chains tables twice as large each, so that the number of bits per key stays
+    // bounded, and the false positive rate grows with the number of tables.
+    const int64 kCapacity = 10000;
+    const int64 kNumKeys = 1000000;
+    vector<uint64> keys = RandomKeys(kNumKeys, 1);
+    CuckooFilter<12> cf(kCapacity, CuckooFilter<12>::kDynamic);
+    const int64 initial_size = cf.SizeInBytes();
+    EXPECT_EQ(1, cf.NumTables());
+    for (uint64 key : keys)
+        ASSERT_TRUE(cf.Insert(key));
+    EXPECT_EQ(kNumKeys, cf.NumElements());
+    LOG(INFO) << cf.NumTables() << " tables, " << cf.SizeInBytes() * 8. / kNumKeys << " bits/key";
+    EXPECT_EQ(initial_size * ((1 << cf.NumTables()) - 1), cf.SizeInBytes());
+    EXPECT_LT(cf.SizeInBytes() * 8. / kNumKeys, 12 * 2 / 0.95);
+    for (uint64 key : keys)
+        ASSERT_TRUE(cf.Contains(key));
+
+    int64 num_found = 0;
+    vector<uint64> absent_keys = RandomKeys(1000000, 2);
+    for (uint64 key : absent_keys)
+        num_found += cf.Contains(key);
+    LOG(INFO) << "False positives: " << num_found * 100. / absent_keys.size() << "%";
+    EXPECT_LT(num_found * 1. / absent_keys.size(), cf.NumTables() * 8. / 4096);
+
+    // Same with batches, which may cross a growth.
+    CuckooFilter<12> batch_cf(kCapacity, CuckooFilter<12>::kDynamic);
+    EXPECT_EQ(kNumKeys, batch_cf.InsertBatch(keys.data(), kNumKeys));
+    bool results[1000];
+    batch_cf.ContainsBatch(keys.data() + kNumKeys - 1000, 1000, results);
+    EXPECT_EQ(1000, std::count(results, results + 1000, true));
+
+    // Deletes from any table.
+    for (int64 i = 0; i < kNumKeys; i += 2)
+        ASSERT_TRUE(cf.Delete(keys[i]));
+    for (int64 i = 1; i < kNumKeys; i += 2)
+        ASSERT_TRUE(cf.Contains(keys[i]));
+    EXPECT_EQ(kNumKeys / 2, cf.NumElements());
+
+    cf.Clear();
+    EXPECT_EQ(1, cf.NumTables());
+    EXPECT_EQ(initial_size, cf.SizeInBytes());
+    EXPECT_FALSE(cf.Contains(keys[1]));
+}
+
+TEST_F(CuckooFilterTest, ProbeTest) {
+    CheckProbes<2>();
+    CheckProbes<4>();
+    CheckProbes<8>();
+    CheckProbes<12>();
+    CheckProbes<16>();
+    CheckProbes<32>();
+}
+
+TEST_F(CuckooFilterTest, TagWidthTest) {
+    // No false negatives, and false positives down with 2^bits, whatever the width.
+    vector<uint64> absent_keys = RandomKeys(1000000, 1);
+    CuckooFilter<8> cf8(100000);
+    CuckooFilter<16> cf16(100000);
+    CuckooFilter<32> cf32(100000);
+    vector<uint64> keys = Fill(&cf8, 100000, 2);
+    Fill(&cf16, 100000, 2);
+    Fill(&cf32, 100000, 2);
+    int64 num_found[3] = {0, 0, 0};
+    for (uint64 key : keys) {
+        ASSERT_TRUE(cf8.Contains(key));
+        ASSERT_TRUE(cf16.Contains(key));
+        ASSERT_TRUE(cf32.Contains(key));
+    }
+    for (uint64 key : absent_keys) {
+        num_found[0] += cf8.Contains(key);
+        num_found[1] += cf16.Contains(key);
+        num_found[2] += cf32.Contains(key);
+    }
+    // 8 tags to compare to, each of which is non-zero with the load factor, i.e., the number of
+    // elements over that of 1-byte tags.
+    const double load_factor = cf8.NumElements() * 1. / cf8.SizeInBytes();
+    EXPECT_NEAR(absent_keys.size() * 8 * load_factor / 255, num_found[0], 1000);
+    EXPECT_LT(num_found[1], 500);
+    EXPECT_EQ(0, num_found[2]);
+}
+
+TEST_F(CuckooFilterTest, PackedTableTest) {
+    CheckPackedTable<4>();
+    CheckPackedTable<5>();
+    CheckPackedTable<7>();
+    CheckPackedTable<8>();
+    CheckPackedTable<12>();
+    CheckPackedTable<13>();
+    CheckPackedTable<16>();
+
+    vector<uint64> absent_keys = RandomKeys(1000000, 1);
+    ComparePackedTable<4>(absent_keys);
+    ComparePackedTable<8>(absent_keys);
+    ComparePackedTable<12>(absent_keys);
+    ComparePackedTable<16>(absent_keys);
+}
+
+TEST_F(CuckooFilterTest, SaveAndLoadTest) {
+    const string path = TempFile("cuckoo_filter_test.cf");
+    vector<uint64> absent_keys = RandomKeys(100000, 1);
+
+    // Empty, and 90% full.
+    CuckooFilter<12> cf(100000);
+    CheckSaveAndLoad(&cf, {}, absent_keys, path);
+    EXPECT_EQ(4096 + cf.SizeInBytes() + 8, File::Size(path.c_str()));
+    vector<uint64> keys = Fill(&cf, 100000, 2);
+    CheckSaveAndLoad(&cf, keys, absent_keys, path);
+
+    // With a victim: the loaded filter is full too, until a deletion re-inserts the victim.
+    CuckooFilter<8> full_cf(10000);
+    vector<uint64> full_keys = RandomKeys(full_cf.SizeInBytes(), 3);
+    full_keys.resize(FillUntilFull(&full_cf, full_keys));
+    CheckSaveAndLoad(&full_cf, full_keys, absent_keys, path);
+    unique_ptr<CuckooFilter<8>> loaded = CuckooFilter<8>::LoadFromFile(path);
+    EXPECT_FALSE(loaded->Insert(absent_keys[0]));
+    ASSERT_TRUE(loaded->Delete(full_keys[0]));
+    EXPECT_TRUE(loaded->Insert(absent_keys[0]));
+    EXPECT_TRUE(loaded->Contains(absent_keys[0]));
+
+    // Packed, and chained tables.
+    PackedCuckooFilter<12> packed_cf(100000);
+    CheckSaveAndLoad(&packed_cf, Fill(&packed_cf, 100000, 4), absent_keys, path);
+    CuckooFilter<16> dynamic_cf(1000, CuckooFilter<16>::kDynamic);
+    keys = RandomKeys(100000, 5);
+    for (uint64 key : keys)
+        ASSERT_TRUE(dynamic_cf.Insert(key));
+    EXPECT_GT(dynamic_cf.NumTables(), 1);
+    CheckSaveAndLoad(&dynamic_cf, keys, absent_keys, path);
+    loaded = nullptr;
+    unique_ptr<CuckooFilter<16>> loaded_dynamic = CuckooFilter<16>::LoadFromFile(path);
+    for (uint64 key : absent_keys)
+        ASSERT_TRUE(loaded_dynamic->Insert(key));  // Still chains tables
+
+    // Another type, truncated, or not a filter at all.
+    EXPECT_TRUE(CuckooFilter<8>::LoadFromFile(path) == nullptr);
+    EXPECT_TRUE(PackedCuckooFilter<16>::MapFromFile(path) == nullptr);
+    const int32 size = File::Size(path.c_str());
+    unique_ptr<File> file(File::Open(path.c_str(), "r"));
+    string contents(size, 0);
+    ASSERT_EQ(size, file->Read(&contents[0], size));
+    file.reset();
+    for (const string& bad : {contents.substr(0, size - 1), contents.substr(0, 100),
+                              string(size, 'x')}) {
+        unique_ptr<FileOutputStream> out(FileOutputStream::OpenOrDie(path.c_str()));
+        out->WriteOrDie(bad);
+        ASSERT_TRUE(out->Close());
+        EXPECT_TRUE(CuckooFilter<16>::LoadFromFile(path) == nullptr);
+        EXPECT_TRUE(CuckooFilter<16>::MapFromFile(path) == nullptr);
+    }
+    EXPECT_TRUE(File::Remove(path.c_str()));
+    EXPECT_TRUE(CuckooFilter<16>::LoadFromFile(path) == nullptr);
+}
@@ -0,0 +1,296 @@
+#ifndef CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CUCKOO_MAP_H_
+#define CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CUCKOO_MAP_H_
+
+#include <glog/logging.h>
+
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cpp-base/data-struct/cuckoo-filter/single_table.h"
+#include "cpp-base/data-struct/cuckoo-filter/util.h"
+#include "cpp-base/hash/hash.h"
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+
+namespace cpp_base {
+
+// A memory-dense hash map for many small entries: a bucketized cuckoo hash table, i.e., each key
+// is in one of two buckets of 4 slots, placed like in CuckooFilter. The entries are in one array
+// of 4 slots per bucket, next to a SingleTable of 8-bit tags, one per slot. A lookup compares the
+// key only to the entries of the two buckets whose tag matches, so a miss almost never reads an
+// entry, and reads 2 cache lines of tags at most.
+//
+// As in CuckooFilter, the other bucket of an entry follows from its bucket and tag, without the
+// key, which is what makes moving entries cheap. When both buckets of a new key are full, entries
+// are moved along the shortest path to an empty slot found by a breadth-first search, as with
+// CuckooFilter's kBreadthFirst mode; only when there is none, at about 97% load, is the table
+// doubled and rehashed. The overhead per entry is thus 1 byte of tag plus the empty slots: about
+// 3 bytes for an int64 key and value at 90% load, vs. 16 or more for a hash_map node. Give the
+// expected number of entries upfront for the table to fill to over 90% before doubling.
+//
+// Entries move in memory as others are inserted; do not keep pointers to them across calls.
+// This class is *not* thread safe; concurrency must be provided externally.
+template <class KeyType, class ValueType>
+class CuckooMap {
+  public:
+    static const int kSlotsPerBucket = 4;
+
+    // Max length of a path of moves found by the breadth-first search, and max buckets it looks
+    // into.
+    static const int kMaxBfsPathLength = 5;
+    static const int kMaxBfsBuckets = 512;
+
+    CuckooMap() : CuckooMap(kSlotsPerBucket) {}
+
+    // Sized like CuckooFilter for the given number of entries.
+    explicit CuckooMap(int64 expected_num_entries) {
+        const double min_num_buckets = std::max<double>(1, expected_num_entries) / kSlotsPerBucket;
+        int64 num_buckets = upperpower2(std::ceil(min_num_buckets));
+        if (min_num_buckets / num_buckets >= 0.96)
+            num_buckets *= 2;
+        Reset(num_buckets);
+    }
+
+    ~CuckooMap() {}
+
+    bool Empty() const { return size_ == 0; }
+    int64 Size() const { return size_; }
+    bool Contains(const KeyType& key) const { return FindSlot(key) >= 0; }
+
+    // Inserts the given key and value, or updates the value if the key exists. Returns whether
+    // the key is new.
+    bool Insert(const KeyType& key, const ValueType& value) {
+        int64 index;
+        uint32 tag;
+        IndexAndTag(key, &index, &tag);
+        const int64 slot = FindSlot(key, index, tag);
+        if (slot >= 0) {
+            entries_[slot].value = value;
+            return false;
+        }
+        while (!InsertNew(Entry{key, value}, index, tag)) {
+            Rehash(NumBuckets() * 2);
+            IndexAndTag(key, &index, &tag);
+        }
+        ++size_;
+        return true;
+    }
+
+    // Gets the value mapped for the given key, if any. 'value' cannot be nullptr.
+    bool Find(const KeyType& key, ValueType* value) const {
+        const int64 slot = FindSlot(key);
+        if (slot < 0)
+            return false;
+        *value = entries_[slot].value;
+        return true;
+    }
+
+    // Removes the given key. Returns whether it existed. The mapped value is filled in 'value',
+    // if non-null.
+    bool Erase(const KeyType& key, ValueType* value = nullptr) {
+        const int64 slot = FindSlot(key);
+        if (slot < 0)
+            return false;
+        if (value != nullptr)
+            *value = entries_[slot].value;
+        tags_->WriteTag(slot / kSlotsPerBucket, slot % kSlotsPerBucket, 0);
+        entries_[slot] = Entry();  // Release whatever the key and value hold on the heap
+        --size_;
+        return true;
+    }
+
+    // Keeps the current number of buckets.
+    void Clear() {
+        Reset(NumBuckets());
+    }
+
+    int64 NumBuckets() const { return tags_->NumBuckets(); }
+
+    // The fraction of slots in use.
+    double LoadFactor() const { return size_ * 1. / entries_.size(); }
+
+    // Bytes used by the entries and the tags, excluding whatever the keys and values allocate on
+    // the heap themselves.
+    int64 MemoryBytes() const {
+        return entries_.capacity() * sizeof(Entry) + tags_->SizeInBytes();
+    }
+
+    // Calls f(key, value) for each entry, in no particular order.
+    template <class F>
+    void ForEach(const F& f) const {
+        for (int64 slot = 0; slot < entries_.size(); ++slot) {
+            if (tags_->ReadTag(slot / kSlotsPerBucket, slot % kSlotsPerBucket) != 0)
+                f(entries_[slot].key, entries_[slot].value);
+        }
+    }
+
+  private:
+    struct Entry {
+        KeyType key;
+        ValueType value;
+    };
+
+    void IndexAndTag(const KeyType& key, int64* index, uint32* tag) const {
+        CuckooIndexAndTag(hash<KeyType>()(key), NumBuckets(), 8, index, tag);
+    }
+
+    // Returns the slot of the given key, i.e., bucket * kSlotsPerBucket + slot, or -1.
+    int64 FindSlot(const KeyType& key) const {
+        int64 index;
+        uint32 tag;
+        IndexAndTag(key, &index, &tag);
+        return FindSlot(key, index, tag);
+    }
+
+    int64 FindSlot(const KeyType& key, int64 index1, uint32 tag) const {
+        // Both buckets of tags and of entries fetched at once: a bucket of 4 small entries takes
+        // about a cache line.
+        const int64 index2 = CuckooAltIndex(index1, tag, NumBuckets());
+        tags_->PrefetchBucket(index2);
+        __builtin_prefetch(&entries_[index1 * kSlotsPerBucket]);
+        __builtin_prefetch(&entries_[index2 * kSlotsPerBucket]);
+        // The slots with the tag, almost always the one of the key if any: no branch to mispredict
+        // on which.
+        for (uint32 slots = tags_->FindTagSlotsInBuckets(index1, index2, tag); slots != 0;
+             slots &= slots - 1) {
+            const int k = __builtin_ctz(slots);
+            const int64 slot = (k < kSlotsPerBucket ? index1 : index2) * kSlotsPerBucket +
+                               k % kSlotsPerBucket;
+            if (entries_[slot].key == key)
+                return slot;
+        }
+        return -1;
+    }
+
+    // Inserts the given entry, of a new key, into one of its buckets. Returns false if there is no
+    // room.
+    bool InsertNew(const Entry& entry, int64 index, uint32 tag) {
+        const int64 slot = MakeRoom(index, tag);
+        if (slot < 0)
+            return false;
+        tags_->WriteTag(slot / kSlotsPerBucket, slot % kSlotsPerBucket, tag);
+        entries_[slot] = entry;
+        return true;
+    }
+
+    // The first empty slot of the given bucket, or -1.
+    int EmptySlot(int64 index) const {
+        for (int j = 0; j < kSlotsPerBucket; ++j) {
+            if (tags_->ReadTag(index, j) == 0)
+                return j;
+        }
+        return -1;
+    }
+
+    // Returns an empty slot in one of the two buckets of the given tag, after moving entries along
+    // the shortest path of moves to an empty slot if both are full, or -1 if there is no path of
+    // at most kMaxBfsPathLength moves within the first kMaxBfsBuckets buckets looked into.
+    int64 MakeRoom(int64 index1, uint32 tag) {
+        // A bucket reached by moving an entry to it from a slot of its parent bucket; the two
+        // roots have none.
+        struct Node {
+            int64 index;
+            int32 parent;
+            int32 depth;
+            int parent_slot;
+        };
+        Node nodes[kMaxBfsBuckets];
+        nodes[0] = {index1, -1, 0, -1};
+        nodes[1] = {CuckooAltIndex(index1, tag, NumBuckets()), -1, 0, -1};
+        for (int n = 0; n < 2; ++n) {
+            const int j = EmptySlot(nodes[n].index);
+            if (j >= 0)
+                return nodes[n].index * kSlotsPerBucket + j;
+        }
+        int num_nodes = 2;
+        for (int n = 0; n < num_nodes && nodes[n].depth < kMaxBfsPathLength; ++n) {
+            // The other buckets of the entries of bucket n, prefetched together.
+            int64 indices[kSlotsPerBucket];
+            for (int j = 0; j < kSlotsPerBucket; ++j) {
+                indices[j] = CuckooAltIndex(nodes[n].index, tags_->ReadTag(nodes[n].index, j),
+                                            NumBuckets());
+                tags_->PrefetchBucket(indices[j]);
+            }
+            for (int j = 0; j < kSlotsPerBucket; ++j) {
+                if (OnPath(nodes, n, indices[j]))
+                    continue;  // Moving entries in circles
+                const int empty = EmptySlot(indices[j]);
+                if (empty >= 0) {
+                    // Found: make the moves, last first, each into the slot the one before frees.
+                    int64 free_slot = indices[j] * kSlotsPerBucket + empty;
+                    int64 from = nodes[n].index * kSlotsPerBucket + j;
+                    for (int m = n; ; m = nodes[m].parent) {
+                        MoveEntry(from, free_slot);
+                        free_slot = from;
+                        if (nodes[m].parent < 0)
+                            return free_slot;
+                        from = nodes[nodes[m].parent].index * kSlotsPerBucket +
+                               nodes[m].parent_slot;
+                    }
+                }
+                if (num_nodes < kMaxBfsBuckets)
+                    nodes[num_nodes++] = {indices[j], n, nodes[n].depth + 1, j};
+            }
+        }
+        return -1;
+    }
+
+    // Whether the path from a root to the given node goes through the given bucket.
+    template <class Node>
+    static bool OnPath(const Node* nodes, int n, int64 index) {
+        for (; n >= 0; n = nodes[n].parent) {
+            if (nodes[n].index == index)
+                return true;
+        }
+        return false;
+    }
+
+    void MoveEntry(int64 from, int64 to) {
+        tags_->WriteTag(to / kSlotsPerBucket, to % kSlotsPerBucket,
+                        tags_->ReadTag(from / kSlotsPerBucket, from % kSlotsPerBucket));
+        tags_->WriteTag(from / kSlotsPerBucket, from % kSlotsPerBucket, 0);
+        entries_[to] = std::move(entries_[from]);
+        entries_[from] = Entry();
+    }
+
+    void Reset(int64 num_buckets) {
+        CHECK_LE(num_buckets, kMaxCuckooBuckets) << "Too many entries for a CuckooMap";
+        tags_.reset(new SingleTable<8>(num_buckets));
+        entries_.assign(num_buckets * kSlotsPerBucket, Entry());
+        entries_.shrink_to_fit();
+        size_ = 0;
+    }
+
+    // Re-inserts all entries into a table of the given number of buckets, or more if need be.
+    void Rehash(int64 num_buckets) {
+        std::unique_ptr<SingleTable<8>> old_tags(std::move(tags_));
+        std::vector<Entry> old_entries;
+        old_entries.swap(entries_);
+        const int64 size = size_;
+        for (bool done = false; !done; num_buckets *= 2) {
+            Reset(num_buckets);
+            done = true;
+            for (int64 slot = 0; slot < old_entries.size() && done; ++slot) {
+                if (old_tags->ReadTag(slot / kSlotsPerBucket, slot % kSlotsPerBucket) != 0) {
+                    int64 index;
+                    uint32 tag;
+                    IndexAndTag(old_entries[slot].key, &index, &tag);
+                    done = InsertNew(old_entries[slot], index, tag);
+                }
+            }
+        }
+        size_ = size;
+    }
+
+    std::unique_ptr<SingleTable<8>> tags_;  // The tag of each slot; 0 means empty
+    std::vector<Entry> entries_;             // Slot j of bucket i at i * kSlotsPerBucket + j
+    int64 size_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(CuckooMap);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_CUCKOO_MAP_H_
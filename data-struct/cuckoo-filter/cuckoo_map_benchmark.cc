@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cpp-base/data-struct/cuckoo-filter/cuckoo_map.h"
+#include "cpp-base/data-struct/heap_counter_test_util.h"
+#include "cpp-base/hash/hash.h"
+
+using cpp_base::CuckooMap;
+using cpp_base::HeapAllocatedBytes;
+using std::string;
+using std::vector;
+
+class CuckooMapTest : public ::testing::Test {
+  public:
+    CuckooMapTest() { }
+    ~CuckooMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+};
+
+TEST_F(CuckooMapTest, Benchmark) {
+    // uint64 -> uint64, each map given the number of entries upfront, which fills CuckooMap to
+    // 89%, vs. hash_map and std::unordered_map.
+    const int64 kNumEntries = 7500000;
+    const int64 kNumLookups = 10000000;
+    typedef std::chrono::steady_clock clock;
+    vector<uint64> keys = RandomKeys(kNumEntries, 1);
+    vector<uint64> lookups(kNumLookups);
+    for (int64 i = 0; i < kNumLookups; ++i)
+        lookups[i] = keys[rand() % kNumEntries];  // NOLINT
+    // lookup + 1 is almost surely absent, which makes a miss.
+    // Memory is counted from 'before' the map is constructed.
+    auto run = [&](const string& name, int64 before, auto* map, auto insert, auto find) {
+        auto start = clock::now();
+        for (int64 i = 0; i < kNumEntries; ++i)
+            insert(map, keys[i], i);
+        const double insert_ns =
+                std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        const double bytes = (HeapAllocatedBytes() - before) * 1. / kNumEntries;
+        double ns[2];
+        int64 num_found = 0;
+        for (int miss = 0; miss < 2; ++miss) {
+            start = clock::now();
+            for (int64 i = 0; i < kNumLookups; ++i)
+                num_found += find(*map, lookups[i] + miss);
+            ns[miss] = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        }
+        LOG(INFO) << name << ": " << bytes << " bytes/entry, " << insert_ns / kNumEntries
+                  << " ns/insert, " << ns[0] / kNumLookups << " ns/hit, "
+                  << ns[1] / kNumLookups << " ns/miss";
+        EXPECT_EQ(kNumLookups, num_found);
+        return bytes;
+    };
+
+    double cuckoo_bytes;
+    {
+        const int64 before = HeapAllocatedBytes();
+        CuckooMap<uint64, uint64> m(kNumEntries);
+        cuckoo_bytes = run("CuckooMap", before, &m,
+                           [](CuckooMap<uint64, uint64>* m, uint64 key, uint64 value) {
+                               m->Insert(key, value);
+                           },
+                           [](const CuckooMap<uint64, uint64>& m, uint64 key) {
+                               uint64 value;
+                               return m.Find(key, &value);
+                           });
+        LOG(INFO) << "CuckooMap load factor: " << m.LoadFactor();
+    }
+    double hash_map_bytes;
+    {
+        const int64 before = HeapAllocatedBytes();
+        cpp_base::hash_map<uint64, uint64> m(kNumEntries);
+        hash_map_bytes = run("hash_map", before, &m,
+                             [](cpp_base::hash_map<uint64, uint64>* m, uint64 key, uint64 value) {
+                                 (*m)[key] = value;
+                             },
+                             [](const cpp_base::hash_map<uint64, uint64>& m, uint64 key) {
+                                 return m.find(key) != m.end();
+                             });
+    }
+    {
+        const int64 before = HeapAllocatedBytes();
+        std::unordered_map<uint64, uint64> m(kNumEntries);
+        run("std::unordered_map", before, &m,
+            [](std::unordered_map<uint64, uint64>* m, uint64 key, uint64 value) {
+                (*m)[key] = value;
+            },
+            [](const std::unordered_map<uint64, uint64>& m, uint64 key) {
+                return m.find(key) != m.end();
+            });
+    }
+    EXPECT_LT(cuckoo_bytes, hash_map_bytes);
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cpp-base/data-struct/cuckoo-filter/cuckoo_map.h"
+
+using cpp_base::CuckooMap;
+using std::string;
+using std::vector;
+
+class CuckooMapTest : public ::testing::Test {
+  public:
+    CuckooMapTest() { }
+    ~CuckooMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+};
+
+TEST_F(CuckooMapTest, BasicTest) {
+    CuckooMap<string, int> m(10);
+    int x = 0;
+    EXPECT_TRUE(m.Empty());
+    EXPECT_FALSE(m.Contains(""));
+    EXPECT_FALSE(m.Find("", &x));
+    EXPECT_FALSE(m.Erase(""));
+
+    EXPECT_TRUE(m.Insert("one", 1));
+    EXPECT_TRUE(m.Insert("two", 2));
+    EXPECT_TRUE(m.Insert("", 0));
+    EXPECT_FALSE(m.Insert("two", 22));  // Updates
+    EXPECT_EQ(3, m.Size());
+    EXPECT_TRUE(m.Find("two", &x));
+    EXPECT_EQ(22, x);
+    EXPECT_TRUE(m.Contains(""));
+    EXPECT_FALSE(m.Contains("three"));
+
+    EXPECT_TRUE(m.Erase("one", &x));
+    EXPECT_EQ(1, x);
+    EXPECT_FALSE(m.Contains("one"));
+    EXPECT_FALSE(m.Erase("one"));
+    EXPECT_EQ(2, m.Size());
+
+    int64 sum = 0;
+    m.ForEach([&sum](const string& key, int value) { sum += value; });
+    EXPECT_EQ(22, sum);
+
+    const int64 num_buckets = m.NumBuckets();
+    m.Clear();
+    EXPECT_TRUE(m.Empty());
+    EXPECT_FALSE(m.Contains("two"));
+    EXPECT_EQ(num_buckets, m.NumBuckets());
+}
+
+TEST_F(CuckooMapTest, RandomTest) {
+    // Random inserts, updates, erases and lookups from an empty map, which grows many times,
+    // against std::unordered_map.
+    CuckooMap<uint64, int64> m;
+    std::unordered_map<uint64, int64> expected;
+    std::mt19937_64 rand_gen(1);
+    for (int64 i = 0; i < 1000000; ++i) {
+        const uint64 key = rand_gen() % 200000;
+        int64 value = 0;
+        switch (rand_gen() % 4) {
+          case 0:
+          case 1:
+            ASSERT_EQ(expected.count(key) == 0, m.Insert(key, i));
+            expected[key] = i;
+            break;
+          case 2:
+            ASSERT_EQ(expected.erase(key) == 1, m.Erase(key, &value));
+            break;
+          default:
+            ASSERT_EQ(expected.count(key) == 1, m.Find(key, &value));
+            if (expected.count(key) == 1) {
+                ASSERT_EQ(expected[key], value);
+            }
+        }
+        ASSERT_EQ(expected.size(), m.Size());
+    }
+    int64 num_entries = 0;
+    m.ForEach([&](uint64 key, int64 value) {
+        ASSERT_EQ(expected[key], value);
+        ++num_entries;
+    });
+    EXPECT_EQ(expected.size(), num_entries);
+}
+
+TEST_F(CuckooMapTest, LoadFactorTest) {
+    // Fills up past 90% before growing, then keeps all entries.
+    CuckooMap<uint64, uint64> m(100000);
+    const int64 num_buckets = m.NumBuckets();
+    vector<uint64> keys = RandomKeys(num_buckets * 4, 1);
+    int64 num_keys = 0;
+    double load_factor = 0;
+    for (; num_keys < keys.size() && m.NumBuckets() == num_buckets; ++num_keys) {
+        load_factor = m.LoadFactor();
+        ASSERT_TRUE(m.Insert(keys[num_keys], ~keys[num_keys]));
+    }
+    LOG(INFO) << "Grew at load factor " << load_factor;
+    EXPECT_GT(load_factor, 0.9);
+    EXPECT_EQ(num_buckets * 2, m.NumBuckets());
+    EXPECT_EQ(num_keys, m.Size());
+    for (int64 i = 0; i < num_keys; ++i) {
+        uint64 value = 0;
+        ASSERT_TRUE(m.Find(keys[i], &value));
+        ASSERT_EQ(~keys[i], value);
+    }
+    for (uint64 key : RandomKeys(100000, 2))
+        EXPECT_FALSE(m.Contains(key));
+}
@@ -0,0 +1,252 @@
+// Based on https://github.com/efficient/cuckoofilter by Efficient Computing at Carnegie Mellon
+
+#ifndef CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_PACKED_TABLE_H_
+#define CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_PACKED_TABLE_H_
+
+#include <glog/logging.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+#include "cpp-base/data-struct/cuckoo-filter/util.h"
+#include "cpp-base/integral_types.h"
+
+namespace cpp_base {
+
+// Encodes the low 4 bits of the 4 tags of a bucket, sorted, in 12 bits rather than 16: there
+// are only 3876 sorted sequences of 4 values out of 16.
+class PermEncoding {
+  public:
+    static const int kNumCodes = 3876;
+
+    static const PermEncoding& Get() {
+        static const PermEncoding* encoding = new PermEncoding;
+        return *encoding;
+    }
+
+    // 'lows' has 4 non-decreasing 4-bit values, the k-th in bits 4k to 4k+3.
+    uint16 Encode(uint16 lows) const { return enc_table_[lows]; }
+    uint16 Decode(uint16 code) const { return dec_table_[code]; }
+
+  private:
+    PermEncoding() {
+        int code = 0;
+        for (int a = 0; a < 16; ++a) {
+            for (int b = a; b < 16; ++b) {
+                for (int c = b; c < 16; ++c) {
+                    for (int d = c; d < 16; ++d) {
+                        const uint16 lows = a | (b << 4) | (c << 8) | (d << 12);
+                        dec_table_[code] = lows;
+                        enc_table_[lows] = code;
+                        ++code;
+                    }
+                }
+            }
+        }
+        CHECK_EQ(kNumCodes, code);
+    }
+
+    uint16 dec_table_[kNumCodes];
+    uint16 enc_table_[1 << 16];
+};
+
+// A table of 4-tag buckets with "semi-sorting": the tags of a bucket are kept sorted by their low
+// 4 bits, which are stored encoded by PermEncoding, so each tag takes one bit less than in
+// SingleTable, for the same false positive rate. A bucket of b-bit tags takes 4b - 4 bits, e.g.,
+// 44 bits for 12-bit tags. Takes 4 to 16 bits per tag, a template parameter as in SingleTable.
+//
+// Reading a bucket decodes it into 4 16-bit tags and writing one re-encodes them, which makes
+// lookups and insertions slower than with SingleTable; see TagWidthBenchmark in
+// cuckoo_filter_benchmark.cc.
+template <int bits_per_tag>
+class PackedTable {
+    static_assert(bits_per_tag >= 4 && bits_per_tag <= 16, "Unsupported bits_per_tag");
+
+  public:
+    static const int kBitsPerTag = bits_per_tag;
+    static const int kTagsPerBucket = 4;
+
+    explicit PackedTable(int64 num_buckets)
+            : num_buckets_(num_buckets),
+              byte_size_((num_buckets * kBitsPerBucket + 7) >> 3),
+              data_(new uint8[RawSize(num_buckets)]),
+              owns_data_(true),
+              encoding_(PermEncoding::Get()),
+              rand_gen_(12345678) {
+        CHECK_GT(num_buckets_, 0);
+        memset(data_, 0, RawSize(num_buckets));
+
+        VLOG(1) << "Inited a " << num_buckets << "x" << kBitsPerBucket
+                << "-bit packed Cuckoo Filter (" << (byte_size_ * 1. / 1024 / 1024 / 1024)
+                << " GB)";
+    }
+
+    // A table over the given RawSize(num_buckets) bytes, as in SingleTable.
+    PackedTable(int64 num_buckets, uint8* data, bool owns_data)
+            : num_buckets_(num_buckets),
+              byte_size_((num_buckets * kBitsPerBucket + 7) >> 3),
+              data_(data),
+              owns_data_(owns_data),
+              encoding_(PermEncoding::Get()),
+              rand_gen_(12345678) {
+        CHECK_GT(num_buckets_, 0);
+    }
+
+    ~PackedTable() {
+        if (owns_data_)
+            delete [] data_;
+    }
+
+    // The bytes of a table of the given number of buckets, padding included.
+    static int64 RawSize(int64 num_buckets) {
+        return ((num_buckets * kBitsPerBucket + 7) >> 3) + 16;
+    }
+
+    const uint8* RawData() const { return data_; }
+
+    void Clear() {
+        memset(data_, 0, byte_size_);
+    }
+
+    int64 SizeInBytes() const { return byte_size_; }
+
+    int64 SizeInTags() const { return 4 * num_buckets_; }
+
+    int64 NumBuckets() const { return num_buckets_; }
+
+    std::string Info() const  {
+        std::stringstream ss;
+        ss << "PackedHashtable with tag size: " << bits_per_tag << " bits \n";
+        ss << "\t\tAssociativity: 4\n";
+        ss << "\t\tTotal # of rows: " << num_buckets_ << "\n";
+        ss << "\t\tTotal # slots: " << SizeInTags() << "\n";
+        return ss.str();
+    }
+
+    // The j-th tag of bucket i. The tags of a bucket are sorted, so it may change as others are
+    // written to it.
+    inline uint32 ReadTag(const int64 i, const int64 j) const {
+        return (ReadBucket(i) >> (16 * j)) & 0xFFFF;
+    }
+
+    inline bool FindTagInBuckets(const int64 i1, const int64 i2, const uint32 tag) const {
+        // Both buckets read before testing either, so that their cache misses overlap.
+        const uint64 tags1 = ReadBucket(i1);
+        const uint64 tags2 = ReadBucket(i2);
+        return (hasvalue16(tags1, tag) | hasvalue16(tags2, tag)) != 0;
+    }
+
+    inline bool FindTagInBucket(const int64 i, const uint32 tag) const {
+        return hasvalue16(ReadBucket(i), tag);
+    }
+
+    // Prefetches bucket i into the cache, ahead of a FindTag*() or InsertTagToBucket() on it.
+    inline void PrefetchBucket(const int64 i) const {
+        const uint8* p = data_ + ((i * kBitsPerBucket) >> 3);
+        __builtin_prefetch(p);
+        __builtin_prefetch(p + 7);  // The bucket may cross a cache line
+    }
+
+    inline bool DeleteTagFromBucket(const int64 i, const uint32 tag) {
+        uint16 tags[4];
+        UnpackTags(ReadBucket(i), tags);
+        for (int j = 0; j < 4; ++j) {
+            if (tags[j] == tag) {
+                tags[j] = 0;
+                WriteBucket(i, tags);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline bool InsertTagToBucket(const int64 i,  const uint32 tag,
+                                  const bool kickout, uint32& oldtag) {
+        uint16 tags[4];
+        UnpackTags(ReadBucket(i), tags);
+        for (int j = 0; j < 4; ++j) {
+            if (tags[j] == 0) {
+                tags[j] = tag;
+                WriteBucket(i, tags);
+                return true;
+            }
+        }
+        if (kickout) {
+            int r = rand_gen_() % 4;
+            oldtag = tags[r];
+            tags[r] = tag;
+            WriteBucket(i, tags);
+        }
+        return false;
+    }
+
+    inline int64 NumTagsInBucket(const int64 i) {
+        uint16 tags[4];
+        UnpackTags(ReadBucket(i), tags);
+        return (tags[0] != 0) + (tags[1] != 0) + (tags[2] != 0) + (tags[3] != 0);
+    }
+
+  private:
+    static const int kDirBitsPerTag = bits_per_tag - 4;  // Bits of a tag above the low 4
+    static const int kBitsPerBucket = 4 * bits_per_tag - 4;
+    static const uint64 kBucketMask = (1ULL << kBitsPerBucket) - 1;
+
+    // Returns the 4 tags of bucket i, the k-th in bits 16k to 16k+15. A bucket has the code of the
+    // low bits of its tags in its low 12 bits, then the remaining high bits of each tag.
+    inline uint64 ReadBucket(const int64 i) const {
+        // The 8 bytes the bucket starts in, and the next one only if it ends there, so as not to
+        // touch the next cache line needlessly.
+        const int64 offset = i * kBitsPerBucket;
+        const uint8* p = data_ + (offset >> 3);
+        const int shift = offset & 7;
+        uint64 bucket;
+        memcpy(&bucket, p, 8);  // Little-endian
+        bucket >>= shift;
+        if (shift + kBitsPerBucket > 64)
+            bucket |= static_cast<uint64>(p[8]) << (64 - shift);
+        bucket &= kBucketMask;
+
+        // Spread the 4 low nibbles to bits 0, 16, 32 and 48, then add the high bits.
+        uint64 tags = encoding_.Decode(bucket & 0xFFF);
+        tags = (tags | (tags << 24)) & 0x000000FF000000FFULL;
+        tags = (tags | (tags << 12)) & 0x000F000F000F000FULL;
+        const uint64 dir_mask = (1ULL << kDirBitsPerTag) - 1;
+        for (int k = 0; k < 4; ++k)
+            tags |= ((bucket >> (12 + k * kDirBitsPerTag)) & dir_mask) << (16 * k + 4);
+        return tags;
+    }
+
+    static inline void UnpackTags(uint64 packed, uint16* tags) {
+        for (int k = 0; k < 4; ++k)
+            tags[k] = packed >> (16 * k);
+    }
+
+    // Sorts the given tags by their low bits and writes them to bucket i.
+    inline void WriteBucket(const int64 i, uint16* tags) {
+        std::sort(tags, tags + 4, [](uint16 a, uint16 b) { return (a & 0xF) < (b & 0xF); });
+        uint64 bucket = encoding_.Encode((tags[0] & 0xF) | ((tags[1] & 0xF) << 4) |
+                                         ((tags[2] & 0xF) << 8) | ((tags[3] & 0xF) << 12));
+        for (int k = 0; k < 4; ++k)
+            bucket |= static_cast<uint64>(tags[k] >> 4) << (12 + k * kDirBitsPerTag);
+
+        const int64 offset = i * kBitsPerBucket;
+        unsigned __int128 value;
+        memcpy(&value, data_ + (offset >> 3), 16);
+        value &= ~(static_cast<unsigned __int128>(kBucketMask) << (offset & 7));
+        value |= static_cast<unsigned __int128>(bucket) << (offset & 7);
+        memcpy(data_ + (offset >> 3), &value, 16);
+    }
+
+    const int64 num_buckets_;
+    const int64 byte_size_;
+    uint8* data_;                   // The buckets, back to back, plus padding for 16-byte writes
+    const bool owns_data_;
+    const PermEncoding& encoding_;
+    std::mt19937_64 rand_gen_;
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_PACKED_TABLE_H_
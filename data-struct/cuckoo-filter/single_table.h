@@ -4,7 +4,14 @@
 #define CPP_BASE_DATA_STRUCT_CUCKOO_FILTER_SINGLE_TABLE_H_
 
 #include <glog/logging.h>
-#include <xmmintrin.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <random>
 #include <sstream>
@@ -20,45 +27,75 @@
 
 namespace cpp_base {
 
-// the most naive table implementation: one huge bit array
+// the most naive table implementation: one huge bit array of buckets of 4 tags of bits_per_tag
+// bits each, which is a template parameter so that each width gets its own code: no branching
+// on it at runtime.
+//
+// FindTagInBuckets() compares the tag to the 8 tags of both buckets at once: with one SSE2
+// compare for 8 and 16-bit tags, SSE4.1 for 12-bit ones (which are first widened to 16 bits) and
+// AVX2 for 32-bit ones (two SSE2 compares without it), when compiled for these. Otherwise, it
+// tests each bucket for the tag with the hasvalue bit tricks of util.h.
+template <int bits_per_tag>
 class SingleTable {
+    static_assert(bits_per_tag == 2 || bits_per_tag == 4 || bits_per_tag == 8 ||
+                  bits_per_tag == 12 || bits_per_tag == 16 || bits_per_tag == 32,
+                  "Unsupported bits_per_tag");
+
   public:
-    SingleTable(int64 num_buckets, int tags_per_bucket, int bits_per_tag)
+    static const int kBitsPerTag = bits_per_tag;
+    static const int kTagsPerBucket = 4;
+    static const int kBytesPerBucket = (bits_per_tag * kTagsPerBucket + 7) >> 3;
+
+    explicit SingleTable(int64 num_buckets)
             : num_buckets_(num_buckets),
-              tags_per_bucket_(tags_per_bucket),
-              bytes_per_bucket_((bits_per_tag * tags_per_bucket + 7) >> 3),
-              bits_per_tag_(bits_per_tag),
-              tag_mask_((1ULL << bits_per_tag_) - 1),
-              data_(new uint8[num_buckets * bytes_per_bucket_ + 8]),
+              data_(new uint8[RawSize(num_buckets)]),
+              owns_data_(true),
               rand_gen_(12345678) {
         CHECK_GT(num_buckets_, 0);
-        CHECK_GT(tags_per_bucket_, 0);
-        CHECK_GT(bytes_per_bucket_, 0);
-        CHECK_GT(bits_per_tag_, 0);
-        memset(data_, 0, num_buckets * bytes_per_bucket_);
+        ASSERT_LITTLE_ENDIAN();
+        memset(data_, 0, RawSize(num_buckets));
 
-        LOG(INFO) << "Inited a " << num_buckets << "x" << bytes_per_bucket_ << " Cuckoo Filter ("
-                  << (num_buckets * 1. * bytes_per_bucket_ / 1024 / 1024 / 1024) << " GB)";
+        VLOG(1) << "Inited a " << num_buckets << "x" << kBytesPerBucket << " Cuckoo Filter ("
+                << (num_buckets * 1. * kBytesPerBucket / 1024 / 1024 / 1024) << " GB)";
+    }
+
+    // A table over the given RawSize(num_buckets) bytes, as RawData() of another table, e.g.,
+    // mapped from a file. Takes ownership of them, which must be allocated with new[], only if
+    // 'owns_data'; otherwise they must outlive the table.
+    SingleTable(int64 num_buckets, uint8* data, bool owns_data)
+            : num_buckets_(num_buckets),
+              data_(data),
+              owns_data_(owns_data),
+              rand_gen_(12345678) {
+        CHECK_GT(num_buckets_, 0);
+        ASSERT_LITTLE_ENDIAN();
     }
 
     ~SingleTable() {
-        delete [] data_;
+        if (owns_data_)
+            delete [] data_;
     }
 
+    // The bytes of a table of the given number of buckets: the buckets, plus padding for loads
+    // past the last one.
+    static int64 RawSize(int64 num_buckets) { return num_buckets * kBytesPerBucket + 8; }
+
+    const uint8* RawData() const { return data_; }
+
     void Clear() {
-        memset(data_, 0, num_buckets_ * bytes_per_bucket_);
+        memset(data_, 0, num_buckets_ * kBytesPerBucket);
     }
 
-    int64 SizeInBytes() const { return bytes_per_bucket_ * num_buckets_; }
+    int64 SizeInBytes() const { return kBytesPerBucket * num_buckets_; }
 
-    int64 SizeInTags() const { return tags_per_bucket_ * num_buckets_; }
+    int64 SizeInTags() const { return kTagsPerBucket * num_buckets_; }
 
     int64 NumBuckets() const { return num_buckets_; }
 
     std::string Info() const  {
         std::stringstream ss;
-        ss << "SingleHashtable with tag size: " << bits_per_tag_ << " bits \n";
-        ss << "\t\tAssociativity: " << tags_per_bucket_ << "\n";
+        ss << "SingleHashtable with tag size: " << bits_per_tag << " bits \n";
+        ss << "\t\tAssociativity: " << kTagsPerBucket << "\n";
         ss << "\t\tTotal # of rows: " << num_buckets_ << "\n";
         ss << "\t\tTotal # slots: " << SizeInTags() << "\n";
         return ss.str();
@@ -66,141 +103,172 @@ class SingleTable {
 
     // read tag from pos(i,j)
     inline uint32 ReadTag(const int64 i, const int64 j) const {
-        const uint8* p = data_ + i * bytes_per_bucket_;
+        const uint8* p = data_ + i * kBytesPerBucket;
         uint32 tag = 0;
 
         // The following code only works for little-endian.
-        ASSERT_LITTLE_ENDIAN();
-
-        if (bits_per_tag_ == 2) {
+        if (bits_per_tag == 2) {
             tag = *p >> (j * 2);
-        }
-        else if (bits_per_tag_ == 4) {
+        } else if (bits_per_tag == 4) {
             p += (j >> 1);
             tag = *p >> ((j & 1) << 2);
-        }
-        else if (bits_per_tag_ == 8) {
+        } else if (bits_per_tag == 8) {
             p += j;
             tag = *p;
-        }
-        else if (bits_per_tag_ == 12) {
+        } else if (bits_per_tag == 12) {
             p += j + (j >> 1);
-            tag = *((uint16*) p) >> ((j & 1) << 2);
+            tag = Load<uint16>(p) >> ((j & 1) << 2);
+        } else if (bits_per_tag == 16) {
+            tag = Load<uint16>(p + (j << 1));
+        } else if (bits_per_tag == 32) {
+            tag = Load<uint32>(p + (j << 2));
         }
-        else if (bits_per_tag_ == 16) {
-            p += (j << 1);
-            tag = *((uint16*) p);
-        }
-        else if (bits_per_tag_ == 32) {
-            tag = ((uint32*) p)[j];
-        } else {
-            LOG(FATAL) << "Unsupported bits_per_tag " << bits_per_tag_;
-        }
-        return tag & tag_mask_;
+        return tag & kTagMask;
     }
 
     // write tag to pos(i,j)
-    inline void  WriteTag(const int64 i, const int64 j, const uint32 __tag) {
-        uint8* p = data_ + i * bytes_per_bucket_;
-        uint32 tag = __tag & tag_mask_;
+    inline void WriteTag(const int64 i, const int64 j, const uint32 __tag) {
+        uint8* p = data_ + i * kBytesPerBucket;
+        uint32 tag = __tag & kTagMask;
 
         // The following code only works for little-endian.
-        ASSERT_LITTLE_ENDIAN();
-
-        if (bits_per_tag_ == 2) {
-            *p |= tag << (2 * j);
-        }
-        else if (bits_per_tag_ == 4) {
+        if (bits_per_tag == 2) {
+            *p = (*p & ~(3 << (2 * j))) | (tag << (2 * j));
+        } else if (bits_per_tag == 4) {
             p += (j >> 1);
-            if ( (j & 1) == 0) {
-                *p  &= 0xf0;
-                *p  |= tag;
-            }
-            else {
-                *p  &= 0x0f;
-                *p  |= (tag << 4);
-            }
-        }
-        else if (bits_per_tag_ == 8) {
-            p[j] =  tag;
-        }
-        else if (bits_per_tag_ == 12) {
+            if ((j & 1) == 0)
+                *p = (*p & 0xf0) | tag;
+            else
+                *p = (*p & 0x0f) | (tag << 4);
+        } else if (bits_per_tag == 8) {
+            p[j] = tag;
+        } else if (bits_per_tag == 12) {
             p += (j + (j >> 1));
-            if ( (j & 1) == 0) {
-                ((uint16*) p)[0] &= 0xf000;
-                ((uint16*) p)[0] |= tag;
-            }
-            else {
-                ((uint16*) p)[0] &= 0x000f;
-                ((uint16*) p)[0] |= (tag << 4);
-            }
-        }
-        else if (bits_per_tag_ == 16) {
-            ((uint16*) p)[j] = tag;
-        }
-        else if (bits_per_tag_ == 32) {
-            ((uint32*) p)[j] = tag;
+            uint16 word = Load<uint16>(p);
+            if ((j & 1) == 0)
+                word = (word & 0xf000) | tag;
+            else
+                word = (word & 0x000f) | (tag << 4);
+            memcpy(p, &word, 2);
+        } else if (bits_per_tag == 16) {
+            const uint16 word = tag;
+            memcpy(p + (j << 1), &word, 2);
+        } else if (bits_per_tag == 32) {
+            memcpy(p + (j << 2), &tag, 4);
         }
     }
 
     inline bool FindTagInBuckets(const int64 i1,
                                  const int64 i2,
                                  const uint32 tag) const {
-        const uint8* p1 = data_ + i1 * bytes_per_bucket_;
-        const uint8* p2 = data_ + i2 * bytes_per_bucket_;
-
-        uint64 v1 =  *((uint64*) p1);
-        uint64 v2 =  *((uint64*) p2);
+        const uint8* p1 = data_ + i1 * kBytesPerBucket;
+        const uint8* p2 = data_ + i2 * kBytesPerBucket;
 
-        // caution: unaligned access & assuming little endian
-        if (bits_per_tag_ == 4 && tags_per_bucket_ == 4) {
-            return hasvalue4(v1, tag) || hasvalue4(v2, tag);
-        }
-        else if (bits_per_tag_ == 8 && tags_per_bucket_ == 4) {
-            return hasvalue8(v1, tag) || hasvalue8(v2, tag);
+#ifdef __SSE2__
+        if (bits_per_tag == 8 || bits_per_tag == 16) {
+            // Zero-extended: the tag is never 0.
+            const __m128i tags = _mm_set_epi64x(LoadBucket(p2), LoadBucket(p1));
+            const __m128i eq = bits_per_tag == 8 ?
+                    _mm_cmpeq_epi8(tags, _mm_set1_epi8(tag)) :
+                    _mm_cmpeq_epi16(tags, _mm_set1_epi16(tag));
+            return _mm_movemask_epi8(eq) != 0;
         }
-        else if (bits_per_tag_ == 12 && tags_per_bucket_ == 4) {
-            return hasvalue12(v1, tag) || hasvalue12(v2, tag);
+#endif
+#ifdef __SSE4_1__
+        if (bits_per_tag == 12) {
+            // Widen the 4 12-bit tags of each 6-byte bucket to 16 bits: each lane gets the 2
+            // bytes its tag is in, then the odd tags are shifted down by 4 and all are masked.
+            __m128i tags = _mm_set_epi64x(Load<uint64>(p2), Load<uint64>(p1));
+            tags = _mm_shuffle_epi8(tags, _mm_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5,
+                                                        8, 9, 9, 10, 11, 12, 12, 13));
+            tags = _mm_blend_epi16(tags, _mm_srli_epi16(tags, 4), 0xAA);
+            tags = _mm_and_si128(tags, _mm_set1_epi16(0xFFF));
+            return _mm_movemask_epi8(_mm_cmpeq_epi16(tags, _mm_set1_epi16(tag))) != 0;
         }
-        else if (bits_per_tag_ == 16 && tags_per_bucket_ == 4) {
-            return hasvalue16(v1, tag) || hasvalue16(v2, tag);
+#endif
+#ifdef __AVX2__
+        if (bits_per_tag == 32) {
+            const __m256i tags = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p1))),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(p2)), 1);
+            return _mm256_movemask_epi8(_mm256_cmpeq_epi32(tags, _mm256_set1_epi32(tag))) != 0;
         }
-        else {
-            for (int64 j = 0; j < tags_per_bucket_; j++)
-                if ((ReadTag(i1, j) == tag) || (ReadTag(i2,j) == tag))
-                    return true;
-            return false;
+#elif defined(__SSE2__)
+        if (bits_per_tag == 32) {
+            const __m128i t = _mm_set1_epi32(tag);
+            const __m128i eq = _mm_or_si128(
+                    _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p1)), t),
+                    _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p2)), t));
+            return _mm_movemask_epi8(eq) != 0;
         }
+#endif
+        if (bits_per_tag == 4)
+            return hasvalue4(Load<uint16>(p1), tag) || hasvalue4(Load<uint16>(p2), tag);
+        if (bits_per_tag == 8)
+            return hasvalue8(Load<uint32>(p1), tag) || hasvalue8(Load<uint32>(p2), tag);
+        if (bits_per_tag == 12)
+            return hasvalue12(Load<uint64>(p1), tag) || hasvalue12(Load<uint64>(p2), tag);
+        if (bits_per_tag == 16)
+            return hasvalue16(Load<uint64>(p1), tag) || hasvalue16(Load<uint64>(p2), tag);
+        for (int64 j = 0; j < kTagsPerBucket; j++)
+            if ((ReadTag(i1, j) == tag) || (ReadTag(i2,j) == tag))
+                return true;
+        return false;
     }
 
-    inline bool FindTagInBucket(const int64 i, const uint32 tag) const {
-        // Caution: unaligned access & assuming little endian.
-        const uint8* p = data_ + i * bytes_per_bucket_;
-        uint64 val = *(uint64*)p;
-        ASSERT_LITTLE_ENDIAN();
-        if (bits_per_tag_ == 4 && tags_per_bucket_ == 4) {
-            return hasvalue4(val, tag);
-        }
-        else if (bits_per_tag_ == 8 && tags_per_bucket_ == 4) {
-            return hasvalue8(val, tag);
+    // The slots of buckets i1 and i2 that hold the given tag: bit j for slot j of i1, and bit
+    // kTagsPerBucket + j for slot j of i2.
+    inline uint32 FindTagSlotsInBuckets(const int64 i1,
+                                        const int64 i2,
+                                        const uint32 tag) const {
+#ifdef __SSE2__
+        const uint8* p1 = data_ + i1 * kBytesPerBucket;
+        const uint8* p2 = data_ + i2 * kBytesPerBucket;
+        if (bits_per_tag == 8) {
+            const __m128i tags = _mm_cvtsi64_si128(Load<uint32>(p1) |
+                                                   (static_cast<uint64>(Load<uint32>(p2)) << 32));
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(tags, _mm_set1_epi8(tag))) & 0xFF;
         }
-        else if (bits_per_tag_ == 12 && tags_per_bucket_ == 4) {
-            return hasvalue12(val, tag);
+        if (bits_per_tag == 16) {
+            const __m128i eq = _mm_cmpeq_epi16(_mm_set_epi64x(Load<uint64>(p2), Load<uint64>(p1)),
+                                               _mm_set1_epi16(tag));
+            return _mm_movemask_epi8(_mm_packs_epi16(eq, eq)) & 0xFF;
         }
-        else if (bits_per_tag_ == 16 && tags_per_bucket_ == 4) {
-            return hasvalue16(val, tag);
+#endif
+        uint32 slots = 0;
+        for (int64 j = 0; j < kTagsPerBucket; j++) {
+            slots |= (ReadTag(i1, j) == tag) << j;
+            slots |= (ReadTag(i2, j) == tag) << (kTagsPerBucket + j);
         }
-        else {
-            for (int64 j = 0; j < tags_per_bucket_; j++) {
-                if (ReadTag(i, j) == tag)
-                    return true;
-            }
-            return false;
+        return slots;
+    }
+
+    inline bool FindTagInBucket(const int64 i, const uint32 tag) const {
+        const uint8* p = data_ + i * kBytesPerBucket;
+        if (bits_per_tag == 4)
+            return hasvalue4(Load<uint16>(p), tag);
+        if (bits_per_tag == 8)
+            return hasvalue8(Load<uint32>(p), tag);
+        if (bits_per_tag == 12)
+            return hasvalue12(Load<uint64>(p), tag);
+        if (bits_per_tag == 16)
+            return hasvalue16(Load<uint64>(p), tag);
+        for (int64 j = 0; j < kTagsPerBucket; j++) {
+            if (ReadTag(i, j) == tag)
+                return true;
         }
+        return false;
+    }
+
+    // Prefetches bucket i into the cache, ahead of a FindTag*() or InsertTagToBucket() on it.
+    inline void PrefetchBucket(const int64 i) const {
+        const uint8* p = data_ + i * kBytesPerBucket;
+        __builtin_prefetch(p);
+        __builtin_prefetch(p + kBytesPerBucket - 1);  // The bucket may cross a cache line
     }
 
     inline bool DeleteTagFromBucket(const int64 i, const uint32 tag) {
-        for (int64 j = 0; j < tags_per_bucket_; j++) {
+        for (int64 j = 0; j < kTagsPerBucket; j++) {
             if (ReadTag(i, j) == tag) {
                 CHECK(FindTagInBucket(i, tag));
                 WriteTag(i, j, 0);
@@ -212,14 +280,14 @@ class SingleTable {
 
     inline bool InsertTagToBucket(const int64 i,  const uint32 tag,
                                   const bool kickout, uint32& oldtag) {
-        for (int64 j = 0; j < tags_per_bucket_; j++) {
+        for (int64 j = 0; j < kTagsPerBucket; j++) {
             if (ReadTag(i, j) == 0) {
                 WriteTag(i, j, tag);
                 return true;
             }
         }
         if (kickout) {
-            int64 r = rand_gen_() % tags_per_bucket_;
+            int64 r = rand_gen_() % kTagsPerBucket;
             oldtag = ReadTag(i, r);
             WriteTag(i, r, tag);
         }
@@ -228,7 +296,7 @@ class SingleTable {
 
     inline int64 NumTagsInBucket(const int64 i) {
         int64 num = 0;
-        for (int64 j = 0; j < tags_per_bucket_; j++) {
+        for (int64 j = 0; j < kTagsPerBucket; j++) {
             if (ReadTag(i, j) != 0)
                 ++num;
         }
@@ -236,12 +304,24 @@ class SingleTable {
     }
 
   private:
+    static const uint32 kTagMask = (1ULL << bits_per_tag) - 1;
+
+    // Unaligned little-endian load.
+    template <class T>
+    static inline T Load(const uint8* p) {
+        T value;
+        memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    // The bucket at 'p', zero-extended, for 4 and 8-byte buckets.
+    static inline uint64 LoadBucket(const uint8* p) {
+        return kBytesPerBucket == 4 ? Load<uint32>(p) : Load<uint64>(p);
+    }
+
     const int64 num_buckets_;
-    const int64 tags_per_bucket_;
-    const int64 bytes_per_bucket_;
-    const int bits_per_tag_;
-    const uint32 tag_mask_;
     uint8* data_;
+    const bool owns_data_;
     std::mt19937_64 rand_gen_;
 };
 
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 
+#include "cpp-base/hash/hash.h"
 #include "cpp-base/integral_types.h"
 
 namespace cpp_base {
@@ -65,6 +66,31 @@ inline uint64_t upperpower2(uint64_t x) {
     return x;
 }
 
+// Cuckoo hashing utilities, shared by the cuckoo filters so they place keys alike.
+
+// Bucket indices are taken from 32 bits of hash, so a table has at most this many buckets.
+const int64 kMaxCuckooBuckets = 1LL << 32;
+
+// The bucket index of the given key in a table of 'num_buckets' buckets, a power of 2 up to
+// kMaxCuckooBuckets, and its tag of 'bits_per_tag' bits, never 0, which marks an empty slot.
+inline void CuckooIndexAndTag(uint64 key, int64 num_buckets, int bits_per_tag, int64* index,
+                              uint32* tag) {
+    // A re-hash is necessary:
+    uint64 h = Hash64NumWithSeed(key, 0xa5b85c5e198ed849ULL /*some big prime number*/);
+    *index = static_cast<uint32>(h >> 32) % num_buckets;
+    *tag = static_cast<uint32>(h) & ((1ULL << bits_per_tag) - 1);
+    *tag += (*tag == 0);
+}
+
+// The other bucket a tag in the given bucket may be in; CuckooAltIndex() of that is 'index'.
+inline int64 CuckooAltIndex(int64 index, uint32 tag, int64 num_buckets) {
+    // NOTE(binfan): originally we use:
+    // index ^ HashUtil::BobHash((const void*) (&tag), 4)) & table_->INDEXMASK;
+    // now doing a quick-n-dirty way:
+    // 0x5bd1e995 is the hash constant from MurmurHash2
+    return static_cast<uint32>(index ^ (tag * 0x5bd1e995)) % num_buckets;
+}
+
 // Print utilities.
 
 inline std::string bytes_to_hex(const char* data, size_t len) {
@@ -0,0 +1,212 @@
+#ifndef CPP_BASE_DATA_STRUCT_EXPIRING_LRU_MAP_H_
+#define CPP_BASE_DATA_STRUCT_EXPIRING_LRU_MAP_H_
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "cpp-base/data-struct/lru_map.h"
+#include "cpp-base/macros.h"
+#include "cpp-base/management/exported_stat.h"
+#include "cpp-base/util/clock.h"
+
+namespace cpp_base {
+
+// The Policy of ExpiringLruMap: each entry has a deadline, if it expires, and
+// a weight, if the map is bounded by weight. See LruPlainPolicy for the hooks.
+template <class KeyType, class ValueType>
+class LruExpiringPolicy {
+  public:
+    // Returns the weight of an entry; must be non-negative.
+    typedef std::function<int64(const KeyType&, const ValueType&)> Weigher;
+    typedef std::multimap<double /*deadline*/, KeyType> ExpiryType;
+
+    struct EntryData {
+        typename ExpiryType::iterator expiry_it;  // expiries_.end() if it never expires
+        int64 weight;                             // 0 if there is no weigher
+    };
+
+    LruExpiringPolicy() {}
+    ~LruExpiringPolicy() {}
+
+    double DefaultDeadline() const { return NewDeadline(default_ttl_); }
+    // When an entry put now with the given ttl expires; 0 means never.
+    double NewDeadline(double ttl) const {
+        if (ttl <= 0)
+            return 0;
+        CHECK(clock_ != nullptr) << "A time-to-live requires a Clock";
+        return clock_->Now() + ttl;
+    }
+    bool IsExpired(const EntryData& data) const {
+        return data.expiry_it != expiries_.end() && HasPassed(data.expiry_it->first);
+    }
+    // Without a clock, deadlines read from a snapshot are ignored.
+    bool HasPassed(double deadline) const {
+        return clock_ != nullptr && deadline <= clock_->Now();
+    }
+    const KeyType* EarliestExpired() const {
+        if (expiries_.empty() || !HasPassed(expiries_.begin()->first))
+            return nullptr;
+        return &expiries_.begin()->second;
+    }
+    bool HasDeadlines() const { return !expiries_.empty(); }
+    double Deadline(const EntryData& data) const {
+        return data.expiry_it == expiries_.end() ? 0 : data.expiry_it->first;
+    }
+
+    int64 Weigh(const KeyType& key, const ValueType& value) const {
+        if (!weigher_)
+            return 0;
+        const int64 weight = weigher_(key, value);
+        CHECK_GE(weight, 0);
+        return weight;
+    }
+    int64 TotalWeight() const { return total_weight_.load(std::memory_order_relaxed); }
+    int64 MaxWeight() const { return max_weight_; }
+    void OnRejected() { ++num_rejected_; }
+
+    void OnInsert(const KeyType& key, double deadline, int64 weight, EntryData* data) {
+        data->expiry_it = deadline > 0 && clock_ != nullptr
+                                  ? expiries_.insert(std::make_pair(deadline, key))
+                                  : expiries_.end();
+        data->weight = weight;
+        AddWeight(weight);
+    }
+
+    void OnRemove(EntryData* data) {
+        if (data->expiry_it != expiries_.end())
+            expiries_.erase(data->expiry_it);
+        AddWeight(-data->weight);
+    }
+
+    void Clear() {
+        expiries_.clear();
+        total_weight_.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    template <class K, class V> friend class ExpiringLruMap;
+
+    // Only the map's thread writes total_weight_, so no read-modify-write is
+    // needed.
+    void AddWeight(int64 delta) {
+        if (delta != 0)
+            total_weight_.store(TotalWeight() + delta, std::memory_order_relaxed);
+    }
+
+    Clock* clock_ = nullptr;     // Not owned; nullptr if entries never expire
+    double default_ttl_ = 0;     // In seconds; <= 0 means no expiry
+    ExpiryType expiries_;        // Only of the entries that expire
+    Weigher weigher_;            // Empty if only the number of entries is bounded
+    int64 max_weight_ = std::numeric_limits<int64>::max();
+    std::atomic<int64> total_weight_{0};  // Atomic, as it may be exported
+    int64 num_rejected_ = 0;     // Entries heavier than max_weight_ on their own
+
+    DISALLOW_COPY_AND_ASSIGN(LruExpiringPolicy);
+};
+
+// An LruMap whose entries also expire a time-to-live after they were Put(),
+// as told by a given Clock, and which can also be bounded by the total weight
+// of its entries, e.g., bytes, as told by a given weigher callback: see
+// SetWeigher(). Each entry takes 16 bytes more than in an LruMap for these.
+//
+// Expired entries are treated as absent by all lookups, and are reclaimed
+// lazily: by a lookup that finds one, by Put() in preference to evicting a
+// live entry, and by ExpireEntries(), which is meant to be called
+// periodically and costs O(expired) -- entries are also indexed by deadline.
+// Size() counts the expired entries that are not reclaimed yet. Touching an
+// entry does not extend its time-to-live.
+//
+// With a weigher, each Put() evicts entries (expired ones first, then from the
+// LRU end) until the new entry fits, and an entry heavier than MaxWeight() on
+// its own is not inserted: the key's existing entry, if any, is removed, and
+// false is returned.
+// This class is *not* thread safe; concurrency must be provided externally.
+template <class KeyType, class ValueType>
+class ExpiringLruMap : public LruMap<KeyType, ValueType, LruExpiringPolicy<KeyType, ValueType>> {
+  private:
+    typedef LruMap<KeyType, ValueType, LruExpiringPolicy<KeyType, ValueType>> Base;
+
+  public:
+    typedef typename LruExpiringPolicy<KeyType, ValueType>::Weigher Weigher;
+
+    // Entries put by Put() expire 'default_ttl' seconds later by 'clock'
+    // (never, if default_ttl <= 0); see also PutWithTtl(). Does not take
+    // ownership of 'clock', which must outlive this map. Without a clock, for
+    // a map bounded by weight only, entries never expire.
+    explicit ExpiringLruMap(int64 capacity, Clock* clock = nullptr, double default_ttl = 0)
+            : Base(capacity) {
+        CHECK(clock != nullptr || default_ttl <= 0);
+        this->policy_.clock_ = clock;
+        this->policy_.default_ttl_ = default_ttl;
+    }
+    ~ExpiringLruMap() {}
+
+    // Bounds the total weight of the entries, in addition to their number.
+    // Use this setter only at initialization time, on an empty map.
+    void SetWeigher(Weigher weigher, int64 max_weight) {
+        CHECK(this->Empty());
+        CHECK(weigher);
+        CHECK_GE(max_weight, 0);
+        this->policy_.weigher_ = weigher;
+        this->policy_.max_weight_ = max_weight;
+    }
+
+    // Exports TotalWeight() as a stat of the given name via GlobalExporter,
+    // until this map is destroyed.
+    void ExportWeight(const std::string& name) {
+        weight_export_.reset(new ExportedStatCallback<int64>(
+                name, [this]() { return TotalWeight(); }));
+    }
+
+    int64 TotalWeight() const { return this->policy_.TotalWeight(); }
+    int64 MaxWeight() const { return this->policy_.MaxWeight(); }
+    // Number of Put()s rejected for the entry outweighing MaxWeight().
+    int64 NumRejected() const { return this->policy_.num_rejected_; }
+
+    // Same as Put(), but the entry expires 'ttl' seconds from now (never, if
+    // ttl <= 0).
+    bool PutWithTtl(const KeyType& key,
+                    const ValueType& value,
+                    double ttl,
+                    ValueType* evicted_value = nullptr) {
+        return this->PutWithDeadline(key, value, this->policy_.NewDeadline(ttl), evicted_value);
+    }
+
+    // Removes up to 'max_entries' expired entries, earliest deadline first.
+    // Returns the number removed. Costs O(removed); live entries are not
+    // visited. The value of the last one removed is filled in 'value', if
+    // non-null.
+    using Base::ExpireEntries;
+
+    // Number of entries that have a deadline, expired or not.
+    size_t NumExpiring() const { return this->policy_.expiries_.size(); }
+
+    // An intensive check for internal consistency. Do not call frequently.
+    void CheckInternalCorrectness() const {
+        Base::CheckInternalCorrectness();
+        const LruExpiringPolicy<KeyType, ValueType>& policy = this->policy_;
+        int64 total_weight = 0;
+        for (const auto& p : this->list_) {
+            if (p.expiry_it != policy.expiries_.end())
+                CHECK(p.expiry_it->second == p.first);
+            total_weight += p.weight;
+        }
+        CHECK_LE(policy.expiries_.size(), this->map_.size());
+        CHECK_EQ(total_weight, TotalWeight());
+        CHECK_LE(total_weight, MaxWeight());
+    }
+
+  private:
+    std::unique_ptr<ExportedStatCallback<int64>> weight_export_;
+
+    DISALLOW_COPY_AND_ASSIGN(ExpiringLruMap);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_EXPIRING_LRU_MAP_H_
@@ -0,0 +1,353 @@
+#ifndef CPP_BASE_DATA_STRUCT_FLAT_LRU_MAP_H_
+#define CPP_BASE_DATA_STRUCT_FLAT_LRU_MAP_H_
+
+#include <glog/logging.h>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "cpp-base/hash/hash.h"
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+
+namespace cpp_base {
+
+// Same API and semantics as LruMap, with a compact memory layout:
+//  - All entries live in one slab (a vector), doubly linked in LRU order by
+//    32-bit slab indices rather than pointers. Freed slots are reused.
+//  - The hash index is an open-addressing (linear probing) table of 32-bit
+//    slab indices, plus a parallel array of one-byte hash tags. A probe only
+//    touches the slab when the tag matches, so a miss typically scans a few
+//    adjacent bytes and never leaves the index.
+// The per-entry overhead is 8 bytes in the slab plus ~7 bytes in the index,
+// compared to ~80 bytes for LruMap's list and hash_map nodes. The cost is that
+// at most 2^32 - 2 entries are supported, and entries move in memory (don't
+// keep pointers to values across calls).
+// This class is *not* thread safe; concurrency must be provided externally.
+template <class KeyType, class ValueType>
+class FlatLruMap {
+  public:
+    FlatLruMap() : FlatLruMap(kMaxCapacity) {}
+    explicit FlatLruMap(int64 capacity) : capacity_(capacity) {
+        CHECK_GT(capacity, 0);
+        CHECK_LE(capacity, kMaxCapacity);
+        Rehash(kMinIndexSize);
+    }
+    ~FlatLruMap() {}
+
+    // Use this setter only at initialization time. Do not use when the map is full.
+    void SetCapacity(int64 capacity) {
+        CHECK_GT(capacity, 0);
+        CHECK_LE(capacity, kMaxCapacity);
+        capacity_ = capacity;
+    }
+
+    bool Empty() const { return size_ == 0; }
+    size_t Size() const { return size_; }
+    bool Contains(const KeyType& key) const { return Find(key) != kNil; }
+
+    void Clear() {
+        slab_.clear();
+        free_head_ = head_ = tail_ = kNil;
+        size_ = 0;
+        Rehash(kMinIndexSize);
+    }
+
+    // Returns false iff map is empty.
+    bool OldestKey(KeyType* key) const {
+        if (tail_ == kNil)
+            return false;
+        *key = slab_[tail_].key;
+        return true;
+    }
+
+    // Returns false iff map is empty.
+    bool OldestValue(ValueType* value) const {
+        if (tail_ == kNil)
+            return false;
+        *value = slab_[tail_].value;
+        return true;
+    }
+
+    // Insert the given key and value. If the key existed, it is reinserted at
+    // list head. Returns whether the key already existed.
+    bool Put(const KeyType& key,
+             const ValueType& value,
+             ValueType* evicted_value = nullptr) {
+        uint32 e = Find(key);
+        if (e != kNil) {
+            slab_[e].value = value;
+            MoveToHead(e);
+            return true;
+        }
+        CHECK_LE(size_, capacity_);
+        if (size_ == capacity_)
+            CHECK(EvictOldest(evicted_value));
+        if ((size_ + 1) * kMaxLoadDenominator > index_.size() * kMaxLoadNumerator)
+            Rehash(index_.size() * 2);
+
+        // Take a slab slot, from the free list if possible.
+        if (free_head_ != kNil) {
+            e = free_head_;
+            free_head_ = slab_[e].next;
+        } else {
+            e = slab_.size();
+            slab_.emplace_back();
+        }
+        Entry& entry = slab_[e];
+        entry.key = key;
+        entry.value = value;
+        LinkAtHead(e);
+        ++size_;
+
+        uint64 h = HashOf(key);
+        size_t slot = h & index_mask_;
+        while (tags_[slot] != 0)
+            slot = (slot + 1) & index_mask_;
+        index_[slot] = e;
+        tags_[slot] = TagOf(h);
+        return false;
+    }
+
+    // Gets the value mapped for the given key. Does not reinsert the key at
+    // list head. 'value' cannot be nullptr.
+    bool GetWithoutTouch(const KeyType& key, ValueType* value) const {
+        uint32 e = Find(key);
+        if (e == kNil)
+            return false;
+        *value = slab_[e].value;
+        return true;
+    }
+
+    // Returns whether the map contains 'key'. If so, it is re-inserted at list
+    // head and optionally the mapped value is copied to 'value', if a non-null
+    // pointer is given. If the key does not exist in the map, it is *not*
+    // inserted.
+    bool GetWithTouch(const KeyType& key, ValueType* value /*can be nullptr*/) {
+        uint32 e = Find(key);
+        if (e == kNil)
+            return false;
+        if (value != nullptr)
+            *value = slab_[e].value;
+        MoveToHead(e);
+        return true;
+    }
+
+    bool Touch(const KeyType& key) { return GetWithTouch(key, nullptr); }
+
+    // Removes the given key. Returns whether it existed. The mapped value is
+    // filled in 'value', if non-null.
+    bool Erase(const KeyType& key, ValueType* value = nullptr) {
+        uint64 h = HashOf(key);
+        size_t slot = FindSlot(key, h);
+        if (slot == kNoSlot)
+            return false;
+        uint32 e = index_[slot];
+        if (value != nullptr)
+            *value = slab_[e].value;
+        RemoveFromIndex(slot);
+        FreeEntry(e);
+        return true;
+    }
+
+    // Removes the oldest entry. Returns whether one existed. The mapped value
+    // is filled in 'value', if non-null.
+    bool EvictOldest(ValueType* value /*can be nullptr*/) {
+        if (tail_ == kNil)
+            return false;
+        uint32 e = tail_;
+        if (value != nullptr)
+            *value = slab_[e].value;
+        size_t slot = FindSlot(slab_[e].key, HashOf(slab_[e].key));
+        CHECK_NE(slot, kNoSlot);  // Must have existed
+        RemoveFromIndex(slot);
+        FreeEntry(e);
+        return true;
+    }
+
+    // Returns the full contents of this map with the oldest item being at
+    // index 0. This is an expensive call and should normally not be used
+    // except for testing.
+    std::vector<std::pair<KeyType, ValueType>> RawList() const {
+        std::vector<std::pair<KeyType, ValueType>> res;
+        res.reserve(size_);
+        for (uint32 e = tail_; e != kNil; e = slab_[e].prev)
+            res.emplace_back(slab_[e].key, slab_[e].value);
+        return res;
+    }
+
+    // Bytes used by the slab and the index, excluding whatever the keys and
+    // values allocate on the heap themselves.
+    int64 MemoryBytes() const {
+        return slab_.capacity() * sizeof(Entry) +
+               index_.capacity() * sizeof(uint32) + tags_.capacity() * sizeof(uint8);
+    }
+
+    // An intensive check for internal consistency. Do not call frequently.
+    void CheckInternalCorrectness() const {
+        size_t n = 0;
+        uint32 prev = kNil;
+        for (uint32 e = head_; e != kNil; e = slab_[e].next) {
+            CHECK_EQ(slab_[e].prev, prev);
+            CHECK_EQ(Find(slab_[e].key), e);
+            prev = e;
+            ++n;
+        }
+        CHECK_EQ(prev, tail_);
+        CHECK_EQ(n, size_);
+        size_t num_indexed = 0;
+        for (size_t slot = 0; slot < index_.size(); ++slot) {
+            if (index_[slot] != kNil) {
+                ++num_indexed;
+                CHECK_EQ(tags_[slot], TagOf(HashOf(slab_[index_[slot]].key)));
+            }
+        }
+        CHECK_EQ(num_indexed, size_);
+        size_t num_free = 0;
+        for (uint32 e = free_head_; e != kNil; e = slab_[e].next)
+            ++num_free;
+        CHECK_EQ(num_free + size_, slab_.size());
+    }
+
+  private:
+    static const uint32 kNil = std::numeric_limits<uint32>::max();
+    static const size_t kNoSlot = std::numeric_limits<size_t>::max();
+    static const int64 kMaxCapacity = std::numeric_limits<uint32>::max() - 1;
+    static const size_t kMinIndexSize = 16;
+    // Max load factor of the index: 3/4.
+    static const size_t kMaxLoadNumerator = 3;
+    static const size_t kMaxLoadDenominator = 4;
+
+    struct Entry {
+        KeyType key;
+        ValueType value;
+        uint32 prev;  // Towards the head (more recent); kNil at the head
+        uint32 next;  // Towards the tail (older); kNil at the tail. Free list link too.
+    };
+
+    static uint64 HashOf(const KeyType& key) {
+        // Re-mix, since hash<> is the identity for integers. A multiply and a
+        // fold is plenty for linear probing and is on the critical path of
+        // every probe, so it beats the costlier Hash64NumWithSeed() here.
+        uint64 h = hash<KeyType>()(key) * 0x9e3779b97f4a7c15ULL;
+        return h ^ (h >> 32);
+    }
+
+    // High bits of the hash, since the low ones pick the slot. Never 0.
+    static uint8 TagOf(uint64 h) { return 0x80 | (h >> 57); }
+
+    // Returns the index slot holding 'key', or kNoSlot.
+    size_t FindSlot(const KeyType& key, uint64 h) const {
+        const uint8 tag = TagOf(h);
+        // Scan the tags only, so that a miss rarely touches index_ or slab_.
+        for (size_t slot = h & index_mask_; tags_[slot] != 0; slot = (slot + 1) & index_mask_) {
+            if (tags_[slot] == tag && slab_[index_[slot]].key == key)
+                return slot;
+        }
+        return kNoSlot;
+    }
+
+    // Returns the slab index of 'key', or kNil.
+    uint32 Find(const KeyType& key) const {
+        size_t slot = FindSlot(key, HashOf(key));
+        return slot == kNoSlot ? kNil : index_[slot];
+    }
+
+    // Removes the index slot by shifting back the rest of its probe run, so
+    // no tombstones are needed and probe runs stay short.
+    void RemoveFromIndex(size_t hole) {
+        size_t slot = hole;
+        while (true) {
+            slot = (slot + 1) & index_mask_;
+            if (tags_[slot] == 0)
+                break;
+            size_t home = HashOf(slab_[index_[slot]].key) & index_mask_;
+            // Move the entry into the hole unless its home lies cyclically in (hole, slot].
+            bool home_in_between = hole <= slot ? (hole < home && home <= slot)
+                                                : (hole < home || home <= slot);
+            if (!home_in_between) {
+                index_[hole] = index_[slot];
+                tags_[hole] = tags_[slot];
+                hole = slot;
+            }
+        }
+        index_[hole] = kNil;
+        tags_[hole] = 0;
+    }
+
+    void Rehash(size_t new_size) {
+        index_.assign(new_size, kNil);
+        tags_.assign(new_size, 0);
+        index_mask_ = new_size - 1;
+        for (uint32 e = head_; e != kNil; e = slab_[e].next) {
+            uint64 h = HashOf(slab_[e].key);
+            size_t slot = h & index_mask_;
+            while (index_[slot] != kNil)
+                slot = (slot + 1) & index_mask_;
+            index_[slot] = e;
+            tags_[slot] = TagOf(h);
+        }
+    }
+
+    void LinkAtHead(uint32 e) {
+        slab_[e].prev = kNil;
+        slab_[e].next = head_;
+        if (head_ != kNil)
+            slab_[head_].prev = e;
+        head_ = e;
+        if (tail_ == kNil)
+            tail_ = e;
+    }
+
+    void Unlink(uint32 e) {
+        const Entry& entry = slab_[e];
+        if (entry.prev != kNil)
+            slab_[entry.prev].next = entry.next;
+        else
+            head_ = entry.next;
+        if (entry.next != kNil)
+            slab_[entry.next].prev = entry.prev;
+        else
+            tail_ = entry.prev;
+    }
+
+    void MoveToHead(uint32 e) {
+        if (e == head_)
+            return;
+        Unlink(e);
+        LinkAtHead(e);
+    }
+
+    void FreeEntry(uint32 e) {
+        Unlink(e);
+        // Release whatever the key and value hold on the heap.
+        slab_[e].key = KeyType();
+        slab_[e].value = ValueType();
+        slab_[e].next = free_head_;
+        free_head_ = e;
+        --size_;
+    }
+
+    int64 capacity_;
+    std::vector<Entry> slab_;
+    std::vector<uint32> index_;   // Slab indices; kNil means empty
+    std::vector<uint8> tags_;     // Hash tag per index slot; 0 means empty
+    size_t index_mask_ = 0;
+    uint32 head_ = kNil;          // Most recently used
+    uint32 tail_ = kNil;          // Least recently used
+    uint32 free_head_ = kNil;     // Free list of slab slots, linked by 'next'
+    size_t size_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(FlatLruMap);
+};
+
+template <class KeyType, class ValueType>
+const uint32 FlatLruMap<KeyType, ValueType>::kNil;
+template <class KeyType, class ValueType>
+const size_t FlatLruMap<KeyType, ValueType>::kNoSlot;
+template <class KeyType, class ValueType>
+const int64 FlatLruMap<KeyType, ValueType>::kMaxCapacity;
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_FLAT_LRU_MAP_H_
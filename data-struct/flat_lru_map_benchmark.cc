@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include "cpp-base/data-struct/flat_lru_map.h"
+#include "cpp-base/data-struct/heap_counter_test_util.h"
+#include "cpp-base/data-struct/lru_map.h"
+#include "cpp-base/hash/hash.h"
+
+using cpp_base::FlatLruMap;
+using cpp_base::HeapAllocatedBytes;
+using cpp_base::LruMap;
+using std::vector;
+
+class FlatLruMapTest : public ::testing::Test {
+  public:
+    FlatLruMapTest() { }
+    ~FlatLruMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+TEST_F(FlatLruMapTest, Benchmark) {
+    const int kNumEntries = 1000000;
+    const int kNumLookups = 2000000;
+    typedef std::chrono::steady_clock clock;
+    int64 sum = 0;
+
+    int64 before = HeapAllocatedBytes();
+    LruMap<int64, int64> lru(kNumEntries);
+    for (int64 i = 0; i < kNumEntries; ++i)
+        lru.Put(cpp_base::Hash64NumWithSeed(i, 1) >> 1, i);
+    double lru_bytes = (HeapAllocatedBytes() - before) * 1. / kNumEntries;
+
+    before = HeapAllocatedBytes();
+    FlatLruMap<int64, int64> flat(kNumEntries);
+    for (int64 i = 0; i < kNumEntries; ++i)
+        flat.Put(cpp_base::Hash64NumWithSeed(i, 1) >> 1, i);
+    double flat_bytes = (HeapAllocatedBytes() - before) * 1. / kNumEntries;
+
+    // Random keys from the map; key + 1 is almost surely absent, which makes a miss.
+    vector<int64> keys(kNumLookups);
+    for (int64 i = 0; i < kNumLookups; ++i)
+        keys[i] = cpp_base::Hash64NumWithSeed(rand() % kNumEntries, 1) >> 1;  // NOLINT
+
+    double ns[2][2];  // [lru/flat][hit/miss]
+    for (int miss = 0; miss < 2; ++miss) {
+        auto start = clock::now();
+        for (int64 i = 0; i < kNumLookups; ++i) {
+            int64 v = 0;
+            lru.GetWithTouch(keys[i] + miss, &v);
+            sum += v;
+        }
+        ns[0][miss] = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        start = clock::now();
+        for (int64 i = 0; i < kNumLookups; ++i) {
+            int64 v = 0;
+            flat.GetWithTouch(keys[i] + miss, &v);
+            sum += v;
+        }
+        ns[1][miss] = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    }
+
+    LOG(INFO) << "LruMap<int64, int64>: " << lru_bytes << " bytes/entry, "
+              << ns[0][0] / kNumLookups << " ns/hit, " << ns[0][1] / kNumLookups << " ns/miss";
+    LOG(INFO) << "FlatLruMap<int64, int64>: " << flat_bytes << " bytes/entry, "
+              << ns[1][0] / kNumLookups << " ns/hit, " << ns[1][1] / kNumLookups << " ns/miss"
+              << " (checksum " << sum << ")";
+    EXPECT_LT(flat_bytes, lru_bytes);
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "cpp-base/data-struct/flat_lru_map.h"
+#include "cpp-base/data-struct/lru_map.h"
+
+using cpp_base::FlatLruMap;
+using cpp_base::LruMap;
+using std::pair;
+using std::string;
+using std::vector;
+
+class FlatLruMapTest : public ::testing::Test {
+  public:
+    FlatLruMapTest() { }
+    ~FlatLruMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+TEST_F(FlatLruMapTest, BasicTest) {
+    FlatLruMap<string, int> m(3);
+    int x;
+    string s;
+    EXPECT_TRUE(m.Empty());
+    EXPECT_FALSE(m.Contains(""));
+    EXPECT_FALSE(m.GetWithTouch("", &x));
+    EXPECT_FALSE(m.OldestKey(&s));
+    EXPECT_FALSE(m.EvictOldest(&x));
+    m.CheckInternalCorrectness();
+
+    EXPECT_FALSE(m.Put("one", 1));
+    EXPECT_FALSE(m.Put("two", 2));
+    EXPECT_FALSE(m.Put("three", 3));
+    EXPECT_TRUE(m.Touch("one"));
+    EXPECT_FALSE(m.Put("four", 4, &x));  // Evicts two
+    EXPECT_EQ(2, x);
+    EXPECT_EQ(3, m.Size());
+    EXPECT_EQ((vector<pair<string, int>>{{"three", 3}, {"one", 1}, {"four", 4}}), m.RawList());
+    EXPECT_TRUE(m.OldestKey(&s));
+    EXPECT_EQ("three", s);
+    EXPECT_TRUE(m.GetWithoutTouch("three", &x));
+    EXPECT_EQ(3, x);
+    EXPECT_TRUE(m.Erase("one", &x));
+    EXPECT_EQ(1, x);
+    EXPECT_FALSE(m.Erase("one"));
+    EXPECT_EQ((vector<pair<string, int>>{{"three", 3}, {"four", 4}}), m.RawList());
+    m.CheckInternalCorrectness();
+
+    m.Clear();
+    EXPECT_TRUE(m.Empty());
+    m.CheckInternalCorrectness();
+}
+
+TEST_F(FlatLruMapTest, SameBehaviorAsLruMap) {
+    LruMap<int, int> m1(500);
+    FlatLruMap<int, int> m2(500);
+    srand(1);
+    for (int i = 0; i < 200000; ++i) {
+        int key = rand() % 2000;  // NOLINT
+        int v1 = -1, v2 = -1;
+        switch (rand() % 4) {  // NOLINT
+            case 0:
+                EXPECT_EQ(m1.Put(key, i, &v1), m2.Put(key, i, &v2));
+                EXPECT_EQ(v1, v2);
+                break;
+            case 1:
+                EXPECT_EQ(m1.GetWithTouch(key, &v1), m2.GetWithTouch(key, &v2));
+                EXPECT_EQ(v1, v2);
+                break;
+            case 2:
+                EXPECT_EQ(m1.Erase(key, &v1), m2.Erase(key, &v2));
+                EXPECT_EQ(v1, v2);
+                break;
+            case 3:
+                EXPECT_EQ(m1.EvictOldest(&v1), m2.EvictOldest(&v2));
+                EXPECT_EQ(v1, v2);
+                break;
+        }
+        ASSERT_EQ(m1.Size(), m2.Size());
+        if (i % 10000 == 0) {
+            EXPECT_EQ(m1.RawList(), m2.RawList());
+            m2.CheckInternalCorrectness();
+        }
+    }
+    EXPECT_EQ(m1.RawList(), m2.RawList());
+    m2.CheckInternalCorrectness();
+}
@@ -0,0 +1,266 @@
+#include "cpp-base/data-struct/fuse-filter/binary_fuse_filter.h"
+
+#include <glog/logging.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "cpp-base/file/header_page_file.h"
+#include "cpp-base/thread/parallel.h"
+
+namespace cpp_base {
+
+namespace {
+
+const uint32 kFileMagic = 0x53554642;  // "BFUS"
+const uint32 kFileVersion = 1;
+
+// The slots follow a header page; see header_page_file.h.
+struct FileHeader {
+    uint32 magic;
+    uint32 version;
+    int64 num_elements;
+    uint64 seed;
+    int64 segment_length;
+    int64 segment_count;
+};
+
+static_assert(sizeof(FileHeader) <= kHeaderPageSize, "FileHeader does not fit its page");
+
+}  // namespace
+
+BinaryFuseFilter::BinaryFuseFilter(const uint64* keys, int64 num_keys, ThreadPool* pool,
+                                   int num_tasks) {
+    CHECK_GE(num_keys, 0);
+    CHECK_GT(num_tasks, 0);
+    std::unique_ptr<uint64[]> hashes(new uint64[std::max<int64>(num_keys, 1)]);
+    std::mt19937_64 rand_gen(1000);
+    for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+        seed_ = rand_gen();
+        const int64 num_hashes = HashKeys(keys, num_keys, pool, num_tasks, hashes.get());
+        if (fingerprints_ == nullptr) {
+            SetSizes(num_hashes);
+            fingerprints_ = new uint8[array_length_];
+        }
+        if (TryBuild(hashes.get(), num_hashes, pool, num_tasks)) {
+            num_elements_ = num_hashes;
+            return;
+        }
+        VLOG(1) << "Binary fuse filter of " << num_hashes << " keys failed with seed " << seed_;
+    }
+    LOG(FATAL) << "Cannot build a binary fuse filter of " << num_keys << " keys";
+}
+
+BinaryFuseFilter::BinaryFuseFilter(int64 num_elements, uint64 seed, int64 segment_length,
+                                   int64 segment_count, uint8* fingerprints, int64 mapping_size)
+        : num_elements_(num_elements),
+          seed_(seed),
+          segment_length_(segment_length),
+          segment_count_(segment_count),
+          array_length_((segment_count + 2) * segment_length),
+          fingerprints_(fingerprints),
+          mapping_size_(mapping_size) {
+}
+
+BinaryFuseFilter::~BinaryFuseFilter() {
+    if (IsReadOnly())
+        UnmapHeaderPageFile(fingerprints_ - kHeaderPageSize, mapping_size_);
+    else
+        delete[] fingerprints_;
+}
+
+void BinaryFuseFilter::SetSizes(int64 num_keys) {
+    // As in the paper, for 3 slots per key: segments of a size that grows with the number of keys
+    // up to 2^18, and about 12.5% more slots than keys for a million keys or more, more below.
+    const int kMaxSegmentLengthLog = 18;
+    const int segment_length_log = num_keys <= 1 ? 2 :
+            std::log(num_keys) / std::log(3.33) + 2.25;
+    segment_length_ = 1LL << std::min(segment_length_log, kMaxSegmentLengthLog);
+    const double size_factor = num_keys <= 1 ? 0 :
+            std::max(1.125, 0.875 + 0.25 * std::log(1e6) / std::log(num_keys));
+    const int64 capacity = std::llround(num_keys * size_factor);
+    segment_count_ = std::max<int64>(1, (capacity + segment_length_ - 1) / segment_length_ - 2);
+    array_length_ = (segment_count_ + 2) * segment_length_;
+}
+
+int64 BinaryFuseFilter::HashKeys(const uint64* keys, int64 num_keys, ThreadPool* pool,
+                                 int num_tasks, uint64* hashes) const {
+    // Each task hashes its share of the keys and buckets the hashes by region of the hash space;
+    // then each task sorts and dedupes the hashes of one region, in place in 'hashes'.
+    // buckets[t * num_tasks + r] has the hashes in region r of the keys of task t.
+    std::vector<std::vector<uint64>> buckets(num_tasks * num_tasks);
+    const int64 keys_per_task = (num_keys - 1) / num_tasks + 1;
+    RunInParallel(pool, num_tasks, [&](int t) {
+        std::vector<uint64>* task_buckets = &buckets[t * num_tasks];
+        const int64 end = std::min(num_keys, (t + 1) * keys_per_task);
+        for (int64 i = t * keys_per_task; i < end; ++i) {
+            const uint64 hash = Hash(keys[i]);
+            task_buckets[(static_cast<unsigned __int128>(hash) * num_tasks) >> 64].push_back(hash);
+        }
+    });
+
+    std::vector<int64> region_starts(num_tasks + 1, 0);
+    for (int r = 0; r < num_tasks; ++r) {
+        region_starts[r + 1] = region_starts[r];
+        for (int t = 0; t < num_tasks; ++t)
+            region_starts[r + 1] += buckets[t * num_tasks + r].size();
+    }
+    std::vector<int64> region_sizes(num_tasks);
+    RunInParallel(pool, num_tasks, [&](int r) {
+        uint64* begin = hashes + region_starts[r];
+        uint64* end = begin;
+        for (int t = 0; t < num_tasks; ++t) {
+            std::vector<uint64>* bucket = &buckets[t * num_tasks + r];
+            end = std::copy(bucket->begin(), bucket->end(), end);
+            std::vector<uint64>().swap(*bucket);
+        }
+        std::sort(begin, end);
+        region_sizes[r] = std::unique(begin, end) - begin;
+    });
+
+    // Close the gaps left by duplicates.
+    int64 num_hashes = region_sizes[0];
+    for (int r = 1; r < num_tasks; ++r) {
+        memmove(hashes + num_hashes, hashes + region_starts[r], region_sizes[r] * sizeof(uint64));
+        num_hashes += region_sizes[r];
+    }
+    return num_hashes;
+}
+
+bool BinaryFuseFilter::TryBuild(uint64* hashes, int64 num_hashes, ThreadPool* pool,
+                                int num_tasks) {
+    // For each slot, the number of hashes on it times 4, XOR the indices (0, 1 or 2) of that slot
+    // among the three of each hash; and the XOR of those hashes. So a slot with a single hash
+    // tells which hash, and which of its slots.
+    std::vector<uint8> counts(array_length_, 0);
+    std::vector<uint64> xors(array_length_, 0);
+
+    // The slots of a hash span three segments from that of its first slot, which grows with the
+    // hash. So the sorted hashes are counted in chunks of at least two segments of first slots,
+    // the even chunks in parallel, then the odd ones, which never write to the same slots.
+    const int64 segments_per_chunk = std::max<int64>(2, (segment_count_ - 1) / (2 * num_tasks) + 1);
+    const int num_chunks = (segment_count_ - 1) / segments_per_chunk + 1;
+    std::vector<int64> chunk_starts(num_chunks + 1, num_hashes);
+    for (int c = 0; c < num_chunks; ++c) {
+        const int64 first_slot = c * segments_per_chunk * segment_length_;
+        chunk_starts[c] = std::lower_bound(hashes, hashes + num_hashes, first_slot,
+                                           [this](uint64 hash, int64 slot) {
+                                               int64 positions[3];
+                                               GetPositions(hash, positions);
+                                               return positions[0] < slot;
+                                           }) - hashes;
+    }
+    std::vector<char> overflows(num_chunks, false);
+    for (int parity = 0; parity < 2; ++parity) {
+        RunInParallel(pool, (num_chunks - parity + 1) / 2, [&](int i) {
+            const int c = 2 * i + parity;
+            for (int64 k = chunk_starts[c]; k < chunk_starts[c + 1]; ++k) {
+                int64 positions[3];
+                GetPositions(hashes[k], positions);
+                for (int j = 0; j < 3; ++j) {
+                    uint8* count = &counts[positions[j]];
+                    overflows[c] |= *count >= 252;  // 63 hashes on a slot
+                    *count = (*count + 4) ^ j;
+                    xors[positions[j]] ^= hashes[k];
+                }
+            }
+        });
+    }
+    if (std::count(overflows.begin(), overflows.end(), true) > 0)
+        return false;
+
+    // Peel the hashes off the slots they are alone on, stacking them in 'hashes' along with the
+    // index of that slot, until none is left or the rest cannot be peeled.
+    std::vector<int64> alone;
+    for (int64 i = 0; i < array_length_; ++i) {
+        if ((counts[i] >> 2) == 1)
+            alone.push_back(i);
+    }
+    std::vector<uint8> alone_indices(num_hashes);
+    int64 num_peeled = 0;
+    while (!alone.empty()) {
+        const int64 slot = alone.back();
+        alone.pop_back();
+        if ((counts[slot] >> 2) != 1)
+            continue;  // Peeled since
+        const uint64 hash = xors[slot];
+        hashes[num_peeled] = hash;
+        alone_indices[num_peeled] = counts[slot] & 3;
+        ++num_peeled;
+        int64 positions[3];
+        GetPositions(hash, positions);
+        for (int j = 0; j < 3; ++j) {
+            uint8* count = &counts[positions[j]];
+            *count = (*count - 4) ^ j;
+            xors[positions[j]] ^= hash;
+            if ((*count >> 2) == 1)
+                alone.push_back(positions[j]);
+        }
+    }
+    if (num_peeled < num_hashes)
+        return false;
+
+    // Assign the slots in reverse order: each hash gets the slot it was alone on, whose value
+    // makes the XOR of its three slots its fingerprint. The other two are assigned already, or
+    // are never assigned after.
+    memset(fingerprints_, 0, array_length_);
+    for (int64 k = num_hashes - 1; k >= 0; --k) {
+        int64 positions[3];
+        GetPositions(hashes[k], positions);
+        const int64 slot = positions[alone_indices[k]];
+        fingerprints_[slot] = 0;
+        fingerprints_[slot] = Fingerprint(hashes[k]) ^ fingerprints_[positions[0]] ^
+                              fingerprints_[positions[1]] ^ fingerprints_[positions[2]];
+    }
+    return true;
+}
+
+bool BinaryFuseFilter::SaveToFile(const std::string& path) const {
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kFileMagic;
+    header.version = kFileVersion;
+    header.num_elements = num_elements_;
+    header.seed = seed_;
+    header.segment_length = segment_length_;
+    header.segment_count = segment_count_;
+    return WriteHeaderPageFile(path, &header, sizeof(header), {{fingerprints_, array_length_}});
+}
+
+std::unique_ptr<BinaryFuseFilter> BinaryFuseFilter::OpenFile(const std::string& path) {
+    int64 mapping_size;
+    uint8* mapping = MapHeaderPageFile(path, &mapping_size);
+    if (mapping == nullptr)
+        return nullptr;
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(mapping);
+    if (header->magic != kFileMagic || header->version != kFileVersion ||
+        header->num_elements < 0 || header->segment_length <= 0 ||
+        (header->segment_length & (header->segment_length - 1)) != 0 ||
+        header->segment_count <= 0 ||
+        mapping_size != kHeaderPageSize + (header->segment_count + 2) * header->segment_length) {
+        LOG(ERROR) << path << " is not a BinaryFuseFilter file of version " << kFileVersion;
+        UnmapHeaderPageFile(mapping, mapping_size);
+        return nullptr;
+    }
+    return std::unique_ptr<BinaryFuseFilter>(new BinaryFuseFilter(
+            header->num_elements, header->seed, header->segment_length, header->segment_count,
+            mapping + kHeaderPageSize, mapping_size));
+}
+
+std::unique_ptr<BinaryFuseFilter> BinaryFuseFilter::LoadFromFile(const std::string& path) {
+    std::unique_ptr<BinaryFuseFilter> mapped = OpenFile(path);
+    if (mapped == nullptr)
+        return nullptr;
+    uint8* fingerprints = new uint8[mapped->array_length_];
+    memcpy(fingerprints, mapped->fingerprints_, mapped->array_length_);
+    return std::unique_ptr<BinaryFuseFilter>(new BinaryFuseFilter(
+            mapped->num_elements_, mapped->seed_, mapped->segment_length_, mapped->segment_count_,
+            fingerprints, 0));
+}
+
+std::unique_ptr<BinaryFuseFilter> BinaryFuseFilter::MapFromFile(const std::string& path) {
+    return OpenFile(path);
+}
+
+}  // namespace cpp_base
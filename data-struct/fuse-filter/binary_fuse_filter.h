@@ -0,0 +1,121 @@
+#ifndef CPP_BASE_DATA_STRUCT_FUSE_FILTER_BINARY_FUSE_FILTER_H_
+#define CPP_BASE_DATA_STRUCT_FUSE_FILTER_BINARY_FUSE_FILTER_H_
+
+#include <memory>
+#include <string>
+
+#include "cpp-base/hash/hash.h"
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+
+namespace cpp_base {
+
+class ThreadPool;
+
+// A static approximate set: built once from a complete set of keys, then only looked up. See
+// Graf & Lemire, "Binary Fuse Filters: Fast and Smaller Than Xor Filters", 2022.
+//
+// Each key hashes to three 8-bit slots in three consecutive segments of an array, whose XOR is
+// its fingerprint; building the filter solves for the slot values. Lookups take exactly three
+// memory accesses, and the false positive rate is 1/256 (0.4%) with about 9 bits per key for a
+// million keys or more (a few more bits per key below). For the same rate, a BloomFilter takes
+// about 11.5 bits per key and 8 accesses, and a CuckooFilter, which allows deletions, about 12.
+//
+// Keys cannot be added once built. The filter can be saved to a file, then loaded or mapped from
+// it with zero copy. Lookups are thread-safe.
+class BinaryFuseFilter {
+  public:
+    // Builds the filter of the given keys, which may have duplicates. If 'pool' is given, whose
+    // workers must be started, the keys are hashed, sorted and counted into the slots by
+    // 'num_tasks' tasks on it, in disjoint parts of the array; the final peeling and assignment
+    // of the slots are sequential. The result is the same in either case.
+    BinaryFuseFilter(const uint64* keys, int64 num_keys, ThreadPool* pool = nullptr,
+                     int num_tasks = 1);
+
+    ~BinaryFuseFilter();
+
+    // Returns whether the given key exists in the filter: always true for the keys it was built
+    // from, and with probability 1/256 for others.
+    bool Contains(uint64 key) const {
+        const uint64 hash = Hash(key);
+        int64 positions[3];
+        GetPositions(hash, positions);
+        return (Fingerprint(hash) ^ fingerprints_[positions[0]] ^ fingerprints_[positions[1]] ^
+                fingerprints_[positions[2]]) == 0;
+    }
+
+    // Number of distinct keys the filter was built from.
+    int64 NumElements() const { return num_elements_; }
+    int64 SizeInBytes() const { return array_length_; }
+    const uint8* RawData() const { return fingerprints_; }
+
+    // Saves the filter to the given file: a versioned header of one page, with the sizes and hash
+    // seed, followed by the slots as is. Returns false on I/O error.
+    bool SaveToFile(const std::string& path) const;
+
+    // Loads a filter saved by SaveToFile() into memory. Returns null if the file cannot be read or
+    // is not such a filter.
+    static std::unique_ptr<BinaryFuseFilter> LoadFromFile(const std::string& path);
+
+    // Like LoadFromFile(), but maps the file read-only rather than copying it: opening is O(1)
+    // regardless of the filter size and pages are read on demand. The file must not be modified
+    // while mapped.
+    static std::unique_ptr<BinaryFuseFilter> MapFromFile(const std::string& path);
+
+    // Whether the filter is mapped from a file by MapFromFile().
+    bool IsReadOnly() const { return mapping_size_ > 0; }
+
+    // Max number of hash seeds tried before giving up building, which practically never happens.
+    static const int kMaxAttempts = 100;
+
+  private:
+    // Constructs a filter over the given slots, as read from a file, which are either allocated
+    // with new[] or, if 'mapping_size' is positive, mapped with mmap().
+    BinaryFuseFilter(int64 num_elements, uint64 seed, int64 segment_length, int64 segment_count,
+                     uint8* fingerprints, int64 mapping_size);
+
+    // Sets the segment length and count and the array length for the given number of keys.
+    void SetSizes(int64 num_keys);
+
+    // Sets 'hashes' to the sorted distinct hashes of the given keys with the current seed.
+    // Returns their number.
+    int64 HashKeys(const uint64* keys, int64 num_keys, ThreadPool* pool, int num_tasks,
+                   uint64* hashes) const;
+
+    // Tries building the filter from the given sorted distinct hashes, which it overwrites.
+    // Returns false if the hashes cannot be peeled, for another seed to be tried.
+    bool TryBuild(uint64* hashes, int64 num_hashes, ThreadPool* pool, int num_tasks);
+
+    // Maps the given file and checks its header. Returns null on failure.
+    static std::unique_ptr<BinaryFuseFilter> OpenFile(const std::string& path);
+
+    uint64 Hash(uint64 key) const { return Hash64NumWithSeed(key, seed_); }
+
+    static uint8 Fingerprint(uint64 hash) { return hash ^ (hash >> 32); }
+
+    // The first slot of a hash is in one of the segment_count_ first segments, by multiply-shift
+    // of the hash; the two others are in the next two segments, at offsets from other bits of it.
+    void GetPositions(uint64 hash, int64* positions) const {
+        const int64 mask = segment_length_ - 1;
+        positions[0] = (static_cast<unsigned __int128>(hash) * (segment_count_ * segment_length_))
+                       >> 64;
+        positions[1] = (positions[0] + segment_length_) ^ ((hash >> 18) & mask);
+        positions[2] = (positions[0] + 2 * segment_length_) ^ (hash & mask);
+    }
+
+    int64 num_elements_ = 0;
+    uint64 seed_ = 0;
+    int64 segment_length_ = 0;      // Power of 2
+    int64 segment_count_ = 0;       // Num segments the first slots are in; two more follow
+    int64 array_length_ = 0;        // (segment_count_ + 2) * segment_length_
+    uint8* fingerprints_ = nullptr; // The slots
+
+    // The size of the file mapping of 'fingerprints_' if mapped, 0 otherwise.
+    int64 mapping_size_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(BinaryFuseFilter);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_FUSE_FILTER_BINARY_FUSE_FILTER_H_
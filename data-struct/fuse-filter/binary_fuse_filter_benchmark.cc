@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/data-struct/fuse-filter/binary_fuse_filter.h"
+#include "cpp-base/file/file.h"
+#include "cpp-base/file/temp_file_test_util.h"
+#include "cpp-base/thread/threadpool.h"
+
+using cpp_base::BinaryFuseFilter;
+using cpp_base::BloomFilter;
+using cpp_base::File;
+using cpp_base::TempFile;
+using cpp_base::ThreadPool;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+class BinaryFuseFilterTest : public ::testing::Test {
+  public:
+    BinaryFuseFilterTest() { }
+    ~BinaryFuseFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+
+    // Returns the time per key of running the given function on 'num_keys' keys.
+    static double NanosPerKey(int64 num_keys, const std::function<void()>& f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / num_keys;
+    }
+};
+
+TEST_F(BinaryFuseFilterTest, Benchmark) {
+    // Build, lookups and opening from a file, vs. a Bloom filter of about the same false positive
+    // rate, on filters much larger than the last-level cache.
+    const int64 kNumKeys = 20000000;
+    vector<uint64> keys = RandomKeys(kNumKeys, 1);
+    vector<uint64> absent_keys = RandomKeys(kNumKeys, 2);
+
+    unique_ptr<BinaryFuseFilter> filter;
+    LOG(INFO) << "Build: " << NanosPerKey(kNumKeys, [&] {
+        filter.reset(new BinaryFuseFilter(keys.data(), kNumKeys));
+    }) << " ns/key";
+    for (int num_threads = 2; num_threads <= 8; num_threads *= 2) {
+        ThreadPool pool(num_threads);
+        pool.StartWorkers();
+        LOG(INFO) << "Build with " << num_threads << " threads: " << NanosPerKey(kNumKeys, [&] {
+            BinaryFuseFilter(keys.data(), kNumKeys, &pool, num_threads);
+        }) << " ns/key";
+    }
+
+    int64 num_found = 0;
+    const double hit_ns = NanosPerKey(kNumKeys, [&] {
+        for (uint64 key : keys)
+            num_found += filter->Contains(key);
+    });
+    EXPECT_EQ(kNumKeys, num_found);
+    const double miss_ns = NanosPerKey(kNumKeys, [&] {
+        for (uint64 key : absent_keys)
+            num_found += filter->Contains(key);
+    });
+    LOG(INFO) << "BinaryFuseFilter of " << filter->SizeInBytes() / 1e6 << " MB ("
+              << filter->SizeInBytes() * 8. / kNumKeys << " bits/key): " << hit_ns
+              << " ns/hit, " << miss_ns << " ns/miss; false positives: "
+              << (num_found - kNumKeys) * 100. / kNumKeys << "%";
+
+    BloomFilter bf(kNumKeys * 11.5, kNumKeys, BloomFilter::kDoubleHashing);
+    const double bf_insert_ns = NanosPerKey(kNumKeys, [&] {
+        for (uint64 key : keys)
+            bf.Insert(key);
+    });
+    num_found = 0;
+    const double bf_hit_ns = NanosPerKey(kNumKeys, [&] {
+        for (uint64 key : keys)
+            num_found += bf.Contains(key);
+    });
+    const double bf_miss_ns = NanosPerKey(kNumKeys, [&] {
+        for (uint64 key : absent_keys)
+            num_found += bf.Contains(key);
+    });
+    LOG(INFO) << "BloomFilter of " << bf.BitSize() / 8e6 << " MB (11.5 bits/key): "
+              << bf_insert_ns << " ns/insert, " << bf_hit_ns << " ns/hit, " << bf_miss_ns
+              << " ns/miss; false positives: " << (num_found - kNumKeys) * 100. / kNumKeys << "%";
+
+    const string path = TempFile("binary_fuse_filter_benchmark.bff");
+    ASSERT_TRUE(filter->SaveToFile(path));
+    unique_ptr<BinaryFuseFilter> mapped;
+    const double map_ms = NanosPerKey(1e6, [&] { mapped = BinaryFuseFilter::MapFromFile(path); });
+    const double load_ms = NanosPerKey(1e6, [&] {
+        ASSERT_TRUE(BinaryFuseFilter::LoadFromFile(path) != nullptr);
+    });
+    LOG(INFO) << "MapFromFile(): " << map_ms << " ms, LoadFromFile(): " << load_ms << " ms";
+    ASSERT_TRUE(mapped != nullptr);
+    EXPECT_TRUE(mapped->Contains(keys[0]));
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cpp-base/data-struct/fuse-filter/binary_fuse_filter.h"
+#include "cpp-base/file/file.h"
+#include "cpp-base/file/file_output_stream.h"
+#include "cpp-base/file/temp_file_test_util.h"
+#include "cpp-base/thread/threadpool.h"
+
+using cpp_base::BinaryFuseFilter;
+using cpp_base::File;
+using cpp_base::FileOutputStream;
+using cpp_base::TempFile;
+using cpp_base::ThreadPool;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+class BinaryFuseFilterTest : public ::testing::Test {
+  public:
+    BinaryFuseFilterTest() { }
+    ~BinaryFuseFilterTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    static vector<uint64> RandomKeys(int64 n, int seed) {
+        std::mt19937_64 rand_gen(seed);
+        vector<uint64> keys(n);
+        for (uint64& key : keys)
+            key = rand_gen();
+        return keys;
+    }
+
+    // Returns the fraction of the given absent keys the filter contains.
+    static double FalsePositiveRatio(const BinaryFuseFilter& filter,
+                                     const vector<uint64>& absent_keys) {
+        int64 num_found = 0;
+        for (uint64 key : absent_keys)
+            num_found += filter.Contains(key);
+        return num_found * 1. / absent_keys.size();
+    }
+};
+
+TEST_F(BinaryFuseFilterTest, BasicTest) {
+    // Sequential keys, each twice.
+    vector<uint64> keys;
+    for (uint64 key = 0; key < 10000; ++key) {
+        keys.push_back(key);
+        keys.push_back(key);
+    }
+    BinaryFuseFilter filter(keys.data(), keys.size());
+    EXPECT_EQ(10000, filter.NumElements());
+    EXPECT_FALSE(filter.IsReadOnly());
+    for (uint64 key : keys)
+        ASSERT_TRUE(filter.Contains(key)) << key;
+
+    vector<uint64> absent_keys;
+    for (uint64 key = 10000; key < 1010000; ++key)
+        absent_keys.push_back(key);
+    EXPECT_NEAR(1 / 256., FalsePositiveRatio(filter, absent_keys), 0.001);
+}
+
+TEST_F(BinaryFuseFilterTest, SizesTest) {
+    // Builds for any number of keys, with no false negatives.
+    for (int64 n = 0; n < 300; ++n) {
+        vector<uint64> keys = RandomKeys(n, n);
+        BinaryFuseFilter filter(keys.data(), n);
+        EXPECT_EQ(n, filter.NumElements());
+        for (uint64 key : keys)
+            ASSERT_TRUE(filter.Contains(key)) << n;
+    }
+
+    // About 9 bits per key for large sets, at 1/256 false positives.
+    vector<uint64> absent_keys = RandomKeys(1000000, 1);
+    for (int64 n : {1000, 10000, 100000, 1000000, 10000000}) {
+        vector<uint64> keys = RandomKeys(n, 2);
+        BinaryFuseFilter filter(keys.data(), n);
+        for (uint64 key : keys)
+            ASSERT_TRUE(filter.Contains(key));
+        const double bits_per_key = filter.SizeInBytes() * 8. / n;
+        const double false_positives = FalsePositiveRatio(filter, absent_keys);
+        LOG(INFO) << n << " keys: " << bits_per_key << " bits/key, false positives: "
+                  << false_positives * 100 << "%";
+        EXPECT_NEAR(1 / 256., false_positives, 0.001);
+        if (n >= 1000000) {
+            EXPECT_LT(bits_per_key, 9.1);
+        }
+    }
+}
+
+TEST_F(BinaryFuseFilterTest, ParallelBuildTest) {
+    // Same filter whatever the number of tasks.
+    for (int64 n : {0, 1, 100, 100000}) {
+        vector<uint64> keys = RandomKeys(n, 3);
+        keys.insert(keys.end(), keys.begin(), keys.begin() + n / 2);
+        BinaryFuseFilter filter(keys.data(), keys.size());
+        for (int num_tasks : {1, 3, 8}) {
+            ThreadPool pool(4);
+            pool.StartWorkers();
+            BinaryFuseFilter parallel_filter(keys.data(), keys.size(), &pool, num_tasks);
+            EXPECT_EQ(n, parallel_filter.NumElements());
+            ASSERT_EQ(filter.SizeInBytes(), parallel_filter.SizeInBytes());
+            EXPECT_EQ(0, memcmp(filter.RawData(), parallel_filter.RawData(),
+                                filter.SizeInBytes())) << n << " keys, " << num_tasks << " tasks";
+        }
+    }
+}
+
+TEST_F(BinaryFuseFilterTest, SaveAndLoadTest) {
+    const string path = TempFile("binary_fuse_filter_test.bff");
+    vector<uint64> absent_keys = RandomKeys(10000, 4);
+    for (int64 n : {0, 1000, 100000}) {
+        vector<uint64> keys = RandomKeys(n, 5);
+        BinaryFuseFilter filter(keys.data(), n);
+        ASSERT_TRUE(filter.SaveToFile(path));
+        EXPECT_EQ(4096 + filter.SizeInBytes(), File::Size(path.c_str()));
+
+        unique_ptr<BinaryFuseFilter> loaded = BinaryFuseFilter::LoadFromFile(path);
+        unique_ptr<BinaryFuseFilter> mapped = BinaryFuseFilter::MapFromFile(path);
+        ASSERT_TRUE(loaded != nullptr);
+        ASSERT_TRUE(mapped != nullptr);
+        EXPECT_FALSE(loaded->IsReadOnly());
+        EXPECT_TRUE(mapped->IsReadOnly());
+        for (const BinaryFuseFilter* other : {loaded.get(), mapped.get()}) {
+            EXPECT_EQ(filter.NumElements(), other->NumElements());
+            ASSERT_EQ(filter.SizeInBytes(), other->SizeInBytes());
+            EXPECT_EQ(0, memcmp(filter.RawData(), other->RawData(), filter.SizeInBytes()));
+
+            // Answers identically, including false positives.
+            for (uint64 key : keys)
+                EXPECT_TRUE(other->Contains(key));
+            for (uint64 key : absent_keys)
+                EXPECT_EQ(filter.Contains(key), other->Contains(key));
+        }
+    }
+
+    // Truncated, or not a filter at all.
+    const int32 size = File::Size(path.c_str());
+    unique_ptr<File> file(File::Open(path.c_str(), "r"));
+    string contents(size, 0);
+    ASSERT_EQ(size, file->Read(&contents[0], size));
+    file.reset();
+    for (const string& bad : {contents.substr(0, size - 1), contents.substr(0, 100),
+                              string(size, 'x')}) {
+        unique_ptr<FileOutputStream> out(FileOutputStream::OpenOrDie(path.c_str()));
+        out->WriteOrDie(bad);
+        ASSERT_TRUE(out->Close());
+        EXPECT_TRUE(BinaryFuseFilter::LoadFromFile(path) == nullptr);
+        EXPECT_TRUE(BinaryFuseFilter::MapFromFile(path) == nullptr);
+    }
+    EXPECT_TRUE(File::Remove(path.c_str()));
+    EXPECT_TRUE(BinaryFuseFilter::LoadFromFile(path) == nullptr);
+}
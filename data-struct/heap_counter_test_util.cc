@@ -0,0 +1,51 @@
+#include "cpp-base/data-struct/heap_counter_test_util.h"
+
+#include <stddef.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<int64> allocated_bytes(0);
+std::atomic<int64> num_allocations(0);
+
+// The size of each block is kept in front of it, in as many bytes as malloc() aligns to, so that
+// the block stays as aligned as malloc() would make it.
+const size_t kPrefixSize = alignof(max_align_t);
+
+}  // namespace
+
+namespace cpp_base {
+
+int64 HeapAllocatedBytes() {
+    return allocated_bytes;
+}
+
+int64 HeapNumAllocations() {
+    return num_allocations;
+}
+
+}  // namespace cpp_base
+
+void* operator new(size_t size) {
+    ++num_allocations;
+    allocated_bytes += size;
+    char* p = static_cast<char*>(malloc(size + kPrefixSize));
+    if (p == nullptr)
+        throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(p) = size;
+    return p + kPrefixSize;
+}
+
+void operator delete(void* p) noexcept {
+    if (p == nullptr)
+        return;
+    char* q = static_cast<char*>(p) - kPrefixSize;
+    allocated_bytes -= *reinterpret_cast<size_t*>(q);
+    free(q);
+}
+
+void operator delete(void* p, size_t size) noexcept {
+    operator delete(p);
+}
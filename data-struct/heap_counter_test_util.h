@@ -0,0 +1,20 @@
+#ifndef CPP_BASE_DATA_STRUCT_HEAP_COUNTER_TEST_UTIL_H_
+#define CPP_BASE_DATA_STRUCT_HEAP_COUNTER_TEST_UTIL_H_
+
+#include "cpp-base/integral_types.h"
+
+namespace cpp_base {
+
+// Linking heap_counter_test_util.cc replaces the global operator new and delete of the test
+// binary with ones that count, to measure memory per entry or allocations per operation.
+// Compare the values before and after the code to measure.
+
+// The bytes requested from the heap through operator new and not yet deleted.
+int64 HeapAllocatedBytes();
+
+// The calls to operator new so far.
+int64 HeapNumAllocations();
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_HEAP_COUNTER_TEST_UTIL_H_
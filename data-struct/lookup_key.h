@@ -0,0 +1,32 @@
+#ifndef CPP_BASE_DATA_STRUCT_LOOKUP_KEY_H_
+#define CPP_BASE_DATA_STRUCT_LOOKUP_KEY_H_
+
+#include <string>
+
+#include "cpp-base/hash/hash.h"
+#include "cpp-base/string/stringpiece.h"
+
+namespace cpp_base {
+
+// What a container's hash index is keyed by, for containers that own their
+// keys elsewhere (e.g., in a list or vector) at stable addresses.
+//
+// For std::string keys it is a StringPiece into the owned key, so a lookup by
+// StringPiece or const char* probes the index without constructing (and
+// allocating) a std::string; it is also smaller than a std::string. For any
+// other key type it is the key itself.
+template <class KeyType>
+struct LookupKey {
+    typedef KeyType Type;
+    static const KeyType& Of(const KeyType& key) { return key; }
+};
+
+template <>
+struct LookupKey<std::string> {
+    typedef StringPiece Type;
+    static StringPiece Of(const std::string& key) { return StringPiece(key); }
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_LOOKUP_KEY_H_
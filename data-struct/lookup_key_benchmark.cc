@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+#include "cpp-base/data-struct/heap_counter_test_util.h"
+#include "cpp-base/data-struct/lru_map.h"
+#include "cpp-base/data-struct/vector_map.h"
+#include "cpp-base/string/stringpiece.h"
+
+using cpp_base::HeapNumAllocations;
+using cpp_base::LruMap;
+using cpp_base::StringPiece;
+using cpp_base::VectorMap;
+using std::string;
+using std::vector;
+
+class LookupKeyTest : public ::testing::Test {
+  public:
+    LookupKeyTest() { }
+    ~LookupKeyTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    // Keys long enough not to fit in a std::string's inline buffer.
+    static vector<string> MakeKeys(int n) {
+        vector<string> keys;
+        for (int i = 0; i < n; ++i)
+            keys.push_back("some/longish/request/path/" + std::to_string(i));
+        return keys;
+    }
+};
+
+TEST_F(LookupKeyTest, Benchmark) {
+    const int kNumKeys = 100000;
+    const int kNumLookups = 2000000;
+    vector<string> keys = MakeKeys(kNumKeys);
+    // What a request handler has at hand: pieces of a larger buffer.
+    string buffer;
+    vector<std::pair<int, int>> pieces;
+    for (const string& key : keys) {
+        pieces.push_back(std::make_pair(buffer.size(), key.size()));
+        buffer += key;
+    }
+    LruMap<string, int> m(kNumKeys);
+    VectorMap<string> v;
+    for (int i = 0; i < kNumKeys; ++i) {
+        m.Put(keys[i], i);
+        v.Add(keys[i]);
+    }
+
+    int64 sum = 0;
+    for (bool by_piece : {false, true}) {
+        int64 allocations = HeapNumAllocations();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kNumLookups; ++i) {
+            const auto& p = pieces[(i * 7919LL) % kNumKeys];
+            StringPiece piece(buffer.data() + p.first, p.second);
+            int x = 0;
+            if (by_piece) {
+                m.GetWithTouch(piece, &x);
+                sum += x + v.Index(piece);
+            } else {
+                // What the callers had to do before.
+                m.GetWithTouch(piece.as_string(), &x);
+                sum += x + v.Index(piece.as_string());
+            }
+        }
+        const double ns = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / kNumLookups;
+        const double allocs_per_op = (HeapNumAllocations() - allocations) * 1. / kNumLookups;
+        LOG(INFO) << (by_piece ? "StringPiece" : "std::string") << " lookups: "
+                  << allocs_per_op << " allocations and " << ns
+                  << " ns per LruMap::GetWithTouch() + VectorMap::Index()";
+        if (by_piece) {
+            EXPECT_EQ(allocs_per_op, 0);
+        } else {
+            EXPECT_GE(allocs_per_op, 2);
+        }
+    }
+    EXPECT_GT(sum, 0);
+}
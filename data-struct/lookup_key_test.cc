@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "cpp-base/data-struct/heap_counter_test_util.h"
+#include "cpp-base/data-struct/lru_map.h"
+#include "cpp-base/data-struct/lru_set.h"
+#include "cpp-base/data-struct/vector_map.h"
+#include "cpp-base/string/stringpiece.h"
+
+using cpp_base::HeapNumAllocations;
+using cpp_base::LruMap;
+using cpp_base::LruSet;
+using cpp_base::StringPiece;
+using cpp_base::VectorMap;
+using std::string;
+using std::vector;
+
+class LookupKeyTest : public ::testing::Test {
+  public:
+    LookupKeyTest() { }
+    ~LookupKeyTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+
+    // Keys long enough not to fit in a std::string's inline buffer.
+    static vector<string> MakeKeys(int n) {
+        vector<string> keys;
+        for (int i = 0; i < n; ++i)
+            keys.push_back("some/longish/request/path/" + std::to_string(i));
+        return keys;
+    }
+};
+
+TEST_F(LookupKeyTest, LruMap) {
+    LruMap<string, int> m(3);
+    m.Put("one", 1);
+    m.Put("two", 2);
+    m.Put(string("three\0embedded", 14), 3);
+    int x;
+    const char* key = "one";
+    EXPECT_TRUE(m.GetWithTouch(key, &x));
+    EXPECT_EQ(x, 1);
+    EXPECT_TRUE(m.GetWithoutTouch(StringPiece("two"), &x));
+    EXPECT_EQ(x, 2);
+    EXPECT_TRUE(m.Contains(StringPiece("three\0embedded", 14)));
+    EXPECT_FALSE(m.Contains("three"));
+    EXPECT_FALSE(m.Contains("twofold"));
+    EXPECT_TRUE(m.Contains(StringPiece("twofold", 3)));
+
+    // Order: two three one. Evictions must leave the index consistent.
+    m.Put("four", 4);
+    EXPECT_FALSE(m.Contains("two"));
+    EXPECT_TRUE(m.Touch("one"));
+    EXPECT_TRUE(m.Erase(StringPiece("four"), &x));
+    EXPECT_EQ(x, 4);
+    m.Put("five", 5);
+    m.Put("six", 6);
+    m.CheckInternalCorrectness();
+    EXPECT_EQ(m.Size(), 3);
+}
+
+TEST_F(LookupKeyTest, LruSet) {
+    LruSet<string> s(2);
+    s.Insert("a");
+    s.Insert("b");
+    EXPECT_TRUE(s.Contains(StringPiece("ab", 1)));
+    EXPECT_TRUE(s.Touch("a"));
+    s.Insert("c");
+    EXPECT_FALSE(s.Contains("b"));
+    EXPECT_TRUE(s.Erase("c"));
+    s.CheckInternalCorrectness();
+}
+
+TEST_F(LookupKeyTest, VectorMap) {
+    VectorMap<string> v;
+    vector<string> keys = MakeKeys(1000);
+    // Many Add()s, so the vector reallocates along the way.
+    for (int i = 0; i < keys.size(); ++i)
+        EXPECT_EQ(v.Add(keys[i]), i);
+    EXPECT_EQ(v.Add(keys[10]), 10);
+    for (int i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(v.Index(StringPiece(keys[i])), i);
+        EXPECT_EQ(v.Index(keys[i].c_str()), i);
+    }
+    EXPECT_EQ(v.Index("absent"), -1);
+    EXPECT_FALSE(v.Contains(StringPiece(keys[5].data(), 3)));
+
+    // A copy has its own index.
+    VectorMap<string> copy(v);
+    v.clear();
+    EXPECT_FALSE(v.Contains(keys[7]));
+    EXPECT_EQ(copy.Index(keys[7]), 7);
+    copy = VectorMap<string>();
+    EXPECT_EQ(copy.size(), 0);
+
+    VectorMap<int> ints;
+    EXPECT_EQ(ints.Add(5), 0);
+    EXPECT_EQ(ints.Index(5), 0);
+}
+
+TEST_F(LookupKeyTest, LookupByPieceDoesNotAllocate) {
+    vector<string> keys = MakeKeys(100);
+    LruMap<string, int> m(100);
+    VectorMap<string> v;
+    for (int i = 0; i < keys.size(); ++i) {
+        m.Put(keys[i], i);
+        v.Add(keys[i]);
+    }
+    const string buffer = keys[42] + keys[7];
+    const StringPiece piece(buffer.data(), keys[42].size());
+
+    const int64 allocations = HeapNumAllocations();
+    int x = -1;
+    const bool found = m.GetWithTouch(piece, &x);
+    const int index = v.Index(piece);
+    const bool longer_found = m.Contains(StringPiece(buffer.data(), keys[42].size() + 1));
+    EXPECT_EQ(HeapNumAllocations(), allocations);
+    EXPECT_TRUE(found);
+    EXPECT_EQ(x, 42);
+    EXPECT_EQ(index, 42);
+    EXPECT_FALSE(longer_found);
+}
@@ -5,28 +5,124 @@
 #include <hash_map>
 #include <limits>
 #include <list>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "cpp-base/data-struct/lookup_key.h"
+#include "cpp-base/file/file_input_stream.h"
+#include "cpp-base/file/file_output_stream.h"
 #include "cpp-base/hash/hash.h"
 #include "cpp-base/macros.h"
 #include "cpp-base/util/map_util.h"
 
 namespace cpp_base {
 
+const uint32 kLruSnapshotMagic = 0x4c52554d;  // "LRUM"
+// LoadFromFile() sizes the hash index up front for at most this many entries,
+// as the count in a snapshot header is not trusted; the index grows past it.
+const int64 kMaxLruSnapshotPresize = 1 << 20;
+
+// How LruMap and LruSet snapshots write and read keys and values by default:
+// trivially copyable types as their bytes, by WriteGeneric()/ReadGeneric(),
+// and std::string with a length prefix. For other types, pass a class with
+// Write() and Read() of the same signatures for them to SaveToFile() and
+// LoadFromFile(); it can derive from this one for the types above.
+struct LruSnapshotSerializer {
+    template <class T>
+    bool Write(const T& value, FileOutputStream* out) const {
+        static_assert(std::is_trivially_copyable<T>::value, "Needs a custom serializer");
+        return out->WriteGeneric(value);
+    }
+
+    template <class T>
+    bool Read(FileInputStream* in, T* value) const {
+        static_assert(std::is_trivially_copyable<T>::value, "Needs a custom serializer");
+        return in->ReadGeneric(value);
+    }
+
+    bool Write(const std::string& value, FileOutputStream* out) const {
+        return out->WriteGeneric(static_cast<int32>(value.size())) &&
+               (value.empty() || out->Write(value));
+    }
+
+    bool Read(FileInputStream* in, std::string* value) const {
+        int32 size;
+        if (!in->ReadGeneric(&size) || size < 0)
+            return false;
+        value->resize(size);
+        return size == 0 || in->Read(&(*value)[0], size) == size;
+    }
+};
+
+// LruMap's default Policy: entries never expire and only their number is
+// bounded, so an entry carries nothing beyond its key and value.
+//
+// A Policy keeps what LruMap needs beyond the recency order, per map and per
+// entry (in EntryData, a base of each entry), and is told of the entries put
+// and removed. See LruExpiringPolicy in expiring_lru_map.h for entries that
+// expire and a bound on their total weight.
+template <class KeyType, class ValueType>
+struct LruPlainPolicy {
+    struct EntryData {};
+
+    // When an entry put now by Put() expires; 0 means never.
+    double DefaultDeadline() const { return 0; }
+    // Whether the entry is to be treated as absent.
+    bool IsExpired(const EntryData& data) const { return false; }
+    // Whether a deadline read from a snapshot has passed. Deadlines are
+    // ignored here.
+    bool HasPassed(double deadline) const { return false; }
+    // The key of the entry with the earliest deadline if it has passed, or
+    // nullptr.
+    const KeyType* EarliestExpired() const { return nullptr; }
+    bool HasDeadlines() const { return false; }
+    double Deadline(const EntryData& data) const { return 0; }
+
+    int64 Weigh(const KeyType& key, const ValueType& value) const { return 0; }
+    int64 TotalWeight() const { return 0; }
+    int64 MaxWeight() const { return std::numeric_limits<int64>::max(); }
+    // Called for an entry not put for outweighing MaxWeight() on its own.
+    void OnRejected() {}
+
+    // Called for each entry put, or re-put, with its deadline (0 for none)
+    // and weight, and for each entry removed.
+    void OnInsert(const KeyType& key, double deadline, int64 weight, EntryData* data) {}
+    void OnRemove(EntryData* data) {}
+    void Clear() {}
+};
+
 // This class provides a bounded-size map which guarantees to never exceed
 // the given capacity; the least-recently used entry is removed to ensure this.
 // Lookup/insertion/deletion are all done in O(1) like a regular hash map;
 // it's hash-map-based so there is no API to iterate over keys in sorted order.
+//
+// See ExpiringLruMap for entries that also expire, and a map also bounded by
+// total weight: the Policy parameter is what implements it, so that a plain
+// LruMap pays for neither.
 // This class is *not* thread safe; concurrency must be provided externally.
-template <class KeyType, class ValueType>
+template <class KeyType, class ValueType,
+          class Policy = LruPlainPolicy<KeyType, ValueType>>
 class LruMap {
-  private:
-    typedef std::list<std::pair<KeyType, ValueType>> ListType;
-    typedef hash_map<KeyType, typename ListType::iterator> MapType;
+  public:
+    // What lookups take: a StringPiece for std::string keys, so that a
+    // StringPiece or const char* is looked up without constructing a string,
+    // and KeyType otherwise. See LookupKey.
+    typedef typename LookupKey<KeyType>::Type LookupType;
+
+  protected:
+    struct Entry : public std::pair<KeyType, ValueType>, public Policy::EntryData {
+        Entry(const KeyType& key, const ValueType& value)
+                : std::pair<KeyType, ValueType>(key, value) {}
+    };
+    typedef std::list<Entry> ListType;
+    // Keyed by LookupKey::Of() the key in the list entry.
+    typedef hash_map<LookupType, typename ListType::iterator> MapType;
     ListType list_;
     MapType map_;
     int64 capacity_;
+    Policy policy_;
 
   public:
     LruMap() : capacity_(std::numeric_limits<int64>::max()) {}
@@ -38,11 +134,15 @@ class LruMap {
 
     bool Empty() const { return map_.empty(); }
     size_t Size() const { return map_.size(); }
-    bool Contains(const KeyType& key) const { return ContainsKey(map_, key); }
+    bool Contains(const LookupType& key) const {
+        typename MapType::const_iterator map_it = map_.find(key);
+        return map_it != map_.end() && !policy_.IsExpired(*map_it->second);
+    }
 
     void Clear() {
         list_.clear();
         map_.clear();
+        policy_.Clear();
     }
 
     // Returns false iff map is empty.
@@ -66,38 +166,19 @@ class LruMap {
     bool Put(const KeyType& key,
              const ValueType& value,
              ValueType* evicted_value = nullptr) {
-        typename MapType::iterator map_it = map_.find(key);
-        if (map_it == map_.end()) {
-            CHECK_LE(map_.size(), capacity_);
-            if (map_.size() == capacity_)
-                CHECK(EvictOldest(evicted_value));
-            list_.push_front(std::pair<KeyType, ValueType>(key, value));
-            map_[key] = list_.begin();
-            CHECK_LE(map_.size(), capacity_);
-            return false;
-        } else {
-            // Remove the existing entry from list_, insert a new one at the
-            // head of list_, and put an iterator to it in map_.
-            typename ListType::iterator list_it = map_it->second;
-            CHECK(list_it->first == key);
-            list_it->second = value;
-            if (list_it != list_.begin()) {
-                list_.splice(list_.begin(), list_, list_it);
-                map_it->second = list_.begin();
-            }
-            CHECK_LE(map_.size(), capacity_);
-            return true;
-        }
+        return PutWithDeadline(key, value, policy_.DefaultDeadline(), evicted_value);
     }
 
     // Gets the value mapped for the given key. Does not reinsert the key at
     // list head. 'value' cannot be nullptr.
-    bool GetWithoutTouch(const KeyType& key, ValueType* value) const {
+    bool GetWithoutTouch(const LookupType& key, ValueType* value) const {
         typename MapType::const_iterator map_it = map_.find(key);
         if (map_it == map_.end())
             return false;
         typename ListType::const_iterator list_it = map_it->second;
-        CHECK(list_it->first == key);
+        CHECK(LookupKey<KeyType>::Of(list_it->first) == key);
+        if (policy_.IsExpired(*list_it))
+            return false;
         *value = list_it->second;
         return true;
     }
@@ -106,7 +187,7 @@ class LruMap {
     // head and optionally the mapped value is copied to 'value', if a non-null
     // pointer is given. If the key does not exist in the map, it is *not*
     // inserted.
-    bool GetWithTouch(const KeyType& key, ValueType* value /*can be nullptr*/) {
+    bool GetWithTouch(const LookupType& key, ValueType* value /*can be nullptr*/) {
         typename MapType::iterator map_it = map_.find(key);
         if (map_it == map_.end()) {
             return false;
@@ -114,7 +195,11 @@ class LruMap {
         // Find the list entry, move to the head, and update the list iterator
         // in the map.
         typename ListType::iterator list_it = map_it->second;
-        CHECK(list_it->first == key);
+        CHECK(LookupKey<KeyType>::Of(list_it->first) == key);
+        if (policy_.IsExpired(*list_it)) {
+            EraseEntry(map_it);
+            return false;
+        }
         if (value != nullptr)
             *value = list_it->second;
         if (list_it != list_.begin()) {
@@ -124,21 +209,21 @@ class LruMap {
         return true;
     }
 
-    bool Touch(const KeyType& key) { return GetWithTouch(key, nullptr); }
+    bool Touch(const LookupType& key) { return GetWithTouch(key, nullptr); }
 
     // Removes the given key. Returns whether it existed. The mapped value is
     // filled in 'value', if non-null.
-    bool Erase(const KeyType& key, ValueType* value = nullptr) {
+    bool Erase(const LookupType& key, ValueType* value = nullptr) {
         typename MapType::iterator map_it = map_.find(key);
         if (map_it == map_.end())
             return false;
         typename ListType::iterator list_it = map_it->second;
-        CHECK(list_it->first == key);
-        if (value != nullptr)
+        CHECK(LookupKey<KeyType>::Of(list_it->first) == key);
+        const bool expired = policy_.IsExpired(*list_it);
+        if (value != nullptr && !expired)
             *value = list_it->second;
-        list_.erase(list_it);
-        map_.erase(map_it);
-        return true;
+        EraseEntry(map_it);
+        return !expired;
     }
 
     // Removes the oldest entry. Returns whether one existed. The mapped value
@@ -146,12 +231,13 @@ class LruMap {
     bool EvictOldest(ValueType* value /*can be nullptr*/) {
         if (list_.empty())
             return false;
-        KeyType key = list_.back().first;
         if (value != nullptr)
             *value = list_.back().second;
-        list_.pop_back();
-        int ret = map_.erase(key);
+        policy_.OnRemove(&list_.back());
+        // Before pop_back(): the map's key may point into the list entry.
+        int ret = map_.erase(LookupKey<KeyType>::Of(list_.back().first));
         CHECK_EQ(ret, 1);  // Must have existed
+        list_.pop_back();
         return true;
     }
 
@@ -184,6 +270,7 @@ class LruMap {
         for (const auto& p : list_) {
             typename MapType::const_iterator map_it = map_.find(p.first);
             CHECK(map_it != map_.end());
+            CHECK(&*map_it->second == &p);
             // CHECK(p.first == list_it->first);
             // CHECK(p.second == list_it->second);
             CHECK_EQ(memcmp(&p, &(*map_it->second), sizeof(p)), 0);
@@ -191,37 +278,158 @@ class LruMap {
         CHECK_EQ(list_.size(), map_.size());  // This is an expensive call!
     }
 
-#if 0
-    void SaveToFile(FileOutputStream* out) {
-        out->WriteGenericOrDie(this->unknown_key_);
-        out->WriteGenericOrDie(this->unknown_value_);
-        out->WriteGenericOrDie(static_cast<long>(map_.size()));
-        for (ListIterType it = list_.begin(); it != list_.end(); ++it) {
-            const std::pair<KeyType, ValueType>& p = *it;
-            out->WriteGenericOrDie(p.first);
-            out->WriteGenericOrDie(p.second);
+    // Writes the entries, from the most to the least recently used, and their
+    // deadlines if any, using 'serializer' for the keys and values. Returns
+    // false on I/O error. See LruSnapshotSerializer.
+    template <class Serializer = LruSnapshotSerializer>
+    bool SaveToFile(FileOutputStream* out, const Serializer& serializer = Serializer()) const {
+        const uint8 has_deadlines = policy_.HasDeadlines();
+        if (!out->WriteGeneric(kLruSnapshotMagic) ||
+            !out->WriteGeneric(static_cast<int64>(map_.size())) ||
+            !out->WriteGeneric(has_deadlines))
+            return false;
+        for (const Entry& entry : list_) {
+            if (!serializer.Write(entry.first, out) || !serializer.Write(entry.second, out))
+                return false;
+            if (has_deadlines && !out->WriteGeneric(policy_.Deadline(entry)))
+                return false;
+        }
+        return true;
+    }
+
+    // Loads a snapshot written by SaveToFile() into this map, which must be
+    // empty, restoring the recency order. The hash index is sized up front (for
+    // up to kMaxLruSnapshotPresize entries) and entries are appended in order,
+    // so no entry is relinked, nor rehashed in snapshots up to that size.
+    // Deadlines are restored if this map's entries expire (and ignored
+    // otherwise); entries expired by now are dropped, as are those that don't
+    // fit in the capacity or max weight of this map, i.e., the least recently
+    // used ones. Returns false on I/O error or a malformed snapshot, in which
+    // case the entries read so far are kept.
+    template <class Serializer = LruSnapshotSerializer>
+    bool LoadFromFile(FileInputStream* in, const Serializer& serializer = Serializer()) {
+        CHECK(Empty());
+        uint32 magic;
+        int64 num_entries;
+        uint8 has_deadlines;
+        if (!in->ReadGeneric(&magic) || magic != kLruSnapshotMagic ||
+            !in->ReadGeneric(&num_entries) || num_entries < 0 ||
+            !in->ReadGeneric(&has_deadlines)) {
+            LOG(ERROR) << "Malformed LruMap snapshot header";
+            return false;
+        }
+        map_.resize(std::min(std::min(num_entries, capacity_), kMaxLruSnapshotPresize));
+        KeyType key;
+        ValueType value;
+        for (int64 i = 0; i < num_entries; ++i) {
+            double deadline = 0;
+            if (!serializer.Read(in, &key) || !serializer.Read(in, &value) ||
+                (has_deadlines && !in->ReadGeneric(&deadline))) {
+                LOG(ERROR) << "Truncated LruMap snapshot at entry " << i << " of " << num_entries;
+                return false;
+            }
+            if (deadline > 0 && policy_.HasPassed(deadline))
+                continue;
+            const int64 weight = policy_.Weigh(key, value);
+            if (static_cast<int64>(map_.size()) == capacity_ ||
+                policy_.TotalWeight() + weight > policy_.MaxWeight())
+                continue;
+            typename ListType::iterator list_it = list_.insert(list_.end(), Entry(key, value));
+            if (!map_.insert(
+                    std::make_pair(LookupKey<KeyType>::Of(list_it->first), list_it)).second) {
+                LOG(ERROR) << "Duplicate key in LruMap snapshot at entry " << i;
+                list_.erase(list_it);
+                return false;
+            }
+            policy_.OnInsert(list_it->first, deadline, weight, &*list_it);
+        }
+        return true;
+    }
+
+  protected:
+    // Put() of an entry that expires at the given deadline (never, if 0).
+    // When full, an expired entry is reclaimed, if any, rather than the oldest
+    // one evicted; either way its value is filled in 'evicted_value', if
+    // non-null (of the last one, if several entries are evicted to make room
+    // by weight). An entry heavier than the policy's MaxWeight() is not
+    // inserted, and the key's existing entry, if any, is removed; false is
+    // returned. Otherwise returns whether the key already existed and had not
+    // expired.
+    bool PutWithDeadline(const KeyType& key,
+                         const ValueType& value,
+                         double deadline,
+                         ValueType* evicted_value) {
+        const int64 weight = policy_.Weigh(key, value);
+        if (weight > policy_.MaxWeight()) {
+            policy_.OnRejected();
+            Erase(key);
+            return false;
+        }
+        typename MapType::iterator map_it = map_.find(key);
+        if (map_it == map_.end()) {
+            CHECK_LE(map_.size(), capacity_);
+            while (map_.size() == capacity_ ||
+                   policy_.TotalWeight() + weight > policy_.MaxWeight())
+                EvictOne(evicted_value);
+            list_.push_front(Entry(key, value));
+            map_[LookupKey<KeyType>::Of(list_.begin()->first)] = list_.begin();
+            policy_.OnInsert(list_.begin()->first, deadline, weight, &*list_.begin());
+            CHECK_LE(map_.size(), capacity_);
+            return false;
+        } else {
+            // Remove the existing entry from list_, insert a new one at the
+            // head of list_, and put an iterator to it in map_.
+            typename ListType::iterator list_it = map_it->second;
+            CHECK(list_it->first == key);
+            const bool expired = policy_.IsExpired(*list_it);
+            list_it->second = value;
+            policy_.OnRemove(&*list_it);
+            policy_.OnInsert(list_it->first, deadline, weight, &*list_it);
+            if (list_it != list_.begin()) {
+                list_.splice(list_.begin(), list_, list_it);
+                map_it->second = list_.begin();
+            }
+            // Being at list head and no heavier than MaxWeight() on its own,
+            // this entry is never the one evicted.
+            while (policy_.TotalWeight() > policy_.MaxWeight())
+                EvictOne(evicted_value);
+            CHECK_LE(map_.size(), capacity_);
+            return !expired;
         }
     }
 
-    void LoadFromFile(FileInputStream* in) {
-        CHECK(list_.empty() && map_.empty());
-        KeyType k;
-        in->ReadGenericOrDie(&k); CHECK(k == this->unknown_key_);
-        ValueType v;
-        in->ReadGenericOrDie(&v); CHECK(v == this->unknown_value_);
-        long n;
-        in->ReadGenericOrDie(&n);
-        for (; n > 0; --n) {
-            std::pair<KeyType, ValueType> p;
-            in->ReadGenericOrDie(&p.first);
-            in->ReadGenericOrDie(&p.second);
-            list_.push_back(p);
-            ListIterType list_it = list_.end();
-            map_[p.first] = --list_it;
+    // Removes up to 'max_entries' expired entries, earliest deadline first.
+    // Returns the number removed. The value of the last one removed is filled
+    // in 'value', if non-null.
+    int64 ExpireEntries(int64 max_entries = std::numeric_limits<int64>::max(),
+                        ValueType* value = nullptr) {
+        int64 num_expired = 0;
+        const KeyType* key;
+        while (num_expired < max_entries && (key = policy_.EarliestExpired()) != nullptr) {
+            typename MapType::iterator map_it = map_.find(LookupKey<KeyType>::Of(*key));
+            CHECK(map_it != map_.end());
+            if (value != nullptr)
+                *value = map_it->second->second;
+            EraseEntry(map_it);
+            ++num_expired;
         }
-        CHECK_EQ(map_.size(), list_.size());
+        return num_expired;
+    }
+
+    void EraseEntry(typename MapType::iterator map_it) {
+        typename ListType::iterator list_it = map_it->second;
+        policy_.OnRemove(&*list_it);
+        // Before list_.erase(): the map's key may point into the list entry.
+        map_.erase(map_it);
+        list_.erase(list_it);
+    }
+
+    // Makes room for one more entry: reclaims an expired entry if any,
+    // otherwise evicts the oldest one.
+    void EvictOne(ValueType* evicted_value) {
+        if (!ExpireEntries(1, evicted_value))
+            CHECK(EvictOldest(evicted_value));
     }
-#endif
 
   private:
     DISALLOW_COPY_AND_ASSIGN(LruMap);
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cpp-base/data-struct/lru_map.h"
+#include "cpp-base/file/file.h"
+#include "cpp-base/file/file_input_stream.h"
+#include "cpp-base/file/file_output_stream.h"
+#include "cpp-base/file/temp_file_test_util.h"
+#include "cpp-base/hash/hash.h"
+
+using cpp_base::File;
+using cpp_base::FileInputStream;
+using cpp_base::FileOutputStream;
+using cpp_base::LruMap;
+using cpp_base::TempFile;
+using std::unique_ptr;
+using std::pair;
+using std::string;
+using std::vector;
+
+class LruMapTest : public ::testing::Test {
+  public:
+    LruMapTest() { }
+    ~LruMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+TEST_F(LruMapTest, BenchmarkSnapshotLoad) {
+    const int64 kNumEntries = 2000000;
+    const string path = TempFile("lru_map_test_benchmark");
+    LruMap<int64, int64> m(kNumEntries);
+    for (int64 i = 0; i < kNumEntries; ++i)
+        m.Put(cpp_base::Hash64NumWithSeed(i, 1) >> 1, i);
+
+    auto start = std::chrono::steady_clock::now();
+    unique_ptr<FileOutputStream> out(FileOutputStream::OpenOrDie(path.c_str()));
+    ASSERT_TRUE(m.SaveToFile(out.get()));
+    ASSERT_TRUE(out->Close());
+    const double save_secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    LruMap<int64, int64> loaded(kNumEntries);
+    unique_ptr<FileInputStream> in(FileInputStream::OpenOrDie(path.c_str()));
+    ASSERT_TRUE(loaded.LoadFromFile(in.get()));
+    const double load_secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(loaded.Size(), kNumEntries);
+
+    // Baseline: re-Put() the entries from the oldest, without pre-sizing.
+    vector<pair<int64, int64>> entries = m.RawList();
+    start = std::chrono::steady_clock::now();
+    LruMap<int64, int64> put(kNumEntries);
+    for (const auto& p : entries)
+        put.Put(p.first, p.second);
+    const double put_secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+    LOG(INFO) << kNumEntries << " entries, " << File::Size(path.c_str()) / 1e6 << " MB: "
+              << "save " << kNumEntries / save_secs / 1e6 << " M entries/s; "
+              << "load " << kNumEntries / load_secs / 1e6 << " M entries/s; "
+              << "Put() from memory " << kNumEntries / put_secs / 1e6 << " M entries/s";
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
@@ -1,9 +1,25 @@
 #include <gtest/gtest.h>
+#include <memory>
 #include <string>
 #include <vector>
+#include "cpp-base/data-struct/expiring_lru_map.h"
 #include "cpp-base/data-struct/lru_map.h"
+#include "cpp-base/data-struct/lru_set.h"
+#include "cpp-base/file/file.h"
+#include "cpp-base/file/file_input_stream.h"
+#include "cpp-base/file/file_output_stream.h"
+#include "cpp-base/file/temp_file_test_util.h"
+#include "cpp-base/util/clock.h"
 
+using cpp_base::ExpiringLruMap;
+using cpp_base::File;
+using cpp_base::FileInputStream;
+using cpp_base::FileOutputStream;
 using cpp_base::LruMap;
+using cpp_base::LruSet;
+using cpp_base::SimulatedClock;
+using cpp_base::TempFile;
+using std::unique_ptr;
 using std::pair;
 using std::string;
 using std::vector;
@@ -17,8 +33,19 @@ class LruMapTest : public ::testing::Test {
     void SetUp() override { }
     void TearDown() override { }
 
-    template <class K, class V>
-    static void CheckEntriesOrder(const LruMap<K, V>& m, const vector<K>& keys,
+    // Saves 'from' to a file and loads it into 'to'.
+    template <class Saved, class Loaded>
+    static void SaveAndLoad(const Saved& from, Loaded* to, const string& path) {
+        unique_ptr<FileOutputStream> out(FileOutputStream::OpenOrDie(path.c_str()));
+        ASSERT_TRUE(from.SaveToFile(out.get()));
+        ASSERT_TRUE(out->Close());
+        unique_ptr<FileInputStream> in(FileInputStream::OpenOrDie(path.c_str()));
+        ASSERT_TRUE(to->LoadFromFile(in.get()));
+        EXPECT_TRUE(File::Remove(path.c_str()));
+    }
+
+    template <class K, class V, class P>
+    static void CheckEntriesOrder(const LruMap<K, V, P>& m, const vector<K>& keys,
                                   const vector<V>& values, int line_no) {
         CHECK_EQ(keys.size(), values.size()) << line_no;
         vector<pair<K, V>> l = m.RawList();
@@ -228,3 +255,252 @@ TEST_F(LruMapTest, TestEviction) {
     EXPECT_EQ(7, x);
     EXPECT_TRUE(m.Empty());
 }
+
+TEST_F(LruMapTest, TestExpiration) {
+    SimulatedClock clock(1000);
+    ExpiringLruMap<string, int> m(10, &clock, 10 /*default ttl*/);
+    int x;
+    m.Put("one", 1);                    // Expires at 1010
+    m.PutWithTtl("two", 2, 5);          // Expires at 1005
+    m.PutWithTtl("forever", 0, 0);      // Never expires
+    EXPECT_EQ(m.NumExpiring(), 2);
+    m.CheckInternalCorrectness();
+
+    clock.AdvanceTime(5);
+    EXPECT_TRUE(m.Contains("one"));
+    EXPECT_FALSE(m.Contains("two"));
+    EXPECT_FALSE(m.GetWithoutTouch("two", &x));
+    EXPECT_EQ(m.Size(), 3);             // Not reclaimed yet
+    // Lazily reclaimed by a lookup.
+    EXPECT_FALSE(m.GetWithTouch("two", &x));
+    EXPECT_EQ(m.Size(), 2);
+    m.CheckInternalCorrectness();
+
+    // Touching does not extend the TTL; re-putting does.
+    EXPECT_TRUE(m.Touch("one"));
+    clock.AdvanceTime(4.5);
+    EXPECT_TRUE(m.GetWithTouch("one", &x));
+    EXPECT_EQ(x, 1);
+    clock.AdvanceTime(0.5);
+    EXPECT_FALSE(m.Contains("one"));
+    EXPECT_FALSE(m.Put("one", 11));     // Existed, but expired
+    clock.AdvanceTime(9);
+    EXPECT_TRUE(m.GetWithoutTouch("one", &x));
+    EXPECT_EQ(x, 11);
+    EXPECT_TRUE(m.Erase("one", &x));
+    EXPECT_EQ(m.NumExpiring(), 0);
+
+    clock.AdvanceTime(1000000);
+    EXPECT_TRUE(m.Contains("forever"));
+    m.CheckInternalCorrectness();
+}
+
+TEST_F(LruMapTest, TestExpireEntries) {
+    SimulatedClock clock(0);
+    ExpiringLruMap<int, int> m(1000, &clock, 0 /*no default ttl*/);
+    for (int i = 0; i < 100; ++i)
+        m.PutWithTtl(i, i, 1 + i % 10);  // 10 of each deadline 1..10
+    for (int i = 100; i < 200; ++i)
+        m.Put(i, i);                      // Never expire
+    EXPECT_EQ(m.ExpireEntries(), 0);
+
+    clock.AdvanceTime(3);                 // Deadlines 1, 2, 3 are due
+    EXPECT_EQ(m.ExpireEntries(5), 5);     // Incremental
+    EXPECT_EQ(m.Size(), 195);
+    EXPECT_EQ(m.ExpireEntries(), 25);
+    EXPECT_EQ(m.ExpireEntries(), 0);
+    EXPECT_EQ(m.Size(), 170);
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(m.Contains(i), i % 10 >= 3) << i;
+    m.CheckInternalCorrectness();
+
+    clock.AdvanceTime(100);
+    EXPECT_EQ(m.ExpireEntries(), 70);
+    EXPECT_EQ(m.Size(), 100);
+    EXPECT_EQ(m.NumExpiring(), 0);
+    m.CheckInternalCorrectness();
+}
+
+TEST_F(LruMapTest, TestExpiredReclaimedBeforeEviction) {
+    SimulatedClock clock(0);
+    ExpiringLruMap<string, int> m(3, &clock, 0);
+    m.Put("old", 1);
+    m.PutWithTtl("short", 2, 1);
+    m.Put("new", 3);
+    clock.AdvanceTime(1);
+    // The map is full: the expired entry goes, not the least recently used.
+    int evicted = -1;
+    EXPECT_FALSE(m.Put("newer", 4, &evicted));
+    EXPECT_EQ(evicted, 2);
+    CheckEntriesOrder(m, vector<string>{"old", "new", "newer"},
+                         vector<int>{1, 3, 4}, __LINE__);
+    // With nothing expired, the LRU entry is evicted as usual.
+    EXPECT_FALSE(m.Put("newest", 5, &evicted));
+    EXPECT_EQ(evicted, 1);
+}
+
+TEST_F(LruMapTest, TestWeight) {
+    ExpiringLruMap<string, string> m(100);
+    m.SetWeigher([](const string& key, const string& value) -> int64 {
+                     return value.size();
+                 }, 10);
+    string x;
+    EXPECT_FALSE(m.Put("a", string(3, 'a')));
+    EXPECT_FALSE(m.Put("b", string(3, 'b')));
+    EXPECT_FALSE(m.Put("c", string(3, 'c')));
+    EXPECT_EQ(m.TotalWeight(), 9);
+    EXPECT_TRUE(m.Touch("a"));  // Order: b c a
+
+    // Needs two evictions to fit.
+    EXPECT_FALSE(m.Put("d", string(5, 'd'), &x));
+    EXPECT_EQ(x, "ccc");        // The last one evicted
+    EXPECT_FALSE(m.Contains("b"));
+    EXPECT_FALSE(m.Contains("c"));
+    CheckEntriesOrder(m, vector<string>{"a", "d"},
+                         vector<string>{"aaa", "ddddd"}, __LINE__);
+    EXPECT_EQ(m.TotalWeight(), 8);
+
+    // Growing an existing entry evicts others, never itself.
+    EXPECT_TRUE(m.Put("a", string(6, 'a'), &x));
+    EXPECT_EQ(x, "ddddd");
+    CheckEntriesOrder(m, vector<string>{"a"}, vector<string>{"aaaaaa"}, __LINE__);
+    EXPECT_EQ(m.TotalWeight(), 6);
+
+    // Too heavy on its own: rejected, and the stale entry is dropped.
+    EXPECT_FALSE(m.Put("e", string(11, 'e')));
+    EXPECT_FALSE(m.Contains("e"));
+    EXPECT_EQ(m.Size(), 1);
+    EXPECT_FALSE(m.Put("a", string(11, 'a')));
+    EXPECT_FALSE(m.Contains("a"));
+    EXPECT_EQ(m.NumRejected(), 2);
+    EXPECT_EQ(m.TotalWeight(), 0);
+
+    // Zero-weight entries are bounded by the count capacity only.
+    for (int i = 0; i < 200; ++i)
+        m.Put(std::to_string(i), "");
+    EXPECT_EQ(m.Size(), 100);
+    EXPECT_TRUE(m.Erase("199"));
+    EXPECT_EQ(m.TotalWeight(), 0);
+    m.CheckInternalCorrectness();
+}
+
+TEST_F(LruMapTest, TestExportWeight) {
+    ExpiringLruMap<int, string> m(100);
+    m.SetWeigher([](const int& key, const string& value) -> int64 {
+                     return sizeof(key) + value.size();
+                 }, 1000);
+    m.ExportWeight("lru_map_test_weight");
+    cpp_base::GlobalExporter* exporter = cpp_base::GlobalExporter::Instance();
+    EXPECT_EQ(exporter->GetStatValue("lru_map_test_weight"), "0");
+    m.Put(1, string(96, 'x'));
+    EXPECT_EQ(exporter->GetStatValue("lru_map_test_weight"), "100");
+    m.Clear();
+    EXPECT_EQ(exporter->GetStatValue("lru_map_test_weight"), "0");
+}
+
+TEST_F(LruMapTest, TestSnapshot) {
+    LruMap<int64, double> m(100);
+    for (int64 i = 0; i < 150; ++i)
+        m.Put(i * 7, i / 2.);
+    for (int64 i = 100; i < 150; i += 3)
+        m.Touch(i * 7);
+    LruMap<int64, double> loaded(100);
+    SaveAndLoad(m, &loaded, TempFile("lru_map_test_snapshot"));
+    EXPECT_EQ(loaded.RawList(), m.RawList());
+    loaded.CheckInternalCorrectness();
+
+    // Into a smaller map: the most recently used entries are kept.
+    LruMap<int64, double> smaller(10);
+    SaveAndLoad(m, &smaller, TempFile("lru_map_test_snapshot"));
+    vector<pair<int64, double>> expected = m.RawList();
+    expected.erase(expected.begin(), expected.end() - 10);
+    EXPECT_EQ(smaller.RawList(), expected);
+}
+
+TEST_F(LruMapTest, TestSnapshotStrings) {
+    LruMap<string, string> m;
+    m.Put("one", "1");
+    m.Put("", "empty key");
+    m.Put("empty value", "");
+    m.Put("long", string(100000, 'x'));
+    m.Touch("one");
+    LruMap<string, string> loaded;
+    SaveAndLoad(m, &loaded, TempFile("lru_map_test_snapshot"));
+    EXPECT_EQ(loaded.RawList(), m.RawList());
+
+    // A truncated snapshot is reported.
+    const string path = TempFile("lru_map_test_truncated");
+    {
+        unique_ptr<FileOutputStream> out(FileOutputStream::OpenOrDie(path.c_str()));
+        ASSERT_TRUE(m.SaveToFile(out.get()));
+        ASSERT_TRUE(out->Close());
+    }
+    const int32 size = File::Size(path.c_str());
+    string data(size - 10, 0);
+    {
+        unique_ptr<FileInputStream> in(FileInputStream::OpenOrDie(path.c_str()));
+        ASSERT_EQ(in->Read(&data[0], data.size()), data.size());
+    }
+    {
+        unique_ptr<FileOutputStream> out(FileOutputStream::OpenOrDie(path.c_str()));
+        ASSERT_TRUE(out->Write(data));
+        ASSERT_TRUE(out->Close());
+    }
+    LruMap<string, string> truncated;
+    unique_ptr<FileInputStream> in(FileInputStream::OpenOrDie(path.c_str()));
+    EXPECT_FALSE(truncated.LoadFromFile(in.get()));
+    EXPECT_EQ(truncated.Size(), 3);
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
+
+TEST_F(LruMapTest, TestSnapshotHugeCount) {
+    // A corrupt entry count is reported as a truncated snapshot, without
+    // sizing the index for it.
+    const string path = TempFile("lru_map_test_huge_count");
+    {
+        unique_ptr<FileOutputStream> out(FileOutputStream::OpenOrDie(path.c_str()));
+        ASSERT_TRUE(out->WriteGeneric(cpp_base::kLruSnapshotMagic));
+        ASSERT_TRUE(out->WriteGeneric(static_cast<int64>(1e15)));
+        ASSERT_TRUE(out->WriteGeneric(static_cast<uint8>(0)));
+        ASSERT_TRUE(out->WriteGeneric(static_cast<int64>(1)));
+        ASSERT_TRUE(out->WriteGeneric(static_cast<int64>(2)));
+        ASSERT_TRUE(out->Close());
+    }
+    LruMap<int64, int64> loaded;
+    unique_ptr<FileInputStream> in(FileInputStream::OpenOrDie(path.c_str()));
+    EXPECT_FALSE(loaded.LoadFromFile(in.get()));
+    EXPECT_EQ(loaded.Size(), 1);
+    EXPECT_TRUE(File::Remove(path.c_str()));
+}
+
+TEST_F(LruMapTest, TestSnapshotDeadlines) {
+    SimulatedClock clock(1000);
+    ExpiringLruMap<int, int> m(10, &clock, 0);
+    m.PutWithTtl(1, 1, 5);    // Expires at 1005
+    m.PutWithTtl(2, 2, 20);   // Expires at 1020
+    m.Put(3, 3);              // Never expires
+    clock.AdvanceTime(10);
+    ExpiringLruMap<int, int> loaded(10, &clock, 0);
+    SaveAndLoad(m, &loaded, TempFile("lru_map_test_snapshot"));
+    CheckEntriesOrder(loaded, vector<int>{2, 3}, vector<int>{2, 3}, __LINE__);
+    EXPECT_EQ(loaded.NumExpiring(), 1);
+    clock.AdvanceTime(10);
+    EXPECT_FALSE(loaded.Contains(2));
+    EXPECT_TRUE(loaded.Contains(3));
+}
+
+TEST_F(LruMapTest, TestLruSetSnapshot) {
+    LruSet<string> s(3);
+    s.Insert("a");
+    s.Insert("b");
+    s.Insert("c");
+    s.Touch("a");
+    LruSet<string> loaded(3);
+    SaveAndLoad(s, &loaded, TempFile("lru_set_test_snapshot"));
+    EXPECT_EQ(loaded.Size(), 3);
+    loaded.Insert("d");       // Evicts "b", the least recently used
+    EXPECT_FALSE(loaded.Contains("b"));
+    EXPECT_TRUE(loaded.Contains("a"));
+    EXPECT_TRUE(loaded.Contains("c"));
+    loaded.CheckInternalCorrectness();
+}
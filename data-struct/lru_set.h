@@ -18,6 +18,9 @@ class LruSet {
     // if this waste is considerable in your use case.
     LruMap<T, bool /*trivial*/> map_;
   public:
+    // See LruMap::LookupType.
+    typedef typename LruMap<T, bool>::LookupType LookupType;
+
     LruSet() : map_() {}
     explicit LruSet(int capacity) : map_(capacity) {}
     ~LruSet() {}
@@ -33,18 +36,44 @@ class LruSet {
     inline bool Insert(const T& key) { return map_.Put(key, true); }
 
     // Returns whether the key exists. Does not re-position the key in the set.
-    inline bool Contains(const T& key) const { return map_.Contains(key); }
+    inline bool Contains(const LookupType& key) const { return map_.Contains(key); }
 
     // Just like Contains() except that it re-positions the key in the set.
-    inline bool Touch(const T& key) { return map_.Touch(key); }
+    inline bool Touch(const LookupType& key) { return map_.Touch(key); }
 
     // Removes the given key. Returns whether it existed.
-    inline bool Erase(const T& key) { return map_.Erase(key, nullptr); }
+    inline bool Erase(const LookupType& key) { return map_.Erase(key, nullptr); }
 
     // An intensive check for internal consistency. Do not call frequently.
     void CheckInternalCorrectness() const { map_.CheckInternalCorrectness(); }
 
+    // Snapshot of the keys in recency order; see LruMap::SaveToFile() and
+    // LruMap::LoadFromFile(). 'serializer' is only given keys.
+    template <class Serializer = LruSnapshotSerializer>
+    bool SaveToFile(FileOutputStream* out, const Serializer& serializer = Serializer()) const {
+        return map_.SaveToFile(out, KeyOnlySerializer<Serializer>(serializer));
+    }
+
+    template <class Serializer = LruSnapshotSerializer>
+    bool LoadFromFile(FileInputStream* in, const Serializer& serializer = Serializer()) {
+        return map_.LoadFromFile(in, KeyOnlySerializer<Serializer>(serializer));
+    }
+
   private:
+    // Forwards the keys to 'Serializer'; the trivial mapped values take no space.
+    template <class Serializer>
+    struct KeyOnlySerializer {
+        explicit KeyOnlySerializer(const Serializer& s) : serializer(s) {}
+        bool Write(const T& key, FileOutputStream* out) const { return serializer.Write(key, out); }
+        bool Read(FileInputStream* in, T* key) const { return serializer.Read(in, key); }
+        bool Write(bool value, FileOutputStream* out) const { return true; }
+        bool Read(FileInputStream* in, bool* value) const {
+            *value = true;
+            return true;
+        }
+        const Serializer& serializer;
+    };
+
     DISALLOW_COPY_AND_ASSIGN(LruSet);
 };
 
@@ -0,0 +1,91 @@
+#include "cpp-base/data-struct/magic_ring_buffer.h"
+
+#include <errno.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace cpp_base {
+
+MagicRingBuffer::MagicRingBuffer(int64 min_capacity) {
+    CHECK_GT(min_capacity, 0);
+    const int64 page_size = sysconf(_SC_PAGESIZE);
+    capacity_ = (min_capacity + page_size - 1) / page_size * page_size;
+
+    // An anonymous file holds the physical pages, so they can be mapped twice.
+    int fd = memfd_create("magic_ring_buffer", 0);
+    CHECK_GE(fd, 0) << "memfd_create: " << strerror(errno);
+    CHECK_EQ(ftruncate(fd, capacity_), 0) << "ftruncate: " << strerror(errno);
+
+    // Reserve 2 * capacity_ of address space, then map the file over each half.
+    void* addr = mmap(nullptr, 2 * capacity_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(addr != MAP_FAILED) << "mmap: " << strerror(errno);
+    base_ = static_cast<char*>(addr);
+    for (int half = 0; half < 2; ++half) {
+        void* ret = mmap(base_ + half * capacity_, capacity_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_FIXED, fd, 0);
+        CHECK(ret == base_ + half * capacity_) << "mmap: " << strerror(errno);
+    }
+    close(fd);  // The mappings keep the pages alive.
+}
+
+MagicRingBuffer::~MagicRingBuffer() {
+    munmap(base_, 2 * capacity_);
+}
+
+char* MagicRingBuffer::Reserve(int64 size) {
+    CHECK_GE(size, 0);
+    if (size > Free())
+        return nullptr;
+    return base_ + read_pos_ + count_;
+}
+
+void MagicRingBuffer::Commit(int64 size) {
+    CHECK_GE(size, 0);
+    CHECK_LE(size, Free());
+    count_ += size;
+}
+
+void MagicRingBuffer::Consume(int64 size) {
+    CHECK_GE(size, 0);
+    CHECK_LE(size, count_);
+    read_pos_ += size;
+    if (read_pos_ >= capacity_)
+        read_pos_ -= capacity_;
+    count_ -= size;
+}
+
+bool MagicRingBuffer::TryPut(const void* data, int64 size) {
+    char* dst = Reserve(size);
+    if (dst == nullptr)
+        return false;
+    memcpy(dst, data, size);
+    Commit(size);
+    return true;
+}
+
+bool MagicRingBuffer::TryGet(void* data, int64 size) {
+    CHECK_GE(size, 0);
+    if (size > count_)
+        return false;
+    memcpy(data, Peek(), size);
+    Consume(size);
+    return true;
+}
+
+ssize_t MagicRingBuffer::ReadFrom(int fd) {
+    ssize_t ret = read(fd, base_ + read_pos_ + count_, Free());
+    if (ret > 0)
+        Commit(ret);
+    return ret;
+}
+
+ssize_t MagicRingBuffer::WriteTo(int fd) {
+    ssize_t ret = write(fd, Peek(), count_);
+    if (ret > 0)
+        Consume(ret);
+    return ret;
+}
+
+}  // namespace cpp_base
@@ -0,0 +1,68 @@
+#ifndef CPP_BASE_DATA_STRUCT_MAGIC_RING_BUFFER_H_
+#define CPP_BASE_DATA_STRUCT_MAGIC_RING_BUFFER_H_
+
+#include <sys/types.h>
+
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+
+namespace cpp_base {
+
+// Byte-oriented circular FIFO buffer whose physical pages are mapped twice,
+// back to back, in virtual memory. Writing past the end of the first mapping
+// lands at the start of the buffer, so any readable or writable region is a
+// single contiguous span even when it straddles the wrap point. This lets
+// parsers look at a whole record, and read()/write() fill or drain the buffer,
+// without copying or special-casing the wraparound.
+//
+// Capacity is rounded up to a multiple of the page size. Linux only (needs
+// memfd_create). This class is not thread safe.
+class MagicRingBuffer {
+  public:
+    explicit MagicRingBuffer(int64 min_capacity);
+    ~MagicRingBuffer();
+
+    // Returns a pointer to 'size' contiguous writable bytes, or nullptr if less
+    // than 'size' bytes are free. Nothing becomes readable until Commit().
+    char* Reserve(int64 size);
+
+    // Makes the first 'size' bytes of the reserved region readable.
+    void Commit(int64 size);
+
+    // Returns a pointer to the Count() contiguous readable bytes.
+    const char* Peek() const { return base_ + read_pos_; }
+
+    // Drops the first 'size' readable bytes.
+    void Consume(int64 size);
+
+    // Copying versions of the above. Both return false, and leave the buffer
+    // untouched, if the whole 'size' bytes can't be put or got.
+    bool TryPut(const void* data, int64 size);
+    bool TryGet(void* data, int64 size);
+
+    // Calls read(2) on 'fd' directly into the free space and commits what was
+    // read. Returns the value returned by read(), i.e., -1 on error.
+    ssize_t ReadFrom(int fd);
+
+    // Calls write(2) on 'fd' directly from the readable bytes and consumes what
+    // was written. Returns the value returned by write(), i.e., -1 on error.
+    ssize_t WriteTo(int fd);
+
+    int64 Count()     const { return count_; }
+    int64 Free()      const { return capacity_ - count_; }
+    int64 Capacity()  const { return capacity_; }
+    bool Empty()      const { return count_ == 0; }
+    bool Full()       const { return count_ == capacity_; }
+
+  private:
+    int64 capacity_;
+    char* base_;           // Start of the 2 * capacity_ bytes of mapped memory
+    int64 read_pos_ = 0;   // Always in [0, capacity_)
+    int64 count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(MagicRingBuffer);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_MAGIC_RING_BUFFER_H_
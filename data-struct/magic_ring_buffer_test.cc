@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+#include "cpp-base/data-struct/magic_ring_buffer.h"
+
+using cpp_base::MagicRingBuffer;
+
+class MagicRingBufferTest : public ::testing::Test {
+  public:
+    MagicRingBufferTest() {}
+    ~MagicRingBufferTest() {}
+
+  protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+TEST_F(MagicRingBufferTest, BasicTest) {
+    MagicRingBuffer buff(1);
+    const int64 capacity = buff.Capacity();
+    EXPECT_EQ(0, capacity % sysconf(_SC_PAGESIZE));
+    EXPECT_TRUE(buff.Empty());
+    EXPECT_FALSE(buff.Full());
+    EXPECT_EQ(capacity, buff.Free());
+
+    char c;
+    EXPECT_FALSE(buff.TryGet(&c, 1));
+    EXPECT_TRUE(buff.Reserve(capacity + 1) == nullptr);
+
+    std::string s = "hello";
+    EXPECT_TRUE(buff.TryPut(s.data(), s.size()));
+    EXPECT_EQ(5, buff.Count());
+    EXPECT_EQ(s, std::string(buff.Peek(), buff.Count()));
+
+    char out[5];
+    EXPECT_FALSE(buff.TryGet(out, 6));
+    EXPECT_TRUE(buff.TryGet(out, 5));
+    EXPECT_EQ(s, std::string(out, 5));
+    EXPECT_TRUE(buff.Empty());
+}
+
+TEST_F(MagicRingBufferTest, ContiguousAcrossWrapPoint) {
+    MagicRingBuffer buff(1);
+    const int64 capacity = buff.Capacity();
+
+    // Move the read position close to the end of the buffer.
+    char* p = buff.Reserve(capacity - 3);
+    ASSERT_TRUE(p != nullptr);
+    buff.Commit(capacity - 3);
+    buff.Consume(capacity - 3);
+    EXPECT_TRUE(buff.Empty());
+
+    // This record straddles the wrap point but must be one contiguous span.
+    std::string record = "0123456789";
+    p = buff.Reserve(record.size());
+    ASSERT_TRUE(p != nullptr);
+    memcpy(p, record.data(), record.size());
+    buff.Commit(record.size());
+    EXPECT_EQ(record, std::string(buff.Peek(), buff.Count()));
+
+    // Fill up the buffer entirely; the last byte written must be readable.
+    int64 free = buff.Free();
+    p = buff.Reserve(free);
+    ASSERT_TRUE(p != nullptr);
+    memset(p, 'x', free);
+    buff.Commit(free);
+    EXPECT_TRUE(buff.Full());
+    EXPECT_EQ('x', buff.Peek()[capacity - 1]);
+    EXPECT_EQ(record, std::string(buff.Peek(), record.size()));
+}
+
+TEST_F(MagicRingBufferTest, ComprehensiveTest) {
+    MagicRingBuffer buff(4096);
+    std::deque<char> expected;
+    srand(1);
+    for (int i = 0; i < 100000; ++i) {
+        int64 len = rand() % 1000;  // NOLINT
+        if (rand() % 2) {  // NOLINT
+            std::vector<char> data(len);
+            for (char& c : data)
+                c = rand();  // NOLINT
+            bool fits = len <= buff.Free();
+            EXPECT_EQ(fits, buff.TryPut(data.data(), len));
+            if (fits)
+                expected.insert(expected.end(), data.begin(), data.end());
+        } else {
+            std::vector<char> data(len);
+            bool enough = len <= buff.Count();
+            EXPECT_EQ(enough, buff.TryGet(data.data(), len));
+            if (enough) {
+                EXPECT_TRUE(std::equal(data.begin(), data.end(), expected.begin()));
+                expected.erase(expected.begin(), expected.begin() + len);
+            }
+        }
+        ASSERT_EQ(expected.size(), buff.Count());
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), buff.Peek()));
+    }
+}
+
+TEST_F(MagicRingBufferTest, ReadFromAndWriteToFd) {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    MagicRingBuffer buff(1);
+    const int64 capacity = buff.Capacity();
+
+    // Put the read position right before the wrap point.
+    buff.Commit(capacity - 2);
+    buff.Consume(capacity - 2);
+
+    std::string msg = "message across the wrap point";
+    ASSERT_EQ(msg.size(), write(fds[1], msg.data(), msg.size()));
+    EXPECT_EQ(msg.size(), buff.ReadFrom(fds[0]));
+    EXPECT_EQ(msg, std::string(buff.Peek(), buff.Count()));
+
+    EXPECT_EQ(msg.size(), buff.WriteTo(fds[1]));
+    EXPECT_TRUE(buff.Empty());
+    char out[64];
+    ASSERT_EQ(msg.size(), read(fds[0], out, sizeof(out)));
+    EXPECT_EQ(msg, std::string(out, msg.size()));
+    close(fds[0]);
+    close(fds[1]);
+}
@@ -2,28 +2,49 @@
 #define CPP_BASE_DATA_STRUCT_RING_BUFFER_H_
 
 #include <glog/logging.h>
+#include <algorithm>
+#include <iterator>
 #include <vector>
 #include "cpp-base/macros.h"
 
 namespace cpp_base {
 
 // Fixed-size, circular FIFO buffer on a vector. This class is not thread safe.
+// The underlying vector is sized to the capacity rounded up to a power of two,
+// so that positions wrap with a mask rather than a modulo: it may take up to
+// twice the memory of the capacity, which must be at most 2^30. Capacity() is
+// still exactly what was asked for.
 template <typename T>
 class RingBuffer {
   public:
-    explicit RingBuffer(int capacity) : capacity_(capacity), data_(capacity) {
+    // What TryPut()/TryPutN() do when the buffer is full.
+    enum FullPolicy {
+        kRejectWhenFull,   // Fail the put
+        kOverwriteOldest,  // Drop the oldest element(s) to make room, i.e., keep the newest N
+    };
+
+    class const_iterator;
+
+    explicit RingBuffer(int capacity, FullPolicy policy = kRejectWhenFull)
+            : capacity_(capacity),
+              mask_(RoundUpToPowerOf2(capacity) - 1),
+              policy_(policy),
+              data_(mask_ + 1) {
         CHECK_GT(capacity_, 0);
     }
     ~RingBuffer() {}
 
     // Returns whether the element is successfully put, i.e., buffer not full.
+    // Always succeeds with kOverwriteOldest.
     bool TryPut(T&& element) {
         CHECK_LE(count_, capacity_);
         if (count_ == capacity_) {
-            return false;
+            if (policy_ == kRejectWhenFull)
+                return false;
+            front_ = (front_ + 1) & mask_;
+            count_--;
         }
-        int end = (front_ + count_) % capacity_;
-        data_[end] = std::forward<T>(element);
+        data_[(front_ + count_) & mask_] = std::forward<T>(element);
         count_++;
         return true;
     }
@@ -35,18 +56,110 @@ class RingBuffer {
             return false;
         }
         *element = std::forward<T>(data_[front_]);
-        front_ = (front_ + 1) % capacity_;
+        front_ = (front_ + 1) & mask_;
         count_--;
         return true;
     }
 
+    // Copies up to 'n' elements from 'elements' into the buffer in at most two
+    // contiguous chunks. Returns the number of elements put: with
+    // kRejectWhenFull that is min(n, free space); with kOverwriteOldest it is
+    // always n, and only the newest Capacity() of them (and of what was in the
+    // buffer) are retained.
+    int TryPutN(const T* elements, int n) {
+        CHECK_GE(n, 0);
+        int to_put = n;
+        if (policy_ == kOverwriteOldest) {
+            if (n > capacity_) {
+                elements += n - capacity_;
+                to_put = capacity_;
+            }
+            int overflow = count_ + to_put - capacity_;
+            if (overflow > 0) {
+                front_ = (front_ + overflow) & mask_;
+                count_ -= overflow;
+            }
+        } else {
+            to_put = std::min(n, capacity_ - count_);
+            n = to_put;
+        }
+        int end = (front_ + count_) & mask_;
+        int first = std::min(to_put, mask_ + 1 - end);
+        std::copy(elements, elements + first, data_.begin() + end);
+        std::copy(elements + first, elements + to_put, data_.begin());
+        count_ += to_put;
+        return n;
+    }
+
+    // Moves up to 'n' of the oldest elements into 'elements' in at most two
+    // contiguous chunks. Returns the number of elements got.
+    int TryGetN(T* elements, int n) {
+        CHECK_GE(n, 0);
+        n = std::min(n, count_);
+        int first = std::min(n, mask_ + 1 - front_);
+        std::move(data_.begin() + front_, data_.begin() + front_ + first, elements);
+        std::move(data_.begin(), data_.begin() + (n - first), elements + first);
+        front_ = (front_ + n) & mask_;
+        count_ -= n;
+        return n;
+    }
+
+    // Non-consuming access: index 0 is the oldest element, Count() - 1 the newest.
+    const T& At(int i) const {
+        DCHECK_GE(i, 0);
+        DCHECK_LT(i, count_);
+        return data_[(front_ + i) & mask_];
+    }
+
+    // Iterates from the oldest to the newest element without consuming them.
+    // Any put or get invalidates the iterators.
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end()   const { return const_iterator(this, count_); }
+
+    void Clear() {
+        front_ = 0;
+        count_ = 0;
+    }
+
     int Count()    const { return count_; }
     int Capacity() const { return capacity_; }
     bool Empty()   const { return count_ == 0; }
     bool Full()    const { return count_ == capacity_; }
+    FullPolicy Policy() const { return policy_; }
+
+    class const_iterator {
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        const_iterator(const RingBuffer* buffer, int index) : buffer_(buffer), index_(index) {}
+        const T& operator*()  const { return buffer_->At(index_); }
+        const T* operator->() const { return &buffer_->At(index_); }
+        const_iterator& operator++() { ++index_; return *this; }
+        const_iterator operator++(int) { const_iterator tmp = *this; ++index_; return tmp; }
+        bool operator==(const const_iterator& o) const { return index_ == o.index_; }
+        bool operator!=(const const_iterator& o) const { return index_ != o.index_; }
+
+      private:
+        const RingBuffer* buffer_;
+        int index_;
+    };
 
   private:
+    static int RoundUpToPowerOf2(int x) {
+        CHECK_LE(x, 1 << 30) << "RingBuffer capacity too large";
+        int p = 1;
+        while (p < x)
+            p <<= 1;
+        return p;
+    }
+
     const int capacity_;
+    const int mask_;        // Size of data_ minus 1; data_'s size is a power of 2
+    const FullPolicy policy_;
     int front_ = 0;
     int count_ = 0;
     std::vector<T> data_;
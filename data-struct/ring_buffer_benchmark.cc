@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <vector>
+#include "cpp-base/data-struct/ring_buffer.h"
+#include "cpp-base/integral_types.h"
+
+// The original RingBuffer which wraps positions around with a modulo, as a
+// baseline.
+template <typename T>
+class ModuloRingBuffer {
+  public:
+    explicit ModuloRingBuffer(int capacity) : capacity_(capacity), data_(capacity) {}
+
+    bool TryPut(T&& element) {
+        if (count_ == capacity_)
+            return false;
+        data_[(front_ + count_) % capacity_] = std::forward<T>(element);
+        count_++;
+        return true;
+    }
+    bool TryGet(T* element) {
+        if (count_ == 0)
+            return false;
+        *element = std::forward<T>(data_[front_]);
+        front_ = (front_ + 1) % capacity_;
+        count_--;
+        return true;
+    }
+
+  private:
+    const int capacity_;
+    int front_ = 0;
+    int count_ = 0;
+    std::vector<T> data_;
+};
+
+class RingBufferTest : public ::testing::Test {
+  public:
+    RingBufferTest() {}
+    ~RingBufferTest() {}
+
+  protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+TEST_F(RingBufferTest, Benchmark) {
+    // Capacity is deliberately not a power of two.
+    const int kCapacity = 1000;
+    const int kNumOps = 20000000;
+    typedef std::chrono::steady_clock clock;
+    int64 sum = 0;
+
+    ModuloRingBuffer<int64> old_buff(kCapacity);
+    auto start = clock::now();
+    for (int i = 0; i < kNumOps; ++i) {
+        int64 x = 0;
+        old_buff.TryPut(i + 0);
+        if (i & 1) { old_buff.TryGet(&x); old_buff.TryGet(&x); sum += x; }
+    }
+    double old_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+    cpp_base::RingBuffer<int64> new_buff(kCapacity);
+    start = clock::now();
+    for (int i = 0; i < kNumOps; ++i) {
+        int64 x = 0;
+        new_buff.TryPut(i + 0);
+        if (i & 1) { new_buff.TryGet(&x); new_buff.TryGet(&x); sum += x; }
+    }
+    double new_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+    const int kBatch = 64;
+    std::vector<int64> batch(kBatch);
+    start = clock::now();
+    for (int i = 0; i < kNumOps; i += kBatch) {
+        new_buff.TryPutN(batch.data(), kBatch);
+        new_buff.TryGetN(batch.data(), kBatch);
+        sum += batch[0];
+    }
+    double bulk_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+    LOG(INFO) << "ns per element: modulo TryPut/TryGet: " << old_ns / kNumOps
+              << "; masked TryPut/TryGet: " << new_ns / kNumOps
+              << "; TryPutN/TryGetN of " << kBatch << ": " << bulk_ns / kNumOps
+              << " (checksum " << sum << ")";
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <algorithm>
 #include <deque>
+#include <vector>
 #include "cpp-base/data-struct/ring_buffer.h"
 
 template <typename T>
@@ -66,3 +67,71 @@ TEST_F(RingBufferTest, ComprehensiveTest) {
     }
     LOG(INFO) << "Max size = " << max_size;
 }
+
+TEST_F(RingBufferTest, BulkPutAndGet) {
+    cpp_base::RingBuffer<int> buff1(100);
+    DequeBasedRingBuffer<int> buff2(100);
+    srand(1);
+    for (int i = 0; i < 100000; ++i) {
+        int n = rand() % 70;  // NOLINT
+        std::vector<int> v(n);
+        if (rand() % 2) {  // NOLINT
+            for (int& x : v)
+                x = rand();  // NOLINT
+            int num_put = buff1.TryPutN(v.data(), n);
+            EXPECT_EQ(std::min(n, 100 - buff2.Count()), num_put);
+            for (int j = 0; j < num_put; ++j)
+                EXPECT_TRUE(buff2.TryPut(v[j] + 0));
+        } else {
+            int num_got = buff1.TryGetN(v.data(), n);
+            EXPECT_EQ(std::min(n, buff2.Count()), num_got);
+            for (int j = 0; j < num_got; ++j) {
+                int x;
+                EXPECT_TRUE(buff2.TryGet(&x));
+                EXPECT_EQ(x, v[j]);
+            }
+        }
+        EXPECT_EQ(buff1.Count(), buff2.Count());
+    }
+}
+
+TEST_F(RingBufferTest, OverwriteOldest) {
+    cpp_base::RingBuffer<int> buff(5, cpp_base::RingBuffer<int>::kOverwriteOldest);
+    EXPECT_EQ(5, buff.Capacity());
+    for (int i = 1; i <= 7; ++i)
+        EXPECT_TRUE(buff.TryPut(i + 0));
+    EXPECT_TRUE(buff.Full());
+    // Only the newest 5 are kept: 3 4 5 6 7.
+    EXPECT_EQ(std::vector<int>({3, 4, 5, 6, 7}), std::vector<int>(buff.begin(), buff.end()));
+
+    // Bulk put of more than what fits keeps the newest ones too.
+    std::vector<int> v = {8, 9};
+    EXPECT_EQ(2, buff.TryPutN(v.data(), v.size()));
+    EXPECT_EQ(std::vector<int>({5, 6, 7, 8, 9}), std::vector<int>(buff.begin(), buff.end()));
+    v = {10, 11, 12, 13, 14, 15, 16};
+    EXPECT_EQ(7, buff.TryPutN(v.data(), v.size()));
+    EXPECT_EQ(std::vector<int>({12, 13, 14, 15, 16}),
+              std::vector<int>(buff.begin(), buff.end()));
+
+    int x;
+    EXPECT_TRUE(buff.TryGet(&x));
+    EXPECT_EQ(12, x);
+    EXPECT_EQ(4, buff.Count());
+}
+
+TEST_F(RingBufferTest, IterationDoesNotConsume) {
+    cpp_base::RingBuffer<int> buff(3);
+    EXPECT_TRUE(buff.begin() == buff.end());
+    int x;
+    for (int i = 0; i < 10; ++i) {  // Move the front around the wrap point.
+        EXPECT_TRUE(buff.TryPut(i + 0));
+        EXPECT_TRUE(buff.TryGet(&x));
+    }
+    EXPECT_TRUE(buff.TryPut(1));
+    EXPECT_TRUE(buff.TryPut(2));
+    EXPECT_TRUE(buff.TryPut(3));
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), std::vector<int>(buff.begin(), buff.end()));
+    EXPECT_EQ(1, buff.At(0));
+    EXPECT_EQ(3, buff.At(2));
+    EXPECT_EQ(3, buff.Count());
+}
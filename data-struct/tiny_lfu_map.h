@@ -0,0 +1,180 @@
+#ifndef CPP_BASE_DATA_STRUCT_TINY_LFU_MAP_H_
+#define CPP_BASE_DATA_STRUCT_TINY_LFU_MAP_H_
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <memory>
+
+#include "cpp-base/data-struct/bloom-filter/bloom_filter.h"
+#include "cpp-base/data-struct/count_min_sketch.h"
+#include "cpp-base/data-struct/lru_map.h"
+#include "cpp-base/hash/hash.h"
+#include "cpp-base/integral_types.h"
+#include "cpp-base/macros.h"
+
+namespace cpp_base {
+
+// A bounded-size map like LruMap, with a W-TinyLFU admission policy in front
+// of it so that scans and one-hit wonders can't flush the popular entries.
+// See Einziger et al., "TinyLFU: A Highly Efficient Cache Admission Policy".
+//
+// New entries go to a small 'window' LRU (1% of the capacity). An entry
+// evicted from the window is a candidate for the 'main' LRU; when the main
+// LRU is full, the candidate is admitted only if its estimated access
+// frequency is higher than that of main's LRU victim, otherwise the candidate
+// itself is evicted.
+//
+// Access frequencies are estimated by a CountMinSketch behind a 'doorkeeper'
+// BloomFilter: the first access to a key only sets it in the doorkeeper, so
+// keys seen once don't pollute the sketch. Every 10 * capacity accesses the
+// counts are halved and the doorkeeper is cleared, so the estimates track
+// recent popularity.
+//
+// Accesses are recorded by GetWithTouch() and Touch(), on hits and on misses.
+// Put() is not counted as an access: the usual read-through sequence of a
+// GetWithTouch() miss followed by Put() counts once.
+// This class is *not* thread safe; concurrency must be provided externally.
+template <class KeyType, class ValueType>
+class TinyLfuMap {
+  public:
+    explicit TinyLfuMap(int64 capacity)
+            : capacity_(capacity),
+              window_(std::max<int64>(1, capacity / 100)),
+              main_(std::max<int64>(1, capacity - std::max<int64>(1, capacity / 100))),
+              sample_size_(10 * capacity),
+              sketch_(std::max<int64>(capacity, 64) * 16, 0.01),
+              doorkeeper_(std::max<int64>(sample_size_, 64) * 8, std::max<int64>(sample_size_, 8)) {
+        CHECK_GE(capacity, 2);
+    }
+    ~TinyLfuMap() {}
+
+    bool Empty() const { return window_.Empty() && main_.Empty(); }
+    size_t Size() const { return window_.Size() + main_.Size(); }
+    int64 Capacity() const { return capacity_; }
+    bool Contains(const KeyType& key) const {
+        return window_.Contains(key) || main_.Contains(key);
+    }
+
+    void Clear() {
+        window_.Clear();
+        main_.Clear();
+        sketch_.Clear();
+        doorkeeper_.Clear();
+        num_accesses_ = 0;
+    }
+
+    // Inserts the given key and value. If the key existed, its value is updated
+    // and it is moved to its LRU's head. Returns whether the key already existed.
+    // The value of whichever entry lost the admission contest, if any, is filled
+    // in 'evicted_value', if non-null: the main LRU's victim or the candidate.
+    bool Put(const KeyType& key,
+             const ValueType& value,
+             ValueType* evicted_value = nullptr) {
+        if (window_.Contains(key))
+            return window_.Put(key, value);
+        if (main_.Contains(key))
+            return main_.Put(key, value);
+
+        if (window_.Size() < window_capacity()) {
+            window_.Put(key, value);
+            return false;
+        }
+        // The window is full: its oldest entry becomes a candidate for main_.
+        KeyType candidate_key = KeyType();
+        ValueType candidate_value;
+        CHECK(window_.OldestKey(&candidate_key));
+        CHECK(window_.EvictOldest(&candidate_value));
+        window_.Put(key, value);
+
+        if (main_.Size() < main_capacity()) {
+            main_.Put(candidate_key, candidate_value);
+            return false;
+        }
+        KeyType victim_key = KeyType();
+        CHECK(main_.OldestKey(&victim_key));
+        if (Frequency(candidate_key) > Frequency(victim_key)) {
+            CHECK(main_.EvictOldest(evicted_value));
+            main_.Put(candidate_key, candidate_value);
+            ++num_admitted_;
+        } else {
+            if (evicted_value != nullptr)
+                *evicted_value = candidate_value;
+            ++num_rejected_;
+        }
+        return false;
+    }
+
+    // Gets the value mapped for the given key. Does not record an access nor
+    // reinsert the key at its LRU's head. 'value' cannot be nullptr.
+    bool GetWithoutTouch(const KeyType& key, ValueType* value) const {
+        return window_.GetWithoutTouch(key, value) || main_.GetWithoutTouch(key, value);
+    }
+
+    // Records an access to 'key' and returns whether the map contains it. If
+    // so, it is re-inserted at its LRU's head and the mapped value is copied to
+    // 'value', if a non-null pointer is given.
+    bool GetWithTouch(const KeyType& key, ValueType* value /*can be nullptr*/) {
+        RecordAccess(key);
+        return window_.GetWithTouch(key, value) || main_.GetWithTouch(key, value);
+    }
+
+    bool Touch(const KeyType& key) { return GetWithTouch(key, nullptr); }
+
+    // Removes the given key. Returns whether it existed. The mapped value is
+    // filled in 'value', if non-null.
+    bool Erase(const KeyType& key, ValueType* value = nullptr) {
+        return window_.Erase(key, value) || main_.Erase(key, value);
+    }
+
+    // Estimated number of recent accesses to 'key'.
+    int64 Frequency(const KeyType& key) const {
+        uint64 h = KeyHash(key);
+        return sketch_.GetCount(h) + (doorkeeper_.Contains(h) ? 1 : 0);
+    }
+
+    // Number of window evictions that displaced a main entry / that were dropped.
+    int64 NumAdmitted() const { return num_admitted_; }
+    int64 NumRejected() const { return num_rejected_; }
+
+    // An intensive check for internal consistency. Do not call frequently.
+    void CheckInternalCorrectness() const {
+        window_.CheckInternalCorrectness();
+        main_.CheckInternalCorrectness();
+        CHECK_LE(window_.Size(), window_capacity());
+        CHECK_LE(main_.Size(), main_capacity());
+    }
+
+  private:
+    static uint64 KeyHash(const KeyType& key) { return hash<KeyType>()(key); }
+
+    int64 window_capacity() const { return std::max<int64>(1, capacity_ / 100); }
+    int64 main_capacity() const { return capacity_ - window_capacity(); }
+
+    void RecordAccess(const KeyType& key) {
+        uint64 h = KeyHash(key);
+        // Insert() returns false if the key was (probably) in the doorkeeper already.
+        if (!doorkeeper_.Insert(h))
+            sketch_.Increment(h);
+        if (++num_accesses_ >= sample_size_) {
+            sketch_.HalveCounts();
+            doorkeeper_.Clear();
+            num_accesses_ = 0;
+        }
+    }
+
+    const int64 capacity_;
+    LruMap<KeyType, ValueType> window_;
+    LruMap<KeyType, ValueType> main_;
+    const int64 sample_size_;          // Num accesses between two agings
+    CountMinSketch<uint8> sketch_;
+    BloomFilter doorkeeper_;
+    int64 num_accesses_ = 0;           // Since the last aging
+    int64 num_admitted_ = 0;
+    int64 num_rejected_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TinyLfuMap);
+};
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_DATA_STRUCT_TINY_LFU_MAP_H_
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "cpp-base/data-struct/cache_trace_test_util.h"
+#include "cpp-base/data-struct/lru_map.h"
+#include "cpp-base/data-struct/tiny_lfu_map.h"
+
+using cpp_base::LruMap;
+using cpp_base::Replay;
+using cpp_base::TinyLfuMap;
+using cpp_base::ZipfTrace;
+using std::vector;
+
+class TinyLfuMapTest : public ::testing::Test {
+  public:
+    TinyLfuMapTest() { }
+    ~TinyLfuMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+TEST_F(TinyLfuMapTest, Benchmark) {
+    const int64 kNumKeys = 1000000;
+    const int64 kTraceLength = 2000000;
+    for (double s : {0.8, 0.99}) {
+        vector<int64> trace = ZipfTrace(kNumKeys, s, kTraceLength);
+        // Interleave the Zipf trace with scans of never-repeating keys.
+        vector<int64> scan_trace;
+        scan_trace.reserve(trace.size() * 5 / 4);
+        int64 scan_key = -1;
+        for (int64 i = 0; i < trace.size(); ++i) {
+            scan_trace.push_back(trace[i]);
+            if ((i / 20000) % 4 == 3)
+                scan_trace.push_back(scan_key--);
+        }
+        for (int64 capacity : {kNumKeys / 100, kNumKeys / 10}) {
+            for (const vector<int64>* t : {&trace, &scan_trace}) {
+                LruMap<int64, int64> lru(capacity);
+                TinyLfuMap<int64, int64> tlfu(capacity);
+                double lru_ns, tlfu_ns;
+                double lru_hit = Replay(*t, &lru, &lru_ns);
+                double tlfu_hit = Replay(*t, &tlfu, &tlfu_ns);
+                LOG(INFO) << "Zipf s=" << s << (t == &trace ? "" : " with scans")
+                          << ", capacity=" << capacity
+                          << ": LruMap hit ratio " << lru_hit << ", " << lru_ns << " ns/op"
+                          << "; TinyLfuMap hit ratio " << tlfu_hit << ", " << tlfu_ns << " ns/op";
+                EXPECT_GT(tlfu_hit, lru_hit);
+            }
+        }
+    }
+}
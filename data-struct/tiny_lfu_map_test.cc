@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "cpp-base/data-struct/lru_map.h"
+#include "cpp-base/data-struct/tiny_lfu_map.h"
+
+using cpp_base::LruMap;
+using cpp_base::TinyLfuMap;
+using std::string;
+
+class TinyLfuMapTest : public ::testing::Test {
+  public:
+    TinyLfuMapTest() { }
+    ~TinyLfuMapTest() { }
+
+  protected:
+    void SetUp() override { }
+    void TearDown() override { }
+};
+
+TEST_F(TinyLfuMapTest, BasicTest) {
+    TinyLfuMap<string, int> m(100);
+    int x;
+    EXPECT_TRUE(m.Empty());
+    EXPECT_EQ(m.Capacity(), 100);
+    EXPECT_FALSE(m.Put("a", 1));
+    EXPECT_TRUE(m.Contains("a"));
+    EXPECT_TRUE(m.GetWithTouch("a", &x));
+    EXPECT_EQ(x, 1);
+    EXPECT_TRUE(m.Put("a", 2));
+    EXPECT_TRUE(m.GetWithoutTouch("a", &x));
+    EXPECT_EQ(x, 2);
+    EXPECT_FALSE(m.Put("b", 3));
+    EXPECT_EQ(m.Size(), 2);
+    EXPECT_TRUE(m.Erase("a", &x));
+    EXPECT_EQ(x, 2);
+    EXPECT_FALSE(m.Erase("a"));
+    EXPECT_FALSE(m.Touch("a"));
+    EXPECT_EQ(m.Size(), 1);
+    m.CheckInternalCorrectness();
+    m.Clear();
+    EXPECT_TRUE(m.Empty());
+}
+
+TEST_F(TinyLfuMapTest, NeverExceedsCapacity) {
+    TinyLfuMap<int, int> m(50);
+    srand(1);
+    for (int i = 0; i < 100000; ++i) {
+        int key = rand() % 200;
+        if (!m.GetWithTouch(key, nullptr))
+            m.Put(key, key);
+        if (i % 1000 == 0)
+            m.CheckInternalCorrectness();
+        ASSERT_LE(m.Size(), 50);
+    }
+    EXPECT_EQ(m.Size(), 50);
+    EXPECT_GT(m.NumAdmitted() + m.NumRejected(), 0);
+}
+
+TEST_F(TinyLfuMapTest, ScanDoesNotFlushHotKeys) {
+    TinyLfuMap<int, int> m(100);
+    // Make keys [0, 90) hot: each is accessed several times.
+    for (int round = 0; round < 5; ++round) {
+        for (int key = 0; key < 90; ++key) {
+            if (!m.GetWithTouch(key, nullptr))
+                m.Put(key, key);
+        }
+    }
+    // A scan of one-hit keys, far more than the capacity.
+    for (int key = 1000; key < 1500; ++key) {
+        int evicted = -1;
+        if (!m.GetWithTouch(key, nullptr))
+            m.Put(key, key, &evicted);
+        EXPECT_TRUE(evicted == -1 || evicted >= 1000) << evicted;
+    }
+    for (int key = 0; key < 90; ++key)
+        EXPECT_TRUE(m.Contains(key)) << key;
+    EXPECT_GT(m.NumRejected(), 0);
+
+    // A plain LRU loses them all.
+    LruMap<int, int> lru(100);
+    for (int round = 0; round < 5; ++round) {
+        for (int key = 0; key < 90; ++key) {
+            if (!lru.GetWithTouch(key, nullptr))
+                lru.Put(key, key);
+        }
+    }
+    for (int key = 1000; key < 1500; ++key)
+        lru.Put(key, key);
+    for (int key = 0; key < 90; ++key)
+        EXPECT_FALSE(lru.Contains(key)) << key;
+}
+
+TEST_F(TinyLfuMapTest, FrequencyAges) {
+    TinyLfuMap<int, int> m(10);  // Ages every 100 accesses
+    for (int i = 0; i < 20; ++i)
+        m.Touch(7);
+    const int64 before = m.Frequency(7);
+    EXPECT_GE(before, 20);
+    for (int i = 0; i < 100; ++i)
+        m.Touch(1000 + i);
+    EXPECT_LT(m.Frequency(7), before);
+}
@@ -18,8 +18,10 @@
 #define CPP_BASE_DATA_STRUCT_VECTOR_MAP_H_
 
 #include <hash_map>
+#include <type_traits>
 #include <vector>
 
+#include "cpp-base/data-struct/lookup_key.h"
 #include "cpp-base/hash/hash.h"
 #include "cpp-base/util/map_util.h"
 
@@ -28,9 +30,21 @@ namespace cpp_base {
 // This class stores a vector of distinct elements, as well as a map
 // from elements to index to find the index in the vector.
 // This is useful to store mapping between objects and indices.
+// For std::string elements, Index() and Contains() also take a StringPiece or
+// const char* without constructing a string; see LookupKey.
 template <class T>
 class VectorMap {
  public:
+  typedef typename LookupKey<T>::Type LookupType;
+
+  VectorMap() {}
+  VectorMap(const VectorMap& other) : list_(other.list_) { Reindex(); }
+  VectorMap& operator=(const VectorMap& other) {
+    list_ = other.list_;
+    Reindex();
+    return *this;
+  }
+
   // Adds an element if not already present, and returns its index in
   // the vector-map.
   int Add(const T& element) {
@@ -40,8 +54,15 @@ class VectorMap {
     }
     const int index = list_.size();
     CHECK_EQ(index, map_.size());
+    const T* old_data = list_.data();
     list_.push_back(element);
-    map_[element] = index;
+    if (kKeysPointIntoList && list_.data() != old_data) {
+      // The elements moved, so did what the keys of map_ point to. Amortized
+      // O(1) per Add(), as the vector's growth is geometric.
+      Reindex();
+    } else {
+      map_[LookupKey<T>::Of(list_.back())] = index;
+    }
     return index;
   }
   // TODO(user): Use ArraySlice.
@@ -55,13 +76,13 @@ class VectorMap {
 
   // Returns -1 if the element is not in the vector, or its unique
   // index if it is.
-  int Index(const T& element) const {
+  int Index(const LookupType& element) const {
     return FindWithDefault(map_, element, -1);
   }
   // TODO(user): explore a int-type version.
 
   // Returns wether the element has already been added to the vector-map.
-  bool Contains(const T& element) const { return ContainsKey(map_, element); }
+  bool Contains(const LookupType& element) const { return ContainsKey(map_, element); }
 
   // Returns the element at position index.
   const T& Element(int index) const {
@@ -104,8 +125,19 @@ class VectorMap {
   }
 
  private:
+  // Whether map_ is keyed by references into list_ rather than copies.
+  static const bool kKeysPointIntoList = !std::is_same<LookupType, T>::value;
+
+  // Rebuilds map_ from list_.
+  void Reindex() {
+    map_.clear();
+    for (int i = 0; i < list_.size(); ++i) {
+      map_[LookupKey<T>::Of(list_[i])] = i;
+    }
+  }
+
   std::vector<T> list_;
-  hash_map<T, int> map_;
+  hash_map<LookupType, int> map_;  // Keyed by LookupKey::Of() the elements of list_
 };
 
 }  // namespace cpp_base
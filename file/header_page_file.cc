@@ -0,0 +1,68 @@
+#include "cpp-base/file/header_page_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+
+#include "cpp-base/file/file_output_stream.h"
+
+namespace cpp_base {
+
+bool WriteHeaderPageFile(const std::string& path, const void* header, int64 header_size,
+                         const std::vector<std::pair<const uint8*, int64>>& blocks) {
+    CHECK_LE(header_size, kHeaderPageSize);
+    std::string error;
+    std::unique_ptr<FileOutputStream> out(FileOutputStream::Open(path.c_str(), &error));
+    if (out == nullptr) {
+        LOG(ERROR) << "Cannot open " << path << ": " << error;
+        return false;
+    }
+    char header_page[kHeaderPageSize] = {0};
+    memcpy(header_page, header, header_size);
+    bool ok = out->Write(header_page, kHeaderPageSize);
+
+    // Write() takes an int32 size.
+    const int64 kChunkSize = 1 << 30;
+    for (const auto& block : blocks) {
+        for (int64 offset = 0; ok && offset < block.second; offset += kChunkSize)
+            ok = out->Write(block.first + offset, std::min(kChunkSize, block.second - offset));
+    }
+    ok = ok && out->Close();
+    if (!ok)
+        LOG(ERROR) << "Cannot write " << path << ": " << out->LastErrorMsg();
+    return ok;
+}
+
+uint8* MapHeaderPageFile(const std::string& path, int64* mapping_size) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG(ERROR) << "Cannot open " << path << ": " << strerror(errno);
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < kHeaderPageSize) {
+        LOG(ERROR) << path << " is too short to have a header page";
+        close(fd);
+        return nullptr;
+    }
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // The mapping stays valid
+    if (mapping == MAP_FAILED) {
+        LOG(ERROR) << "Cannot map " << path << ": " << strerror(errno);
+        return nullptr;
+    }
+    *mapping_size = st.st_size;
+    return static_cast<uint8*>(mapping);
+}
+
+void UnmapHeaderPageFile(uint8* mapping, int64 mapping_size) {
+    munmap(mapping, mapping_size);
+}
+
+}  // namespace cpp_base
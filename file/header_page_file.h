@@ -0,0 +1,31 @@
+#ifndef CPP_BASE_FILE_HEADER_PAGE_FILE_H_
+#define CPP_BASE_FILE_HEADER_PAGE_FILE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cpp-base/integral_types.h"
+
+namespace cpp_base {
+
+// Files of a header of one page followed by raw data, as data structures save themselves to be
+// mapped back: the data that follows the header is page-aligned in a mapping of the file, and is
+// used in place.
+const int64 kHeaderPageSize = 4096;
+
+// Writes the given header, of at most kHeaderPageSize bytes, zero-padded to a page, then each of
+// the given blocks of bytes, given with its size. Returns false on I/O error, which it logs.
+bool WriteHeaderPageFile(const std::string& path, const void* header, int64 header_size,
+                         const std::vector<std::pair<const uint8*, int64>>& blocks);
+
+// Maps the given file read-only. Returns the mapping, which starts with the header page, and
+// sets its size, or returns null, which it logs, if the file cannot be mapped or is shorter than
+// a page. Checking the header and the size of the data is left to the caller.
+uint8* MapHeaderPageFile(const std::string& path, int64* mapping_size);
+
+void UnmapHeaderPageFile(uint8* mapping, int64 mapping_size);
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_FILE_HEADER_PAGE_FILE_H_
@@ -0,0 +1,18 @@
+#ifndef CPP_BASE_FILE_TEMP_FILE_TEST_UTIL_H_
+#define CPP_BASE_FILE_TEMP_FILE_TEST_UTIL_H_
+
+#include <stdlib.h>
+#include <string>
+
+namespace cpp_base {
+
+// Returns the path of a file of the given name in the test's temporary
+// directory, $TEST_TMPDIR, or in /tmp if it is not set.
+inline std::string TempFile(const std::string& name) {
+    const char* dir = getenv("TEST_TMPDIR");
+    return std::string(dir != nullptr ? dir : "/tmp") + "/" + name;
+}
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_FILE_TEMP_FILE_TEST_UTIL_H_
@@ -31,6 +31,7 @@ using namespace __gnu_cxx;  // NOLINT
 #include <utility>
 
 #include "cpp-base/integral_types.h"
+#include "cpp-base/string/stringpiece.h"
 
 // In SWIG mode, we don't want anything besides these top-level includes.
 #if !defined(SWIG)
@@ -183,6 +184,19 @@ struct hash<std::string> {
   }
 };
 
+// The same function as hash<std::string>, but bounded by the size rather than a NUL, for lookups
+// by StringPiece in containers keyed by strings.
+template <>
+struct hash<cpp_base::StringPiece> {
+  size_t operator()(const cpp_base::StringPiece& x) const {
+    size_t hash = 0;
+    const char* s = x.data();
+    for (const char* end = s + x.size(); s < end; ++s)
+      hash = ((hash << 5) + hash) ^ *s;
+    return hash;
+  }
+};
+
 template <>
 struct hash<std::thread::id> {
     size_t operator()(const std::thread::id& id) const { return std::hash<std::thread::id>()(id); }
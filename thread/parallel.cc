@@ -0,0 +1,53 @@
+#include "cpp-base/thread/parallel.h"
+
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+
+#include "cpp-base/callback.h"
+
+namespace cpp_base {
+
+namespace {
+
+// A task of RunInParallel().
+class ParallelTask : public Closure {
+  public:
+    ParallelTask(const std::function<void(int)>* f, int index, std::mutex* mutex,
+                 std::condition_variable* done, int* num_left)
+            : f_(f), index_(index), mutex_(mutex), done_(done), num_left_(num_left) { }
+
+    void Run() override {
+        (*f_)(index_);
+        std::unique_lock<std::mutex> lock(*mutex_);
+        if (--*num_left_ == 0)
+            done_->notify_one();
+        lock.unlock();
+        delete this;
+    }
+
+  private:
+    const std::function<void(int)>* f_;
+    const int index_;
+    std::mutex* mutex_;
+    std::condition_variable* done_;
+    int* num_left_;
+};
+
+}  // namespace
+
+void RunInParallel(ThreadPool* pool, int num_tasks, const std::function<void(int)>& f) {
+    if (pool == nullptr) {
+        for (int i = 0; i < num_tasks; ++i)
+            f(i);
+        return;
+    }
+    std::mutex mutex;
+    std::condition_variable done;
+    int num_left = num_tasks;
+    for (int i = 0; i < num_tasks; ++i)
+        pool->Add(new ParallelTask(&f, i, &mutex, &done, &num_left));
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&num_left] { return num_left == 0; });
+}
+
+}  // namespace cpp_base
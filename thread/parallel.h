@@ -0,0 +1,16 @@
+#ifndef CPP_BASE_THREAD_PARALLEL_H_
+#define CPP_BASE_THREAD_PARALLEL_H_
+
+#include <functional>
+
+#include "cpp-base/thread/threadpool.h"
+
+namespace cpp_base {
+
+// Runs f(0), ..., f(num_tasks - 1) on the given pool and waits for them all to finish, or in the
+// calling thread if there is no pool.
+void RunInParallel(ThreadPool* pool, int num_tasks, const std::function<void(int)>& f);
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_THREAD_PARALLEL_H_
@@ -0,0 +1,25 @@
+#ifndef CPP_BASE_THREAD_RUN_THREADS_TEST_UTIL_H_
+#define CPP_BASE_THREAD_RUN_THREADS_TEST_UTIL_H_
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace cpp_base {
+
+// Runs 'num_threads' threads, each calling f(t) with its index t, and returns the seconds
+// they took in total.
+template <class F>
+double RunThreads(int num_threads, const F& f) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+        threads.emplace_back([&f, t]() { f(t); });
+    for (auto& t : threads)
+        t.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace cpp_base
+
+#endif  // CPP_BASE_THREAD_RUN_THREADS_TEST_UTIL_H_